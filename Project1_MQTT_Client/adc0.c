@@ -0,0 +1,54 @@
+// ADC0 Library
+// Internal temperature sensor samples, used as a noise source
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// ADC0 sample sequencer 3, internal temperature sensor
+
+// Hardware averaging is left off, the low bits of each sample then carry a
+// few bits of thermal noise that differ from board to board and boot to boot.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "adc0.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Initialize ADC0 SS3 for single software triggered temperature sensor samples
+void initAdc0()
+{
+    // Enable clocks
+    SYSCTL_RCGCADC_R |= SYSCTL_RCGCADC_R0;
+    _delay_cycles(16);
+
+    // Configure SS3 for one sample of the temperature sensor
+    ADC0_ACTSS_R &= ~ADC_ACTSS_ASEN3;                // disable sample sequencer 3 (SS3) for programming
+    ADC0_EMUX_R = ADC_EMUX_EM3_PROCESSOR;            // select SS3 bit in ADCPSSI as trigger
+    ADC0_SAC_R = 0;                                  // no hardware averaging
+    ADC0_SSMUX3_R = 0;
+    ADC0_SSCTL3_R = ADC_SSCTL3_TS0 | ADC_SSCTL3_END0 | ADC_SSCTL3_IE0; // temperature sensor, end of sequence
+    ADC0_ACTSS_R |= ADC_ACTSS_ASEN3;                 // enable SS3 for operation
+}
+
+// Takes one sample and returns the 12-bit result
+uint16_t readAdc0Ss3()
+{
+    ADC0_PSSI_R |= ADC_PSSI_SS3;                     // set start bit
+    while ((ADC0_RIS_R & ADC_RIS_INR3) == 0);        // wait until SS3 is done
+    ADC0_ISC_R = ADC_ISC_IN3;                        // clear the done flag
+    return ADC0_SSFIFO3_R;
+}
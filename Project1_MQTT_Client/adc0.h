@@ -0,0 +1,31 @@
+// ADC0 Library
+// Internal temperature sensor samples, used as a noise source
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// ADC0 sample sequencer 3, internal temperature sensor
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef ADC0_H_
+#define ADC0_H_
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initAdc0();
+uint16_t readAdc0Ss3();
+
+#endif
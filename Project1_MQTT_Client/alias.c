@@ -0,0 +1,139 @@
+// Alias Library
+// MQTT 5.0 topic alias tables
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Topic aliases are per connection (MQTT 5.0 section 3.3.2.3.4), so both
+// tables are cleared by aliasReset() whenever a CONNECT is sent.
+// Outbound: the first publish to a topic sends the topic and a new alias,
+// later publishes send an empty topic and the alias only.  When every alias
+// the broker allows is in use, the least recently used one is reassigned.
+// Inbound: the broker may do the same to us, up to ALIAS_INBOUND_MAX.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "alias.h"
+
+// Cost of a Topic Alias property on the wire (identifier + 2 byte value)
+#define ALIAS_PROPERTY_SIZE 3
+
+typedef struct _aliasEntry
+{
+    uint8_t  length;
+    uint32_t lastUsed;
+    char     topic[ALIAS_TOPIC_LENGTH];
+} aliasEntry;
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+aliasEntry aliasOutbound[ALIAS_OUTBOUND_MAX];
+uint16_t aliasOutboundLimit = 0;
+uint32_t aliasClock = 0;
+aliasEntry aliasInbound[ALIAS_INBOUND_MAX];
+int32_t aliasBytesSaved = 0;
+uint32_t aliasAliasedCount = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool aliasMatches(aliasEntry* entry, char* topic, uint16_t topicLength)
+{
+    uint16_t i;
+    if (entry->length != topicLength)
+        return false;
+    for (i = 0; i < topicLength; i++)
+        if (entry->topic[i] != topic[i])
+            return false;
+    return true;
+}
+
+void aliasCopy(aliasEntry* entry, char* topic, uint16_t topicLength)
+{
+    uint16_t i;
+    for (i = 0; i < topicLength; i++)
+        entry->topic[i] = topic[i];
+    entry->length = topicLength;
+}
+
+// Clears both tables for a new connection
+// brokerMaximum is the Topic Alias Maximum from CONNACK (0 disables outbound aliases)
+void aliasReset(uint16_t brokerMaximum)
+{
+    uint8_t i;
+    aliasOutboundLimit = brokerMaximum < ALIAS_OUTBOUND_MAX ? brokerMaximum : ALIAS_OUTBOUND_MAX;
+    for (i = 0; i < ALIAS_OUTBOUND_MAX; i++)
+        aliasOutbound[i].length = 0;
+    for (i = 0; i < ALIAS_INBOUND_MAX; i++)
+        aliasInbound[i].length = 0;
+}
+
+// Returns the alias to send with topic, or 0 if the topic must go without one
+// known is set when the broker already has the mapping and the topic can be omitted
+uint16_t aliasGetOutbound(char* topic, uint16_t topicLength, bool* known)
+{
+    uint8_t i, victim = 0;
+    *known = false;
+    if (aliasOutboundLimit == 0 || topicLength == 0 || topicLength > ALIAS_TOPIC_LENGTH)
+        return 0;
+    aliasClock++;
+    for (i = 0; i < aliasOutboundLimit; i++)
+    {
+        if (aliasOutbound[i].length != 0 && aliasMatches(&aliasOutbound[i], topic, topicLength))
+        {
+            aliasOutbound[i].lastUsed = aliasClock;
+            *known = true;
+            aliasBytesSaved += topicLength - ALIAS_PROPERTY_SIZE;
+            aliasAliasedCount++;
+            return i + 1;
+        }
+        // free slots first, then the least recently used
+        if (aliasOutbound[victim].length != 0 && (aliasOutbound[i].length == 0 || aliasOutbound[i].lastUsed < aliasOutbound[victim].lastUsed))
+            victim = i;
+    }
+    aliasCopy(&aliasOutbound[victim], topic, topicLength);
+    aliasOutbound[victim].lastUsed = aliasClock;
+    aliasBytesSaved -= ALIAS_PROPERTY_SIZE;
+    return victim + 1;
+}
+
+// Records a mapping sent by the broker, returns false if the alias is out of range
+bool aliasStoreInbound(uint16_t alias, char* topic, uint16_t topicLength)
+{
+    if (alias == 0 || alias > ALIAS_INBOUND_MAX || topicLength > ALIAS_TOPIC_LENGTH)
+        return false;
+    aliasCopy(&aliasInbound[alias-1], topic, topicLength);
+    return true;
+}
+
+// Returns the topic for an alias sent by the broker, or 0 if it is unknown
+char* aliasGetInbound(uint16_t alias, uint16_t* topicLength)
+{
+    if (alias == 0 || alias > ALIAS_INBOUND_MAX || aliasInbound[alias-1].length == 0)
+        return 0;
+    *topicLength = aliasInbound[alias-1].length;
+    return aliasInbound[alias-1].topic;
+}
+
+// Net bytes saved on outbound publishes, after paying for the alias properties
+int32_t aliasGetBytesSaved()
+{
+    return aliasBytesSaved;
+}
+
+uint32_t aliasGetAliasedCount()
+{
+    return aliasAliasedCount;
+}
@@ -0,0 +1,40 @@
+// Alias Library
+// MQTT 5.0 topic alias tables
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef ALIAS_H_
+#define ALIAS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Outbound aliases we will use (capped by the broker's Topic Alias Maximum)
+#define ALIAS_OUTBOUND_MAX  8
+// Inbound aliases we accept, advertised in CONNECT as Topic Alias Maximum
+#define ALIAS_INBOUND_MAX   8
+// Longest topic that can be aliased
+#define ALIAS_TOPIC_LENGTH  64
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void aliasReset(uint16_t brokerMaximum);
+uint16_t aliasGetOutbound(char* topic, uint16_t topicLength, bool* known);
+bool aliasStoreInbound(uint16_t alias, char* topic, uint16_t topicLength);
+char* aliasGetInbound(uint16_t alias, uint16_t* topicLength);
+int32_t aliasGetBytesSaved();
+uint32_t aliasGetAliasedCount();
+
+#endif
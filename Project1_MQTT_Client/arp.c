@@ -0,0 +1,311 @@
+// ARP Library
+// Cache of IPv4 to MAC address mappings
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Each entry is free, pending (request sent, no answer yet) or resolved.
+// A resolved entry lives ARP_LIFETIME after it was last confirmed.  If it was
+// used since then, a new request goes out ARP_REFRESH_TIME after
+// confirmation so the mapping is renewed before it expires and senders
+// never stall on ARP.  Frames sent to a pending entry are copied into a
+// packet buffer of their size, because the sender goes on to reuse its own,
+// and transmitted when the reply arrives, or dropped if the host does not
+// answer after ARP_MAX_RETRIES requests.  Held frames never take the last
+// large buffer, which the frame being received or built needs.
+// Learning follows RFC 826: any ARP packet refreshes an existing entry for
+// its sender (this covers gratuitous ARP), but only packets aimed at us
+// create new entries.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "arp.h"
+#include "eth0.h"
+#include "timer.h"
+#include "pbuf.h"
+
+typedef enum _arpState
+{
+    arpFree = 0,
+    arpPending = 1,
+    arpResolved = 2
+} arpState;
+
+typedef struct _arpEntry
+{
+    uint8_t state;
+    uint8_t ip[4];
+    uint8_t mac[6];
+    uint8_t retries;
+    bool used;
+    uint32_t confirmed;
+    uint32_t requested;
+} arpEntry;
+
+typedef struct _arpQueuedFrame
+{
+    int8_t entry;                   // -1 when the slot is free
+    uint16_t size;
+    pbuf* frame;
+} arpQueuedFrame;
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+arpEntry arpCache[ARP_CACHE_SIZE];
+arpQueuedFrame arpQueue[ARP_QUEUE_SLOTS];
+uint16_t arpDropCount = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initArpCache()
+{
+    uint8_t i;
+    for (i = 0; i < ARP_CACHE_SIZE; i++)
+        arpCache[i].state = arpFree;
+    for (i = 0; i < ARP_QUEUE_SLOTS; i++)
+        arpQueue[i].entry = -1;
+}
+
+int8_t arpFind(uint8_t ip[4])
+{
+    uint8_t i;
+    for (i = 0; i < ARP_CACHE_SIZE; i++)
+        if (arpCache[i].state != arpFree && arpCache[i].ip[0] == ip[0] && arpCache[i].ip[1] == ip[1]
+                && arpCache[i].ip[2] == ip[2] && arpCache[i].ip[3] == ip[3])
+            return i;
+    return -1;
+}
+
+// Drops the frames waiting on an entry
+void arpDiscardQueue(int8_t entry)
+{
+    uint8_t i;
+    for (i = 0; i < ARP_QUEUE_SLOTS; i++)
+        if (arpQueue[i].entry == entry)
+        {
+            pbufFree(arpQueue[i].frame);
+            arpQueue[i].entry = -1;
+            arpDropCount++;
+        }
+}
+
+void arpFreeEntry(int8_t entry)
+{
+    arpDiscardQueue(entry);
+    arpCache[entry].state = arpFree;
+}
+
+// Takes a free entry, else the resolved entry confirmed longest ago
+int8_t arpAllocate(uint8_t ip[4])
+{
+    uint8_t i;
+    int8_t victim = -1;
+    for (i = 0; i < ARP_CACHE_SIZE && victim < 0; i++)
+        if (arpCache[i].state == arpFree)
+            victim = i;
+    for (i = 0; i < ARP_CACHE_SIZE && victim < 0; i++)
+        if (arpCache[i].state == arpResolved)
+            victim = i;
+    if (victim < 0)
+        return -1;
+    for (i = 0; i < ARP_CACHE_SIZE; i++)
+        if (arpCache[i].state == arpResolved && arpCache[victim].state == arpResolved
+                && (int32_t)(arpCache[i].confirmed - arpCache[victim].confirmed) < 0)
+            victim = i;
+    arpFreeEntry(victim);
+    for (i = 0; i < 4; i++)
+        arpCache[victim].ip[i] = ip[i];
+    return victim;
+}
+
+// Copies the MAC for ip into mac, returns false if it is not resolved
+bool arpLookup(uint8_t ip[4], uint8_t mac[6])
+{
+    int8_t entry = arpFind(ip);
+    uint8_t i;
+    if (entry < 0 || arpCache[entry].state != arpResolved)
+        return false;
+    for (i = 0; i < 6; i++)
+        mac[i] = arpCache[entry].mac[i];
+    arpCache[entry].used = true;
+    return true;
+}
+
+// Records ip at mac, sending any frames that were waiting for it
+// create adds the mapping if ip is not already cached
+void arpLearn(uint8_t ip[4], uint8_t mac[6], bool create)
+{
+    int8_t entry = arpFind(ip);
+    uint8_t i, j;
+    etherHeader* ether;
+    if (entry < 0)
+    {
+        if (!create)
+            return;
+        entry = arpAllocate(ip);
+        if (entry < 0)
+            return;
+    }
+    for (i = 0; i < 6; i++)
+        arpCache[entry].mac[i] = mac[i];
+    arpCache[entry].state = arpResolved;
+    arpCache[entry].confirmed = getTimerTicks();
+    arpCache[entry].retries = 0;
+    arpCache[entry].used = false;
+    for (i = 0; i < ARP_QUEUE_SLOTS; i++)
+        if (arpQueue[i].entry == entry)
+        {
+            ether = (etherHeader*)arpQueue[i].frame->payload;
+            for (j = 0; j < 6; j++)
+                ether->destAddress[j] = mac[j];
+            etherPutPacket(ether, arpQueue[i].size);
+            pbufFree(arpQueue[i].frame);
+            arpQueue[i].entry = -1;
+            arpCache[entry].used = true;
+        }
+}
+
+void arpRemove(uint8_t ip[4])
+{
+    int8_t entry = arpFind(ip);
+    if (entry >= 0)
+        arpFreeEntry(entry);
+}
+
+// Sends the frame in ether (size bytes) to ip, which is the next hop
+// If ip is not resolved the frame is held and a request is sent, which reuses ether
+// Returns false if the frame had to be dropped
+bool arpResolve(etherHeader* ether, uint8_t ip[4], uint16_t size)
+{
+    int8_t entry = arpFind(ip);
+    uint8_t i, slot, held = 0;
+    uint16_t j;
+    pbuf* p;
+    if (entry >= 0 && arpCache[entry].state == arpResolved)
+    {
+        for (i = 0; i < 6; i++)
+            ether->destAddress[i] = arpCache[entry].mac[i];
+        arpCache[entry].used = true;
+        etherPutPacket(ether, size);
+        return true;
+    }
+    if (entry < 0)
+    {
+        entry = arpAllocate(ip);
+        if (entry < 0)
+        {
+            arpDropCount++;
+            return false;
+        }
+        arpCache[entry].state = arpPending;
+        arpCache[entry].retries = 0;
+        arpCache[entry].requested = getTimerTicks() - ARP_RETRY_TIME;
+    }
+    slot = ARP_QUEUE_SLOTS;
+    for (i = 0; i < ARP_QUEUE_SLOTS; i++)
+    {
+        if (arpQueue[i].entry == entry)
+            held++;
+        else if (arpQueue[i].entry < 0)
+            slot = i;
+    }
+    if (slot == ARP_QUEUE_SLOTS || held >= ARP_QUEUE_PER_ENTRY
+            || (size > PBUF_SMALL_SIZE && pbufGetFreeCount(pbufLarge) <= ARP_QUEUE_LARGE_RESERVE))
+    {
+        arpDropCount++;
+        return false;
+    }
+    p = pbufAlloc(size);
+    if (p == 0)
+    {
+        arpDropCount++;
+        return false;
+    }
+    for (j = 0; j < size; j++)
+        p->payload[j] = ((uint8_t*)ether)[j];
+    arpQueue[slot].frame = p;
+    arpQueue[slot].size = size;
+    arpQueue[slot].entry = entry;
+    // ask now unless a request is already outstanding
+    if (getTimerTicks() - arpCache[entry].requested >= ARP_RETRY_TIME)
+    {
+        arpCache[entry].requested = getTimerTicks();
+        arpCache[entry].retries++;
+        etherSendArpRequest(ether, ip);
+    }
+    return true;
+}
+
+// Ages the cache, repeats requests and refreshes entries in use
+// ether is scratch space for any request sent
+void arpService(etherHeader* ether)
+{
+    uint8_t i;
+    uint32_t now = getTimerTicks();
+    arpEntry* e;
+    for (i = 0; i < ARP_CACHE_SIZE; i++)
+    {
+        e = &arpCache[i];
+        if (e->state == arpPending)
+        {
+            if (now - e->requested >= ARP_RETRY_TIME)
+            {
+                if (e->retries >= ARP_MAX_RETRIES)
+                    arpFreeEntry(i);
+                else
+                {
+                    e->requested = now;
+                    e->retries++;
+                    etherSendArpRequest(ether, e->ip);
+                    return;
+                }
+            }
+        }
+        else if (e->state == arpResolved)
+        {
+            if (now - e->confirmed >= ARP_LIFETIME)
+                arpFreeEntry(i);
+            else if (e->used && now - e->confirmed >= ARP_REFRESH_TIME && e->retries < ARP_MAX_RETRIES
+                    && (e->retries == 0 || now - e->requested >= ARP_RETRY_TIME))
+            {
+                // one request per call keeps the scratch frame simple
+                e->requested = now;
+                e->retries++;
+                etherSendArpRequest(ether, e->ip);
+                return;
+            }
+        }
+    }
+}
+
+// Copies out entry index for display, returns false if the slot is unused
+bool arpGetEntry(uint8_t index, uint8_t ip[4], uint8_t mac[6], uint32_t* age)
+{
+    uint8_t i;
+    if (index >= ARP_CACHE_SIZE || arpCache[index].state != arpResolved)
+        return false;
+    for (i = 0; i < 4; i++)
+        ip[i] = arpCache[index].ip[i];
+    for (i = 0; i < 6; i++)
+        mac[i] = arpCache[index].mac[i];
+    *age = getTimerTicks() - arpCache[index].confirmed;
+    return true;
+}
+
+uint16_t arpGetDropCount()
+{
+    return arpDropCount;
+}
@@ -0,0 +1,49 @@
+// ARP Library
+// Cache of IPv4 to MAC address mappings
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef ARP_H_
+#define ARP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "eth0.h"
+
+#define ARP_CACHE_SIZE       8
+// How long a mapping is trusted, and when one in use is confirmed again (ms)
+#define ARP_LIFETIME         600000
+#define ARP_REFRESH_TIME     570000
+// Requests for an unresolved or refreshing entry are repeated this often (ms)
+#define ARP_RETRY_TIME       1000
+#define ARP_MAX_RETRIES      3
+// Frames held while their next hop is resolved
+#define ARP_QUEUE_SLOTS      4
+#define ARP_QUEUE_PER_ENTRY  2
+// Large buffers a held frame must leave free
+#define ARP_QUEUE_LARGE_RESERVE 1
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initArpCache();
+bool arpLookup(uint8_t ip[4], uint8_t mac[6]);
+void arpLearn(uint8_t ip[4], uint8_t mac[6], bool create);
+void arpRemove(uint8_t ip[4]);
+bool arpResolve(etherHeader* ether, uint8_t ip[4], uint16_t size);
+void arpService(etherHeader* ether);
+bool arpGetEntry(uint8_t index, uint8_t ip[4], uint8_t mac[6], uint32_t* age);
+uint16_t arpGetDropCount();
+
+#endif
@@ -0,0 +1,56 @@
+// Boot Library
+// Timeline of the steps from reset to a live broker connection
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Each step is stamped, in microseconds of the Timer 4A time base, the first
+// time it completes and is also traced.  Later completions (a reconnect, a
+// renewed lease) leave the boot stamp alone.  The time spent setting up the
+// system clock before Timer 4A starts is not counted.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "boot.h"
+#include "timer.h"
+#include "trace.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint32_t bootMarks[bootStepCount];
+bool bootMarked[bootStepCount];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void bootMark(bootStep step)
+{
+    if (bootMarked[step])
+        return;
+    bootMarks[step] = getTimerMicroseconds();
+    bootMarked[step] = true;
+    TRACE(traceBoot, step, bootMarks[step], 0);
+}
+
+bool bootIsMarked(bootStep step)
+{
+    return bootMarked[step];
+}
+
+// Microseconds from the time base starting to step, 0 if it has not happened
+uint32_t bootGetMark(bootStep step)
+{
+    return bootMarked[step] ? bootMarks[step] : 0;
+}
@@ -0,0 +1,46 @@
+// Boot Library
+// Timeline of the steps from reset to a live broker connection
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Steps in the order they normally complete
+typedef enum _bootStep
+{
+    bootTimeBase,               // Timer 4A running, the timeline starts here
+    bootConfig,                 // settings read from EEPROM
+    bootEtherClock,             // ENC28J60 oscillator start-up timer expired
+    bootEther,                  // ENC28J60 configured and receiving
+    bootSchedule,               // scheduler running
+    bootLinkUp,                 // PHY reports link
+    bootAddress,                // static address set or DHCP lease bound
+    bootBrokerArp,              // broker (or gateway) MAC resolved
+    bootTcp,                    // SYN-ACK from the broker
+    bootConnAck,                // CONNACK from the broker
+    bootStepCount
+} bootStep;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void bootMark(bootStep step);
+bool bootIsMarked(bootStep step);
+uint32_t bootGetMark(bootStep step);
+
+#endif
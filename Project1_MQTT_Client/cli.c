@@ -0,0 +1,103 @@
+// CLI Library
+// Command tables for the UART command line
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// A table is a const array of commands searched in order.  With a dozen
+// verbs a table the scan rejects most commands on their first character,
+// and host/test/clibench.c finds it within tens of nanoseconds of a hashed
+// index either way, well under the cost of parsing the line, so no index
+// is built.  Tables nest: a handler can dispatch the next field through a
+// table of its own, as SET does for its settings.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cli.h"
+#include "uart0.h"
+#include "console.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+char cliUpper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? c - 32 : c;
+}
+
+bool cliVerbMatches(char* verb, char* field)
+{
+    while (*verb != '\0' && cliUpper(*verb) == cliUpper(*field))
+    {
+        verb++;
+        field++;
+    }
+    return *verb == '\0' && *field == '\0';
+}
+
+void cliBuild(cliTable* table, const cliCommand* commands, uint8_t count)
+{
+    table->commands = commands;
+    table->count = count;
+}
+
+// Returns the command for verb, or 0 if the table has none
+const cliCommand* cliFind(cliTable* table, char* verb)
+{
+    uint8_t i;
+    // verbs are letters, so folding the first character to lower case rejects
+    // most commands before the full compare; a false hit is caught by that
+    char first = verb[0] | 0x20;
+    for (i = 0; i < table->count; i++)
+        if ((table->commands[i].verb[0] | 0x20) == first && cliVerbMatches(table->commands[i].verb, verb))
+            return &table->commands[i];
+    return 0;
+}
+
+// Runs the command named by field number field of info
+// Its handler is only called when at least minArgs fields follow the verb
+cliResult cliDispatch(cliTable* table, USER_DATA* info, uint8_t field, etherHeader* ether)
+{
+    const cliCommand* command;
+    // fieldCount is one more than the number of fields
+    if (info->fieldCount <= field)
+        return cliUnknown;
+    command = cliFind(table, getFieldString(info, field));
+    if (command == 0)
+        return cliUnknown;
+    if (info->fieldCount - 1 - field < command->minArgs)
+        return cliMissingArgs;
+    command->handler(info, ether);
+    return cliHandled;
+}
+
+// Lists every command in table, each verb preceded by prefix
+// The help lines start at the same column whatever the length of the verb
+void cliPrintHelp(cliTable* table, char* prefix)
+{
+    uint8_t i, column;
+    char* c;
+    for (i = 0; i < table->count; i++)
+    {
+        column = 0;
+        for (c = prefix; *c != '\0'; c++, column++)
+            putcUart0(*c);
+        for (c = table->commands[i].verb; *c != '\0'; c++, column++)
+            putcUart0(*c);
+        do
+            putcUart0(' ');
+        while (++column < CLI_HELP_COLUMN);
+        putsUart0(table->commands[i].help);
+        putsUart0("\r\n");
+    }
+}
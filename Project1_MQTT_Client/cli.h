@@ -0,0 +1,58 @@
+// CLI Library
+// Command tables for the UART command line
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef CLI_H_
+#define CLI_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "console.h"
+#include "eth0.h"
+
+// Column the help text starts in, past the longest prefix and verb
+#define CLI_HELP_COLUMN 17
+
+// Called with the parsed line and the frame buffer, which may be used to send
+typedef void (*cliHandler)(USER_DATA* info, etherHeader* ether);
+
+typedef struct _cliCommand
+{
+    char* verb;                     // matched without regard to case
+    uint8_t minArgs;                // fields required after the verb
+    cliHandler handler;
+    char* help;                     // arguments and a short description
+} cliCommand;
+
+typedef struct _cliTable
+{
+    const cliCommand* commands;
+    uint8_t count;
+} cliTable;
+
+typedef enum _cliResult
+{
+    cliHandled, cliUnknown, cliMissingArgs
+} cliResult;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void cliBuild(cliTable* table, const cliCommand* commands, uint8_t count);
+const cliCommand* cliFind(cliTable* table, char* verb);
+cliResult cliDispatch(cliTable* table, USER_DATA* info, uint8_t field, etherHeader* ether);
+void cliPrintHelp(cliTable* table, char* prefix);
+
+#endif
@@ -0,0 +1,339 @@
+// Config Library
+// Key-value configuration store in EEPROM with a RAM cache
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// On-chip EEPROM blocks 0-15 (word addresses 0x0000-0x00FF)
+
+// Every setting lives in a RAM image of key, length, value records, so
+// configGet() never touches the EEPROM.  The image is committed as a whole
+// to one of CONFIG_SLOTS slots:
+//   word 0:  header    [31:24] magic, [23:16] format, [15:0] image bytes
+//   word 1:  sequence  one more than the commit before
+//   word 2:  crc       CRC-32 over words 0, 1 and the image
+//   word 3+: image
+// Each commit goes to the slot after the newest one, so the slots wear
+// evenly.  The header is cleared first and written last, so a reset part
+// way through leaves the slot invalid and the previous commit stands.
+// initConfig() reads each slot once and keeps the newest valid one.
+// configSet() only changes the image; configService() snapshots it and
+// writes CONFIG_WORDS_PER_SERVICE words per call, so several SETs made
+// together cost one commit and no caller waits on the EEPROM.
+// When no slot is valid the IP address and broker address are carried over
+// from the fixed locations the original firmware kept them in; the settings
+// added since were never released that way and start out unset.  The first
+// commit goes to the last slot, clear of the two old records.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "eeprom.h"
+
+#define CONFIG_MAGIC             0xC5
+#define CONFIG_FORMAT            1
+#define CONFIG_WORDS_PER_SERVICE 4
+
+// Locations used by the original firmware: a flag word holding a known
+// value, then the address one byte per word
+
+typedef struct _configLegacyAddress
+{
+    uint8_t key;
+    uint16_t flag;
+    uint16_t stored;
+    uint16_t value;
+} configLegacyAddress;
+
+const configLegacyAddress configLegacyAddresses[] =
+{
+    {configIp,      0x0000, 100, 0x0060},
+    {configMqtt,    0x0010, 200, 0x0080},
+};
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint8_t configImage[CONFIG_MAX_BYTES];
+uint16_t configUsed = 0;
+bool configDirty = false;
+uint32_t configSequence = 0;
+uint8_t configSlot = CONFIG_SLOTS - 2;
+uint16_t configBadSlots = 0;
+
+// Commit being written
+uint32_t configStage[CONFIG_SLOT_WORDS];
+bool configWriting = false;
+uint8_t configWriteSlot;
+uint8_t configWriteWords;
+uint8_t configWriteStep;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint16_t configAddress(uint8_t slot)
+{
+    return CONFIG_EEPROM_START + slot * CONFIG_SLOT_WORDS;
+}
+
+// CRC-32 (IEEE 802.3), fed a word at a time, least significant byte first
+uint32_t configCrc(uint32_t crc, uint32_t word)
+{
+    uint8_t i;
+    crc ^= word;
+    for (i = 0; i < 32; i++)
+        crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    return crc;
+}
+
+uint32_t configStageCrc(uint8_t words)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    uint8_t i;
+    crc = configCrc(crc, configStage[0]);
+    crc = configCrc(crc, configStage[1]);
+    for (i = CONFIG_HEADER_WORDS; i < words; i++)
+        crc = configCrc(crc, configStage[i]);
+    return ~crc;
+}
+
+// Returns the offset of key in the image, or -1
+int16_t configFind(configKey key)
+{
+    uint16_t i = 0;
+    while (i + 2 <= configUsed)
+    {
+        if (configImage[i] == key)
+            return i;
+        i += 2 + configImage[i+1];
+    }
+    return -1;
+}
+
+// Reads slot into configStage, returns its image size or -1 if it is not a valid commit
+int16_t configReadSlot(uint8_t slot)
+{
+    uint16_t address = configAddress(slot);
+    uint32_t header = readEeprom(address);
+    uint16_t bytes = header & 0xFFFF;
+    uint8_t i, words;
+    if ((header >> 24) != CONFIG_MAGIC || ((header >> 16) & 0xFF) != CONFIG_FORMAT || bytes > CONFIG_MAX_BYTES)
+        return -1;
+    words = CONFIG_HEADER_WORDS + (bytes + 3) / 4;
+    for (i = 0; i < words; i++)
+        configStage[i] = readEeprom(address + i);
+    if (configStageCrc(words) != configStage[2])
+    {
+        configBadSlots++;
+        return -1;
+    }
+    return bytes;
+}
+
+// Drops a truncated record at the end of an image read from EEPROM
+void configCheckImage()
+{
+    uint16_t i = 0;
+    while (i + 2 <= configUsed && i + 2 + configImage[i+1] <= configUsed)
+        i += 2 + configImage[i+1];
+    configUsed = i;
+}
+
+void configImportLegacy()
+{
+    uint8_t i, j, value[4];
+    for (i = 0; i < sizeof(configLegacyAddresses) / sizeof(configLegacyAddress); i++)
+        if (readEeprom(configLegacyAddresses[i].flag) == configLegacyAddresses[i].stored)
+        {
+            for (j = 0; j < 4; j++)
+                value[j] = readEeprom(configLegacyAddresses[i].value + j);
+            configSet((configKey)configLegacyAddresses[i].key, value, 4);
+        }
+}
+
+// Loads the newest valid commit into RAM, call once after initEeprom()
+void initConfig()
+{
+    uint8_t slot, i;
+    int16_t bytes;
+    bool found = false;
+    configUsed = 0;
+    configDirty = false;
+    configWriting = false;
+    configBadSlots = 0;
+    for (slot = 0; slot < CONFIG_SLOTS; slot++)
+    {
+        bytes = configReadSlot(slot);
+        if (bytes < 0 || (found && (int32_t)(configStage[1] - configSequence) <= 0))
+            continue;
+        found = true;
+        configSlot = slot;
+        configSequence = configStage[1];
+        configUsed = bytes;
+        for (i = 0; i < bytes; i++)
+            configImage[i] = configStage[CONFIG_HEADER_WORDS + i / 4] >> ((i % 4) * 8);
+    }
+    if (found)
+        configCheckImage();
+    else
+    {
+        configSlot = CONFIG_SLOTS - 2;
+        configSequence = 0;
+        configImportLegacy();
+    }
+}
+
+// Copies up to size bytes of key into value, returns the stored length or 0 if key is not set
+uint8_t configGet(configKey key, void* value, uint8_t size)
+{
+    int16_t offset = configFind(key);
+    uint8_t i, length;
+    if (offset < 0)
+        return 0;
+    length = configImage[offset+1];
+    for (i = 0; i < length && i < size; i++)
+        ((uint8_t*)value)[i] = configImage[offset + 2 + i];
+    return length;
+}
+
+// Updates the RAM image, configService() commits it
+// Returns false if the image has no room, setting a value it already holds writes nothing
+bool configSet(configKey key, const void* value, uint8_t length)
+{
+    int16_t offset = configFind(key);
+    uint16_t i, room = CONFIG_MAX_BYTES - configUsed;
+    bool same;
+    if (offset >= 0)
+    {
+        same = configImage[offset+1] == length;
+        for (i = 0; i < length && same; i++)
+            same = configImage[offset + 2 + i] == ((uint8_t*)value)[i];
+        if (same)
+            return true;
+        room += 2 + configImage[offset+1];
+    }
+    if (2 + length > room)
+        return false;
+    configErase(key);
+    configImage[configUsed++] = key;
+    configImage[configUsed++] = length;
+    for (i = 0; i < length; i++)
+        configImage[configUsed++] = ((uint8_t*)value)[i];
+    configDirty = true;
+    return true;
+}
+
+void configErase(configKey key)
+{
+    int16_t offset = configFind(key);
+    uint16_t i, size;
+    if (offset < 0)
+        return;
+    size = 2 + configImage[offset+1];
+    for (i = offset; i + size < configUsed; i++)
+        configImage[i] = configImage[i + size];
+    configUsed -= size;
+    configDirty = true;
+}
+
+// Snapshots the image, so SETs made while it is written go in the next commit
+void configStartCommit()
+{
+    uint8_t i;
+    configWriteSlot = (configSlot + 1) % CONFIG_SLOTS;
+    configWriteWords = CONFIG_HEADER_WORDS + (configUsed + 3) / 4;
+    for (i = CONFIG_HEADER_WORDS; i < configWriteWords; i++)
+        configStage[i] = 0;
+    for (i = 0; i < configUsed; i++)
+        configStage[CONFIG_HEADER_WORDS + i / 4] |= (uint32_t)configImage[i] << ((i % 4) * 8);
+    configStage[0] = ((uint32_t)CONFIG_MAGIC << 24) | ((uint32_t)CONFIG_FORMAT << 16) | configUsed;
+    configStage[1] = configSequence + 1;
+    configStage[2] = configStageCrc(configWriteWords);
+    configWriteStep = 0;
+    configWriting = true;
+    configDirty = false;
+}
+
+// Writes the next word of the commit: clear the header, image, sequence, crc, then the header
+void configWriteNext()
+{
+    uint16_t address = configAddress(configWriteSlot);
+    uint8_t payloadWords = configWriteWords - CONFIG_HEADER_WORDS;
+    if (configWriteStep == 0)
+        writeEeprom(address, 0);
+    else if (configWriteStep <= payloadWords)
+        writeEeprom(address + CONFIG_HEADER_WORDS - 1 + configWriteStep, configStage[CONFIG_HEADER_WORDS - 1 + configWriteStep]);
+    else if (configWriteStep == payloadWords + 1)
+        writeEeprom(address + 1, configStage[1]);
+    else if (configWriteStep == payloadWords + 2)
+        writeEeprom(address + 2, configStage[2]);
+    else
+    {
+        writeEeprom(address, configStage[0]);
+        configSlot = configWriteSlot;
+        configSequence = configStage[1];
+        configWriting = false;
+    }
+    configWriteStep++;
+}
+
+// Call periodically, commits changes a few words at a time
+void configService()
+{
+    uint8_t i;
+    if (!configWriting)
+    {
+        if (!configDirty)
+            return;
+        configStartCommit();
+    }
+    for (i = 0; i < CONFIG_WORDS_PER_SERVICE && configWriting; i++)
+        configWriteNext();
+}
+
+bool configIsPending()
+{
+    return configDirty || configWriting;
+}
+
+// Finishes any commit now, before a reset
+void configFlush()
+{
+    while (configIsPending())
+        configService();
+}
+
+// Sequence number of the newest commit, 0 before the first
+uint32_t configGetSequence()
+{
+    return configSequence;
+}
+
+uint8_t configGetSlot()
+{
+    return configSlot;
+}
+
+// Image bytes in use, of CONFIG_MAX_BYTES
+uint16_t configGetUsed()
+{
+    return configUsed;
+}
+
+// Slots found at boot with a valid header but a bad CRC
+uint16_t configGetBadSlots()
+{
+    return configBadSlots;
+}
@@ -0,0 +1,64 @@
+// Config Library
+// Key-value configuration store in EEPROM with a RAM cache
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// On-chip EEPROM blocks 0-15 (word addresses 0x0000-0x00FF)
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// EEPROM region reserved for the store (word addresses), split into slots
+#define CONFIG_EEPROM_START     0x0000
+#define CONFIG_SLOTS            4
+#define CONFIG_SLOT_WORDS       64
+#define CONFIG_HEADER_WORDS     3
+#define CONFIG_MAX_BYTES        ((CONFIG_SLOT_WORDS - CONFIG_HEADER_WORDS) * 4)
+
+// Keys are never renumbered, a new setting takes the next number
+typedef enum _configKey
+{
+    configIp = 1,               // static address, DHCP when absent
+    configGateway = 2,
+    configSubnet = 3,
+    configDns = 4,              // DNS server, the one from DHCP when absent
+    configMqtt = 5,             // broker address
+    configMqttHost = 6,         // broker hostname, resolved by DNS
+    configMirror = 7,           // mirror broker address
+    configDhcpLease = 8,        // last lease, for INIT-REBOOT
+    configAutoConnect = 9,      // 1 to connect to the broker at boot
+    configMac = 10,             // MAC address, made up on first boot unless set
+    configKeyCount
+} configKey;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initConfig();
+uint8_t configGet(configKey key, void* value, uint8_t size);
+bool configSet(configKey key, const void* value, uint8_t length);
+void configErase(configKey key);
+void configService();
+bool configIsPending();
+void configFlush();
+uint32_t configGetSequence();
+uint8_t configGetSlot();
+uint16_t configGetUsed();
+uint16_t configGetBadSlots();
+
+#endif
@@ -0,0 +1,300 @@
+// Console Library
+// Line assembly and field parsing for commands typed on UART0
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    -
+
+// Only the character functions of uart0.h are used here, so the same
+// command line runs over host/uart0.c on a workstation.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "console.h"
+#include "uart0.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+char consoleLine[MAX_CHARS+1];                      // line being assembled
+uint8_t consoleLineCount = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Copies the assembled line to data and starts a new one
+void endLineUart0(USER_DATA* data)
+{
+    uint8_t i;
+    for (i = 0; i < consoleLineCount; i++)
+        data->buffer[i] = consoleLine[i];
+    data->buffer[i] = '\0';
+    consoleLineCount = 0;
+}
+
+// Non-blocking function that adds whatever characters have arrived to a private line buffer
+// Returns true once Enter is pressed or MAX_CHARS are collected, with the line copied to data
+// data is left alone until then, since fields of the previous command may still be in use
+bool getLineUart0(USER_DATA* data)
+{
+    char c;
+    while (kbhitUart0())
+    {
+        c = getcUart0();
+        if ((c == 8) || (c == 127))                  // backspace
+        {
+            if (consoleLineCount > 0)
+                consoleLineCount--;
+        }
+        else if ((c == 13) || (c == 10))             // carriage return or line feed
+        {
+            // a CR LF pair would otherwise end a second, empty line
+            if (consoleLineCount == 0 && c == 10)
+                continue;
+            endLineUart0(data);
+            return true;
+        }
+        else if (c >= 32)
+        {
+            consoleLine[consoleLineCount++] = c;
+            if (consoleLineCount == MAX_CHARS)
+            {
+                endLineUart0(data);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Function that returns with string of serial data when it exceeds MAXCHAR/Enter is pressed
+void getsUart0(USER_DATA* data)
+{
+ uint8_t count=0;                   //variable to keep track of string length
+ char c;
+    while(count < MAX_CHARS)              //Iterite only when length is less than MAX
+        {
+            c=getcUart0();
+            if((c == 8)||(c==127))  //check if its backspace
+            {
+                if (count>0)
+                {
+                    count=count-1;  //If characters already entered in serial data,decrement count
+                    continue;
+                }
+                else
+                {
+                    continue;       //else get next character
+                }
+            }
+            else if((c==13)||(c==10))//If character is carriage return or line space
+            {
+                data->buffer[count]= '\0' ;
+                break;              //return the string
+            }
+            else if(c >= 32)
+            {
+                data->buffer[count++] = c;   //else move the character to the string
+                if (count == MAX_CHARS)   //If it has reached maximum allowed character
+                {
+                 data->buffer[count]= '\0' ;
+                 break;             //break and return the string
+                }
+            }
+            else
+            {
+                continue;           //else get next Character
+            }
+        }
+    return;                     //Return from function
+}
+
+//Returns true for characters that belong to a field
+//Alphanumerics plus the Mqtt topic separator and wildcards so topic names parse as one field,
+//and '-' so hostname labels do
+bool isFieldCharacter(char c)
+{
+    return (c>47 && c<58) || (c>64 && c<91) || (c>96 && c<123) || (c=='/') || (c=='+') || (c=='#') || (c=='_') || (c=='-');
+}
+
+//Function to parse the string and replace delimiters with Null and calculate position of useful literals
+void parseFields(USER_DATA* data)
+{
+    uint8_t i=0;
+    uint8_t j=0;
+    while(data->buffer[i] != '\0')       //Loop Until Strings last character
+    {
+        /*if((data->buffer[i] >= 97) && (data->buffer[i] <= 122))     //convert all lower case characters to upper case for easier parsing
+        {
+            data->buffer[i] = data->buffer[i] - 32;
+        }*/
+        if(i==0)                //for first character check if useful or delimiter
+        {
+            if(isFieldCharacter(data->buffer[i]))
+            {
+                data->fieldPositon[j]=i;       //if useful chracter store the position into pos array
+                j++;            //increment index of pos array
+                i++;            //increment string index to parse next character
+            }
+            else
+            {
+                data->buffer[i] = 0;     //if its a delimiter,replace it with null
+                i++;            //increment string index to parse next character
+            }
+        }
+        else
+        {
+            if(isFieldCharacter(data->buffer[i])) //check if 0+i characters are not delimiers
+            {
+                if(data->buffer[i-1] == 0)       //check if the previous character was a delimiter which is now 0
+                {
+                    data->fieldPositon[j]=i;           //if yes store the index into position array
+                    j++;                //increment index of pos array
+                    i++;                //increment string index to parse next character
+                }
+                else
+                {
+                    i++;                //if not just increment the string index
+                }
+            }
+            else
+            {
+                data->buffer[i]=0;               //replace delimiter with null
+                i++;                    //increment the string index
+            }
+        }
+        if (j <= MAX_FIELDS-1)                  //check if its under maximum valid arguments
+        {
+            continue;                   //if yes continue for further iterations
+        }
+        else
+        {
+            putsUart0("Exceeded argument limit,discarding unnecessary arguments");
+            putsUart0("\r\n");
+            break;                      //else keep the fields found so far
+        }
+    }
+    data->fieldCount = j+1;
+    return;
+}
+
+
+//function to return an field from the String based on field number
+char* getFieldString(USER_DATA* data,uint8_t fieldNumber)
+{
+    return &data->buffer[data->fieldPositon[fieldNumber-1]];
+}
+
+
+//function to convert field String into Integer
+uint32_t getFieldInt(USER_DATA* data,uint8_t fieldNumber)
+{
+    return atoi(getFieldString(data,fieldNumber));      //return integer of argument number argPos from sting str
+}
+
+//function to convert field String into Integer
+float getFieldFloat(USER_DATA* data,uint8_t fieldNumber)
+{
+    return atof(getFieldString(data,fieldNumber));      //return float of argument number argPos from sting str
+}
+
+//Function to check if two strings are equal
+bool stringCompare(char str1[], char str2[])
+{
+    int ctr=0;
+    while(str1[ctr]==str2[ctr])
+    {
+        if(str1[ctr]=='\0'||str2[ctr]=='\0')
+            break;
+        ctr++;
+    }
+    if(str1[ctr]=='\0' && str2[ctr]=='\0')
+        return true;
+    else
+        return false;
+}
+
+
+void reverse(char* s, uint8_t l)
+{
+    uint8_t i=0,j=l-1;
+    char temp;
+    for(i=0;i<j;i++)
+    {
+       temp=s[i];
+       s[i]=s[j];
+       s[j]=temp;
+       j--;
+    }
+}
+
+//reffered from geeksforgeeks
+char* itoa(int num,char* str, int base)
+{
+    int i = 0;
+    bool isNegative = false;
+
+    /* Handle 0 explicitly, otherwise empty string is printed for 0 */
+    if (num == 0)
+    {
+        str[i++] = '0';
+        while(num == 0 && i <= 7 && base == 16)
+        {
+            str[i++] = '0';
+        }
+        str[i] = '\0';
+        return str;
+    }
+
+    // In standard itoa(), negative numbers are handled only with
+    // base 10. Otherwise numbers are considered unsigned.
+    if (num < 0 && base == 10)
+    {
+        isNegative = true;
+        num = -num;
+    }
+
+    // Process individual digits
+    while (num != 0)
+    {
+        int rem = num % base;
+        str[i++] = (rem > 9)? (rem-10) + 'A' : rem + '0';
+        num = num/base;
+    }
+
+    // If number is negative, append '-'
+    if (isNegative)
+        str[i++] = '-';
+
+    while(num == 0 && i <= 7 && base == 16)
+    {
+        str[i++] = '0';
+    }
+    str[i] = '\0'; // Append string terminator
+
+    // Reverse the string
+    reverse(str, i);
+
+    return str;
+}
+
+uint16_t strLen(char* string)
+{
+    uint16_t i = 0;
+    while(string[i] != 0)
+    {
+        i++;
+    }
+    return i;
+}
@@ -0,0 +1,53 @@
+// Console Library
+// Line assembly and field parsing for commands typed on UART0
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    -
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// GLOBAL Declarations
+//-----------------------------------------------------------------------------
+
+#define MAX_CHARS 80
+// A line of MAX_CHARS holds at most one field in every two characters
+#define MAX_FIELDS (MAX_CHARS/2 + 1)
+typedef struct _USER_DATA
+        {
+            char buffer[MAX_CHARS+1];
+            uint8_t fieldCount;
+            uint8_t fieldPositon[MAX_FIELDS];
+            char fieldType[MAX_FIELDS];
+        } USER_DATA;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void getsUart0(USER_DATA* data);
+bool getLineUart0(USER_DATA* data);
+bool isFieldCharacter(char c);
+void parseFields(USER_DATA* data);
+char* getFieldString(USER_DATA* data,uint8_t fieldNumber);
+uint32_t getFieldInt(USER_DATA* data,uint8_t fieldNumber);
+float getFieldFloat(USER_DATA* data,uint8_t fieldNumber);
+bool stringCompare(char str1[], char str2[]);
+char* itoa(int num,char* str, int base);
+void reverse(char* s, uint8_t l);
+uint16_t strLen(char* string);
+
+#endif
@@ -0,0 +1,47 @@
+// CPU Library
+// Interrupt masking, sleep and reset for the Cortex-M4F core
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// The only core instructions and system registers the stack needs, so the
+// modules above build unchanged against host/cpu.c on a workstation.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "cpu.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void disableInterrupts()
+{
+    __asm(" CPSID I");
+}
+
+void enableInterrupts()
+{
+    __asm(" CPSIE I");
+}
+
+// Sleeps until an interrupt is pending, even one masked by disableInterrupts()
+void waitForInterrupt()
+{
+    __asm(" WFI");
+}
+
+void resetSystem()
+{
+    NVIC_APINT_R = NVIC_APINT_VECTKEY | NVIC_APINT_SYSRESETREQ;
+}
@@ -0,0 +1,28 @@
+// CPU Library
+// Interrupt masking, sleep and reset for the Cortex-M4F core
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef CPU_H_
+#define CPU_H_
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void disableInterrupts();
+void enableInterrupts();
+void waitForInterrupt();
+void resetSystem();
+
+#endif
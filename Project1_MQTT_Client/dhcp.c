@@ -0,0 +1,465 @@
+// DHCP Library
+// DHCP client with the lease kept in EEPROM for INIT-REBOOT
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Follows the client state machine of RFC 2131 section 4.4.  Nothing here
+// blocks: dhcpService() sends whatever the current state and timers call
+// for, and dhcpProcess() handles OFFER, ACK and NAK as they arrive.
+// Each granted lease is kept in the config store (which writes nothing when
+// it matches the stored one).  After a reset the client starts in INIT-REBOOT and asks for
+// the stored address directly, one broadcast REQUEST answered by one ACK,
+// instead of the DISCOVER/OFFER/REQUEST/ACK exchange.  Retransmissions
+// double from DHCP_RETRY_TIME with +/-1 s of jitter.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dhcp.h"
+#include "eth0.h"
+#include "config.h"
+#include "timer.h"
+
+#define DHCPDISCOVER 1
+#define DHCPOFFER    2
+#define DHCPREQUEST  3
+#define DHCPACK      5
+#define DHCPNAK      6
+
+#define DHCP_MAGIC_COOKIE 0x63825363
+// BOOTP relays may drop anything shorter
+#define DHCP_MIN_MESSAGE  300
+
+// Stored lease, one word per field
+#define DHCP_LEASE_IP      0
+#define DHCP_LEASE_SERVER  1
+#define DHCP_LEASE_MASK    2
+#define DHCP_LEASE_ROUTER  3
+#define DHCP_LEASE_DNS     4
+#define DHCP_LEASE_TIME    5
+#define DHCP_LEASE_WORDS   6
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+dhcpState dhcpCurrentState = dhcpDisabled;
+uint32_t dhcpXid;
+uint32_t dhcpTimeout;
+uint32_t dhcpRetryTime;
+uint8_t dhcpTries;
+uint32_t dhcpLeaseStart;
+uint32_t dhcpLeaseTime;
+uint32_t dhcpT1;
+uint32_t dhcpT2;
+uint8_t dhcpIp[4];
+uint8_t dhcpServerIp[4];
+uint8_t dhcpMask[4];
+uint8_t dhcpRouter[4];
+uint8_t dhcpDnsIp[4];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint32_t dhcpPack(uint8_t ip[4])
+{
+    return ((uint32_t)ip[0] << 24) | ((uint32_t)ip[1] << 16) | ((uint32_t)ip[2] << 8) | ip[3];
+}
+
+void dhcpUnpack(uint32_t value, uint8_t ip[4])
+{
+    ip[0] = value >> 24;
+    ip[1] = value >> 16;
+    ip[2] = value >> 8;
+    ip[3] = value;
+}
+
+void dhcpCopy(uint8_t dest[4], uint8_t src[4])
+{
+    uint8_t i;
+    for (i = 0; i < 4; i++)
+        dest[i] = src[i];
+}
+
+// Elapsed lease time in seconds
+uint32_t dhcpElapsed()
+{
+    return (getTimerTicks() - dhcpLeaseStart) / 1000;
+}
+
+// Arms the retransmission timer, doubling the wait each time
+void dhcpArmRetry()
+{
+    dhcpTimeout = getTimerTicks() + dhcpRetryTime - 1000 + random32() % 2001;
+    if (dhcpRetryTime < DHCP_MAX_RETRY_TIME)
+        dhcpRetryTime *= 2;
+}
+
+// In RENEWING and REBINDING retransmit after half the time left, at least 60 s
+void dhcpArmLeaseRetry(uint32_t deadline)
+{
+    uint32_t wait = 60;
+    uint32_t elapsed = dhcpElapsed();
+    if (deadline > elapsed && (deadline - elapsed) / 2 > wait)
+        wait = (deadline - elapsed) / 2;
+    dhcpTimeout = getTimerTicks() + wait * 1000;
+}
+
+bool dhcpTimerExpired()
+{
+    return (int32_t)(getTimerTicks() - dhcpTimeout) >= 0;
+}
+
+// Builds a client message in place in ether and sends it
+// Broadcasts unless a bound client is renewing with its server
+void dhcpSend(etherHeader* ether, uint8_t type)
+{
+    uint8_t* data = etherGetUdpTxData(ether);
+    dhcpFrame* dhcp = (dhcpFrame*)data;
+    uint8_t* option;
+    uint8_t mac[6];
+    uint8_t broadcast[4] = {255, 255, 255, 255};
+    uint16_t i, length;
+    bool haveAddress = (dhcpCurrentState == dhcpRenewing || dhcpCurrentState == dhcpRebinding);
+
+    for (i = 0; i < DHCP_MIN_MESSAGE; i++)
+        data[i] = 0;
+    etherGetMacAddress(mac);
+    dhcp->op = 1;
+    dhcp->htype = 1;
+    dhcp->hlen = 6;
+    dhcp->xid = dhcpXid;
+    // servers must broadcast replies until we have an address to receive them on
+    dhcp->flags = haveAddress ? 0 : htons(0x8000);
+    if (haveAddress)
+        dhcpCopy(dhcp->ciaddr, dhcpIp);
+    for (i = 0; i < 6; i++)
+        dhcp->chaddr[i] = mac[i];
+    dhcp->magicCookie = htonl(DHCP_MAGIC_COOKIE);
+    option = dhcp->options;
+    *option++ = 53;
+    *option++ = 1;
+    *option++ = type;
+    // requested address in SELECTING and INIT-REBOOT, ciaddr carries it otherwise
+    if (type == DHCPREQUEST && !haveAddress)
+    {
+        *option++ = 50;
+        *option++ = 4;
+        for (i = 0; i < 4; i++)
+            *option++ = dhcpIp[i];
+    }
+    // server identifier only when answering an offer
+    if (type == DHCPREQUEST && dhcpCurrentState == dhcpRequesting)
+    {
+        *option++ = 54;
+        *option++ = 4;
+        for (i = 0; i < 4; i++)
+            *option++ = dhcpServerIp[i];
+    }
+    *option++ = 55;
+    *option++ = 6;
+    *option++ = 1;
+    *option++ = 3;
+    *option++ = 6;
+    *option++ = 51;
+    *option++ = 58;
+    *option++ = 59;
+    *option++ = 255;
+    length = option - data;
+    if (length < DHCP_MIN_MESSAGE)
+        length = DHCP_MIN_MESSAGE;
+    etherSendUdp(ether, DHCP_CLIENT_PORT, dhcpCurrentState == dhcpRenewing ? dhcpServerIp : broadcast,
+                 DHCP_SERVER_PORT, data, length);
+}
+
+// Gives up the address, used when the lease ends or is refused
+void dhcpDropAddress()
+{
+    etherSetIpAddress(0, 0, 0, 0);
+    dhcpCurrentState = dhcpInit;
+    dhcpTimeout = getTimerTicks();
+    dhcpRetryTime = DHCP_RETRY_TIME;
+}
+
+// Starts the client, from INIT-REBOOT if a lease was stored
+void initDhcp()
+{
+    uint32_t words[DHCP_LEASE_WORDS];
+    dhcpXid = random32();
+    dhcpRetryTime = DHCP_RETRY_TIME;
+    dhcpTries = 0;
+    dhcpTimeout = getTimerTicks() + random32() % DHCP_START_JITTER;
+    if (configGet(configDhcpLease, words, sizeof(words)) == sizeof(words))
+    {
+        dhcpUnpack(words[DHCP_LEASE_IP], dhcpIp);
+        dhcpUnpack(words[DHCP_LEASE_SERVER], dhcpServerIp);
+        dhcpUnpack(words[DHCP_LEASE_DNS], dhcpDnsIp);
+        dhcpCurrentState = dhcpInitReboot;
+    }
+    else
+        dhcpCurrentState = dhcpInit;
+}
+
+void dhcpStop()
+{
+    dhcpCurrentState = dhcpDisabled;
+}
+
+void dhcpForgetLease()
+{
+    configErase(configDhcpLease);
+}
+
+// Stores the lease if it changed, renewals normally write nothing
+void dhcpStoreLease()
+{
+    uint32_t words[DHCP_LEASE_WORDS];
+    words[DHCP_LEASE_IP] = dhcpPack(dhcpIp);
+    words[DHCP_LEASE_SERVER] = dhcpPack(dhcpServerIp);
+    words[DHCP_LEASE_MASK] = dhcpPack(dhcpMask);
+    words[DHCP_LEASE_ROUTER] = dhcpPack(dhcpRouter);
+    words[DHCP_LEASE_DNS] = dhcpPack(dhcpDnsIp);
+    words[DHCP_LEASE_TIME] = dhcpLeaseTime;
+    configSet(configDhcpLease, words, sizeof(words));
+}
+
+// Sends what the state and timers call for, ether is scratch space
+void dhcpService(etherHeader* ether)
+{
+    uint32_t elapsed;
+    switch (dhcpCurrentState)
+    {
+    case dhcpInit:
+        if (dhcpTimerExpired())
+        {
+            dhcpXid = random32();
+            dhcpRetryTime = DHCP_RETRY_TIME;
+            dhcpCurrentState = dhcpSelecting;
+            dhcpSend(ether, DHCPDISCOVER);
+            dhcpArmRetry();
+        }
+        break;
+    case dhcpSelecting:
+        if (dhcpTimerExpired())
+        {
+            dhcpSend(ether, DHCPDISCOVER);
+            dhcpArmRetry();
+        }
+        break;
+    case dhcpRequesting:
+        if (dhcpTimerExpired())
+        {
+            if (dhcpTries >= 4)
+                dhcpDropAddress();
+            else
+            {
+                dhcpTries++;
+                dhcpSend(ether, DHCPREQUEST);
+                dhcpArmRetry();
+            }
+        }
+        break;
+    case dhcpInitReboot:
+        if (dhcpTimerExpired())
+        {
+            dhcpTries = 1;
+            dhcpCurrentState = dhcpRebooting;
+            dhcpSend(ether, DHCPREQUEST);
+            dhcpArmRetry();
+        }
+        break;
+    case dhcpRebooting:
+        if (dhcpTimerExpired())
+        {
+            if (dhcpTries >= DHCP_REBOOT_TRIES)
+                dhcpDropAddress();
+            else
+            {
+                dhcpTries++;
+                dhcpSend(ether, DHCPREQUEST);
+                dhcpArmRetry();
+            }
+        }
+        break;
+    case dhcpBound:
+        if (dhcpElapsed() >= dhcpT1)
+        {
+            dhcpCurrentState = dhcpRenewing;
+            dhcpSend(ether, DHCPREQUEST);
+            dhcpArmLeaseRetry(dhcpT2);
+        }
+        break;
+    case dhcpRenewing:
+        elapsed = dhcpElapsed();
+        if (elapsed >= dhcpT2)
+        {
+            dhcpCurrentState = dhcpRebinding;
+            dhcpSend(ether, DHCPREQUEST);
+            dhcpArmLeaseRetry(dhcpLeaseTime);
+        }
+        else if (dhcpTimerExpired())
+        {
+            dhcpSend(ether, DHCPREQUEST);
+            dhcpArmLeaseRetry(dhcpT2);
+        }
+        break;
+    case dhcpRebinding:
+        if (dhcpElapsed() >= dhcpLeaseTime)
+            dhcpDropAddress();
+        else if (dhcpTimerExpired())
+        {
+            dhcpSend(ether, DHCPREQUEST);
+            dhcpArmLeaseRetry(dhcpLeaseTime);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Determines whether a UDP datagram is a DHCP reply for this client
+bool dhcpIsMessage(etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    udpHeader *udp = (udpHeader*)((uint8_t*)ip + ipHeaderLength);
+    dhcpFrame *dhcp = (dhcpFrame*)udp->data;
+    uint8_t mac[6];
+    uint8_t i;
+    bool ok;
+    ok = (dhcpCurrentState != dhcpDisabled && udp->destPort == htons(DHCP_CLIENT_PORT) && dhcp->op == 2
+            && dhcp->xid == dhcpXid && dhcp->magicCookie == htonl(DHCP_MAGIC_COOKIE));
+    etherGetMacAddress(mac);
+    for (i = 0; i < 6 && ok; i++)
+        ok = (dhcp->chaddr[i] == mac[i]);
+    return ok;
+}
+
+// Handles an OFFER, ACK or NAK, the reply (if any) reuses ether
+void dhcpProcess(etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    udpHeader *udp = (udpHeader*)((uint8_t*)ip + ipHeaderLength);
+    dhcpFrame *dhcp = (dhcpFrame*)udp->data;
+    uint8_t* option = dhcp->options;
+    uint8_t* end = udp->data + ntohs(udp->length) - 8;
+    uint8_t type = 0, code, length, i;
+    uint8_t server[4] = {0, 0, 0, 0};
+    uint8_t mask[4] = {255, 255, 255, 0};
+    uint8_t router[4] = {0, 0, 0, 0};
+    uint8_t dns[4] = {0, 0, 0, 0};
+    uint32_t lease = 0, t1 = 0, t2 = 0;
+
+    while (option < end && *option != 255)
+    {
+        code = *option++;
+        if (code == 0)
+            continue;
+        length = *option++;
+        if (option + length > end)
+            break;
+        if (code == 53)
+            type = option[0];
+        else if (code == 54 && length >= 4)
+            dhcpCopy(server, option);
+        else if (code == 1 && length >= 4)
+            dhcpCopy(mask, option);
+        else if (code == 3 && length >= 4)
+            dhcpCopy(router, option);
+        else if (code == 6 && length >= 4)
+            dhcpCopy(dns, option);
+        else if ((code == 51 || code == 58 || code == 59) && length >= 4)
+        {
+            uint32_t value = ((uint32_t)option[0] << 24) | ((uint32_t)option[1] << 16) | ((uint32_t)option[2] << 8) | option[3];
+            if (code == 51)
+                lease = value;
+            else if (code == 58)
+                t1 = value;
+            else
+                t2 = value;
+        }
+        option += length;
+    }
+
+    if (type == DHCPOFFER && dhcpCurrentState == dhcpSelecting)
+    {
+        dhcpCopy(dhcpIp, dhcp->yiaddr);
+        dhcpCopy(dhcpServerIp, server);
+        dhcpCurrentState = dhcpRequesting;
+        dhcpRetryTime = DHCP_RETRY_TIME;
+        dhcpTries = 1;
+        dhcpSend(ether, DHCPREQUEST);
+        dhcpArmRetry();
+    }
+    else if (type == DHCPACK && (dhcpCurrentState == dhcpRequesting || dhcpCurrentState == dhcpRebooting
+            || dhcpCurrentState == dhcpRenewing || dhcpCurrentState == dhcpRebinding))
+    {
+        dhcpCopy(dhcpIp, dhcp->yiaddr);
+        if (server[0] | server[1] | server[2] | server[3])
+            dhcpCopy(dhcpServerIp, server);
+        dhcpCopy(dhcpMask, mask);
+        dhcpCopy(dhcpRouter, router);
+        dhcpCopy(dhcpDnsIp, dns);
+        if (lease == 0 || lease > DHCP_MAX_LEASE)
+            lease = DHCP_MAX_LEASE;
+        dhcpLeaseTime = lease;
+        dhcpT1 = (t1 != 0 && t1 < lease) ? t1 : lease / 2;
+        dhcpT2 = (t2 != 0 && t2 < lease && t2 > dhcpT1) ? t2 : lease - lease / 8;
+        dhcpLeaseStart = getTimerTicks();
+        etherSetIpAddress(dhcpIp[0], dhcpIp[1], dhcpIp[2], dhcpIp[3]);
+        etherSetIpSubnetMask(dhcpMask[0], dhcpMask[1], dhcpMask[2], dhcpMask[3]);
+        if (router[0] | router[1] | router[2] | router[3])
+            etherSetIpGatewayAddress(dhcpRouter[0], dhcpRouter[1], dhcpRouter[2], dhcpRouter[3]);
+        dhcpCurrentState = dhcpBound;
+        dhcpStoreLease();
+    }
+    else if (type == DHCPNAK && dhcpCurrentState != dhcpSelecting && dhcpCurrentState != dhcpBound)
+    {
+        // the stored lease is no good here any more
+        dhcpForgetLease();
+        for (i = 0; i < 4; i++)
+            dhcpIp[i] = 0;
+        dhcpDropAddress();
+    }
+}
+
+dhcpState dhcpGetState()
+{
+    return dhcpCurrentState;
+}
+
+bool dhcpIsBound()
+{
+    return dhcpCurrentState == dhcpBound || dhcpCurrentState == dhcpRenewing || dhcpCurrentState == dhcpRebinding;
+}
+
+// Seconds until the lease ends, 0 when not bound
+uint32_t dhcpGetLeaseRemaining()
+{
+    uint32_t elapsed;
+    if (!dhcpIsBound())
+        return 0;
+    elapsed = dhcpElapsed();
+    return elapsed < dhcpLeaseTime ? dhcpLeaseTime - elapsed : 0;
+}
+
+void dhcpGetServer(uint8_t ip[4])
+{
+    dhcpCopy(ip, dhcpServerIp);
+}
+
+void dhcpGetDnsServer(uint8_t ip[4])
+{
+    dhcpCopy(ip, dhcpDnsIp);
+}
@@ -0,0 +1,64 @@
+// DHCP Library
+// DHCP client with the lease kept in EEPROM for INIT-REBOOT
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef DHCP_H_
+#define DHCP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "eth0.h"
+
+#define DHCP_CLIENT_PORT     68
+#define DHCP_SERVER_PORT     67
+// First retransmission timeout, doubled up to the maximum (ms)
+#define DHCP_RETRY_TIME      4000
+#define DHCP_MAX_RETRY_TIME  64000
+// INIT-REBOOT requests before falling back to DISCOVER
+#define DHCP_REBOOT_TRIES    2
+// Random delay before the first message so a fleet does not boot in step (ms)
+#define DHCP_START_JITTER    2000
+// Longest lease honored, keeps lease arithmetic inside the ms tick (s)
+#define DHCP_MAX_LEASE       2000000
+
+typedef enum _dhcpState
+{
+    dhcpDisabled = 0,
+    dhcpInit = 1,
+    dhcpSelecting = 2,
+    dhcpRequesting = 3,
+    dhcpInitReboot = 4,
+    dhcpRebooting = 5,
+    dhcpBound = 6,
+    dhcpRenewing = 7,
+    dhcpRebinding = 8
+} dhcpState;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initDhcp();
+void dhcpStop();
+void dhcpService(etherHeader* ether);
+bool dhcpIsMessage(etherHeader* ether);
+void dhcpProcess(etherHeader* ether);
+dhcpState dhcpGetState();
+bool dhcpIsBound();
+uint32_t dhcpGetLeaseRemaining();
+void dhcpGetServer(uint8_t ip[4]);
+void dhcpGetDnsServer(uint8_t ip[4]);
+void dhcpForgetLease();
+
+#endif
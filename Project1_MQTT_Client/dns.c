@@ -0,0 +1,397 @@
+// DNS Library
+// Stub resolver with a TTL cache for broker hostnames
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// dnsLookup() never waits: it answers from the cache or starts a query
+// and returns dnsPending, and the caller asks again on a later pass.
+// dnsService() (re)sends queries and dnsProcess() takes the responses.
+// Answers are cached for their TTL, clamped to DNS_MIN_TTL..DNS_MAX_TTL.
+// NXDOMAIN and empty answers are cached too (RFC 2308), for the SOA minimum
+// when the server includes one, so a bad name is not queried every pass.
+// A query that times out or gets SERVFAIL is reported once and not cached.
+// Each query uses a random ID and source port.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dns.h"
+#include "dhcp.h"
+#include "eth0.h"
+#include "timer.h"
+
+typedef enum _dnsEntryState
+{
+    dnsEntryFree = 0,
+    dnsEntryPending = 1,
+    dnsEntryPositive = 2,
+    dnsEntryNegative = 3,
+    dnsEntryFailed = 4
+} dnsEntryState;
+
+typedef struct _dnsEntry
+{
+    char name[DNS_NAME_LENGTH];
+    uint8_t ip[4];
+    uint8_t state;
+    uint8_t tries;
+    uint16_t id;
+    uint16_t port;
+    uint32_t time;                  // expiry when cached, last send when pending
+} dnsEntry;
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+dnsEntry dnsCache[DNS_CACHE_SIZE];
+uint8_t dnsServerIp[4] = {0, 0, 0, 0};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initDns()
+{
+    uint8_t i;
+    for (i = 0; i < DNS_CACHE_SIZE; i++)
+        dnsCache[i].state = dnsEntryFree;
+}
+
+// Sets the server to query, 0.0.0.0 uses the one DHCP provided
+void dnsSetServer(uint8_t ip[4])
+{
+    uint8_t i;
+    for (i = 0; i < 4; i++)
+        dnsServerIp[i] = ip[i];
+}
+
+void dnsGetServer(uint8_t ip[4])
+{
+    uint8_t i;
+    if ((dnsServerIp[0] | dnsServerIp[1] | dnsServerIp[2] | dnsServerIp[3]) == 0)
+        dhcpGetDnsServer(ip);
+    else
+        for (i = 0; i < 4; i++)
+            ip[i] = dnsServerIp[i];
+}
+
+// Hostnames compare without regard to case
+bool dnsNameMatches(char* a, char* b)
+{
+    uint8_t i = 0;
+    char ca, cb;
+    do
+    {
+        ca = a[i];
+        cb = b[i];
+        if (ca >= 'A' && ca <= 'Z')
+            ca += 32;
+        if (cb >= 'A' && cb <= 'Z')
+            cb += 32;
+        if (ca != cb)
+            return false;
+        i++;
+    } while (ca != '\0');
+    return true;
+}
+
+int8_t dnsFind(char* name)
+{
+    uint8_t i;
+    for (i = 0; i < DNS_CACHE_SIZE; i++)
+        if (dnsCache[i].state != dnsEntryFree && dnsNameMatches(dnsCache[i].name, name))
+            return i;
+    return -1;
+}
+
+bool dnsExpired(dnsEntry* entry)
+{
+    return (int32_t)(getTimerTicks() - entry->time) >= 0;
+}
+
+// Takes a free or expired entry, else the cached one closest to expiring
+int8_t dnsAllocate()
+{
+    uint8_t i;
+    int8_t victim = -1;
+    for (i = 0; i < DNS_CACHE_SIZE; i++)
+    {
+        if (dnsCache[i].state == dnsEntryFree
+                || ((dnsCache[i].state == dnsEntryPositive || dnsCache[i].state == dnsEntryNegative) && dnsExpired(&dnsCache[i])))
+            return i;
+        if ((dnsCache[i].state == dnsEntryPositive || dnsCache[i].state == dnsEntryNegative)
+                && (victim < 0 || (int32_t)(dnsCache[i].time - dnsCache[victim].time) < 0))
+            victim = i;
+    }
+    return victim;
+}
+
+// Returns dnsFound with ip filled in, dnsPending while a query is out,
+// or dnsFailed if the name does not exist or the server did not answer
+dnsResult dnsLookup(char* name, uint8_t ip[4])
+{
+    int8_t entry = dnsFind(name);
+    uint8_t i;
+    if (entry >= 0)
+    {
+        dnsEntry* e = &dnsCache[entry];
+        if (e->state == dnsEntryPending)
+            return dnsPending;
+        if (e->state == dnsEntryFailed)
+        {
+            e->state = dnsEntryFree;
+            return dnsFailed;
+        }
+        if (!dnsExpired(e))
+        {
+            if (e->state == dnsEntryNegative)
+                return dnsFailed;
+            for (i = 0; i < 4; i++)
+                ip[i] = e->ip[i];
+            return dnsFound;
+        }
+    }
+    else
+    {
+        entry = dnsAllocate();
+        if (entry < 0)
+            return dnsFailed;
+        for (i = 0; i < DNS_NAME_LENGTH - 1 && name[i] != '\0'; i++)
+            dnsCache[entry].name[i] = name[i];
+        dnsCache[entry].name[i] = '\0';
+    }
+    // dnsService sends the query on its next pass
+    dnsCache[entry].state = dnsEntryPending;
+    dnsCache[entry].tries = 0;
+    dnsCache[entry].time = getTimerTicks() - DNS_RETRY_TIME;
+    return dnsPending;
+}
+
+// Forgets the cached answer for name, the next lookup queries again
+void dnsFlush(char* name)
+{
+    int8_t entry = dnsFind(name);
+    if (entry >= 0 && dnsCache[entry].state != dnsEntryPending)
+        dnsCache[entry].state = dnsEntryFree;
+}
+
+// Builds a query for entry in place in ether and sends it
+void dnsSendQuery(etherHeader* ether, dnsEntry* entry)
+{
+    uint8_t* data = etherGetUdpTxData(ether);
+    uint8_t* length;
+    uint8_t server[4];
+    uint16_t offset = 12;
+    uint8_t i;
+    data[0] = entry->id >> 8;
+    data[1] = entry->id;
+    data[2] = 0x01;                 // recursion desired
+    data[3] = 0x00;
+    data[4] = 0x00;
+    data[5] = 0x01;                 // one question
+    for (i = 6; i < 12; i++)
+        data[i] = 0;
+    // www.example.com goes out as 3www7example3com0
+    length = &data[offset++];
+    *length = 0;
+    for (i = 0; entry->name[i] != '\0'; i++)
+    {
+        if (entry->name[i] == '.')
+        {
+            length = &data[offset++];
+            *length = 0;
+        }
+        else
+        {
+            data[offset++] = entry->name[i];
+            (*length)++;
+        }
+    }
+    data[offset++] = 0;
+    data[offset++] = 0x00;
+    data[offset++] = 0x01;          // type A
+    data[offset++] = 0x00;
+    data[offset++] = 0x01;          // class IN
+    dnsGetServer(server);
+    etherSendUdp(ether, entry->port, server, DNS_SERVER_PORT, data, offset);
+}
+
+// Sends and repeats queries, ether is scratch space
+void dnsService(etherHeader* ether)
+{
+    uint8_t i;
+    dnsEntry* e;
+    for (i = 0; i < DNS_CACHE_SIZE; i++)
+    {
+        e = &dnsCache[i];
+        if (e->state == dnsEntryPending && getTimerTicks() - e->time >= DNS_RETRY_TIME)
+        {
+            if (e->tries >= DNS_MAX_TRIES)
+            {
+                e->state = dnsEntryFailed;
+                continue;
+            }
+            e->tries++;
+            e->id = random32();
+            e->port = 49152 + random32() % 16384;
+            e->time = getTimerTicks();
+            dnsSendQuery(ether, e);
+            // one query per call keeps the scratch frame simple
+            return;
+        }
+    }
+}
+
+// Determines whether a UDP datagram answers one of our queries
+bool dnsIsMessage(etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    udpHeader *udp = (udpHeader*)((uint8_t*)ip + ipHeaderLength);
+    uint8_t i;
+    if (udp->sourcePort != htons(DNS_SERVER_PORT))
+        return false;
+    for (i = 0; i < DNS_CACHE_SIZE; i++)
+        if (dnsCache[i].state == dnsEntryPending && udp->destPort == htons(dnsCache[i].port))
+            return true;
+    return false;
+}
+
+// Steps over a possibly compressed name, returns 0 if it runs past end
+uint8_t* dnsSkipName(uint8_t* p, uint8_t* end)
+{
+    while (p < end)
+    {
+        if (*p == 0)
+            return p + 1;
+        if ((*p & 0xC0) == 0xC0)
+            return p + 2;
+        p += *p + 1;
+    }
+    return 0;
+}
+
+uint32_t dnsRead32(uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Caches the answer to a pending query
+void dnsProcess(etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    udpHeader *udp = (udpHeader*)((uint8_t*)ip + ipHeaderLength);
+    uint8_t* data = udp->data;
+    uint8_t* end = udp->data + ntohs(udp->length) - 8;
+    uint8_t* p;
+    dnsEntry* e = 0;
+    uint16_t id, questions, answers, authorities, type, rdLength;
+    uint32_t ttl, negativeTtl = DNS_NEGATIVE_TTL;
+    uint8_t rcode, i;
+    bool found = false;
+
+    if (end - data < 12)
+        return;
+    id = (data[0] << 8) | data[1];
+    for (i = 0; i < DNS_CACHE_SIZE; i++)
+        if (dnsCache[i].state == dnsEntryPending && dnsCache[i].id == id && udp->destPort == htons(dnsCache[i].port))
+            e = &dnsCache[i];
+    if (e == 0 || (data[2] & 0x80) == 0)
+        return;
+    rcode = data[3] & 0x0F;
+    questions = (data[4] << 8) | data[5];
+    answers = (data[6] << 8) | data[7];
+    authorities = (data[8] << 8) | data[9];
+
+    p = &data[12];
+    while (p != 0 && questions > 0)
+    {
+        questions--;
+        p = dnsSkipName(p, end);
+        if (p != 0)
+            p += 4;
+    }
+    // first A record wins, any CNAMEs ahead of it are stepped over
+    while (p != 0 && answers > 0 && !found)
+    {
+        answers--;
+        p = dnsSkipName(p, end);
+        if (p == 0 || p + 10 > end)
+            break;
+        type = (p[0] << 8) | p[1];
+        ttl = dnsRead32(&p[4]);
+        rdLength = (p[8] << 8) | p[9];
+        p += 10;
+        if (p + rdLength > end)
+            break;
+        if (type == 1 && rdLength == 4)
+        {
+            for (i = 0; i < 4; i++)
+                e->ip[i] = p[i];
+            found = true;
+        }
+        p += rdLength;
+    }
+    if (rcode == 0 && found)
+    {
+        if (ttl < DNS_MIN_TTL)
+            ttl = DNS_MIN_TTL;
+        if (ttl > DNS_MAX_TTL)
+            ttl = DNS_MAX_TTL;
+        e->state = dnsEntryPositive;
+        e->time = getTimerTicks() + ttl * 1000;
+    }
+    else if (rcode == 0 || rcode == 3)
+    {
+        // negative answers live for the smaller of the SOA TTL and SOA minimum
+        while (p != 0 && answers > 0)
+        {
+            answers--;
+            p = dnsSkipName(p, end);
+            if (p == 0 || p + 10 > end)
+                p = 0;
+            else
+                p += 10 + ((p[8] << 8) | p[9]);
+        }
+        while (p != 0 && authorities > 0)
+        {
+            authorities--;
+            p = dnsSkipName(p, end);
+            if (p == 0 || p + 10 > end)
+                break;
+            type = (p[0] << 8) | p[1];
+            ttl = dnsRead32(&p[4]);
+            rdLength = (p[8] << 8) | p[9];
+            p += 10;
+            if (p + rdLength > end)
+                break;
+            if (type == 6 && rdLength >= 20)
+            {
+                negativeTtl = dnsRead32(p + rdLength - 4);
+                if (ttl < negativeTtl)
+                    negativeTtl = ttl;
+                break;
+            }
+            p += rdLength;
+        }
+        if (negativeTtl < DNS_MIN_TTL)
+            negativeTtl = DNS_MIN_TTL;
+        if (negativeTtl > DNS_MAX_TTL)
+            negativeTtl = DNS_MAX_TTL;
+        e->state = dnsEntryNegative;
+        e->time = getTimerTicks() + negativeTtl * 1000;
+    }
+    else
+        e->state = dnsEntryFailed;
+}
@@ -0,0 +1,56 @@
+// DNS Library
+// Stub resolver with a TTL cache for broker hostnames
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef DNS_H_
+#define DNS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "eth0.h"
+
+#define DNS_SERVER_PORT   53
+#define DNS_CACHE_SIZE    4
+// Longest hostname, including the terminating null
+#define DNS_NAME_LENGTH   60
+// Query timeout and attempts before giving up (ms)
+#define DNS_RETRY_TIME    2000
+#define DNS_MAX_TRIES     3
+// Bounds on how long answers are cached (s)
+#define DNS_MIN_TTL       5
+#define DNS_MAX_TTL       86400
+// Negative answer lifetime when the server sends no SOA (s)
+#define DNS_NEGATIVE_TTL  60
+
+typedef enum _dnsResult
+{
+    dnsFound = 0,
+    dnsPending = 1,
+    dnsFailed = 2
+} dnsResult;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initDns();
+void dnsSetServer(uint8_t ip[4]);
+void dnsGetServer(uint8_t ip[4]);
+dnsResult dnsLookup(char* name, uint8_t ip[4]);
+void dnsFlush(char* name);
+void dnsService(etherHeader* ether);
+bool dnsIsMessage(etherHeader* ether);
+void dnsProcess(etherHeader* ether);
+
+#endif
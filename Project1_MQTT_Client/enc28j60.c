@@ -0,0 +1,644 @@
+// ENC28J60 Library
+// Jason Losh
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL w/ ENC28J60
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// ENC28J60 Ethernet controller on SPI0
+//   MOSI (SSI0Tx) on PA5
+//   MISO (SSI0Rx) on PA4
+//   SCLK (SSI0Clk) on PA2
+//   ~CS (SW controlled) on PA3
+//   WOL on PB3
+//   INT on PC6
+
+// The controller side of eth0.h: frames in and out of the ENC28J60 buffer
+// memory.  eth0.c builds and parses frames on top of these calls only, and
+// host/enc28j60.c provides the same calls over a TAP device or a capture.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "eth0.h"
+#include "wait.h"
+#include "gpio.h"
+#include "spi0.h"
+#include "sched.h"
+#include "boot.h"
+
+// Pins
+#define CS PORTA,3
+#define WOL PORTB,3
+#define INT PORTC,6
+
+// Ether registers
+#define ERDPTL      0x00
+#define ERDPTH      0x01
+#define EWRPTL      0x02
+#define EWRPTH      0x03
+#define ETXSTL      0x04
+#define ETXSTH      0x05
+#define ETXNDL      0x06
+#define ETXNDH      0x07
+#define ERXSTL      0x08
+#define ERXSTH      0x09
+#define ERXNDL      0x0A
+#define ERXNDH      0x0B
+#define ERXRDPTL    0x0C
+#define ERXRDPTH    0x0D
+#define ERXWRPTL    0x0E
+#define ERXWRPTH    0x0F
+#define EDMASTL     0x10
+#define EDMASTH     0x11
+#define EDMANDL     0x12
+#define EDMANDH     0x13
+#define EDMADSTL    0x14
+#define EDMADSTH    0x15
+#define EIE         0x1B
+#define INTIE   0x80
+#define PKTIE   0x40
+#define TXIE    0x08
+#define EIR         0x1C
+#define RXERIF  0x01
+#define TXERIF  0x02
+#define TXIF    0x08
+#define PKTIF   0x40
+#define ESTAT       0x1D
+#define CLKRDY  0x01
+#define TXABORT 0x02
+#define ECON2       0x1E
+#define PKTDEC  0x40
+#define ECON1       0x1F
+#define RXEN    0x04
+#define TXRTS   0x08
+#define CSUMEN  0x10
+#define DMAST   0x20
+#define ERXFCON     0x38
+#define EPKTCNT     0x39
+#define MACON1      0x40
+#define MARXEN  0x01
+#define RXPAUS  0x04
+#define TXPAUS  0x08
+#define MACON2      0x41
+#define MARST   0x80
+#define MACON3      0x42
+#define FULDPX  0x01
+#define FRMLNEN 0x02
+#define TXCRCEN 0x10
+#define PAD60   0x20
+#define MACON4      0x43
+#define MABBIPG     0x44
+#define MAIPGL      0x46
+#define MAIPGH      0x47
+#define MACLCON1    0x48
+#define MACLCON2    0x49
+#define MAMXFLL     0x4A
+#define MAMXFLH     0x4B
+#define MICMD       0x52
+#define MIIRD   0x01
+#define MIREGADR    0x54
+#define MIWRL       0x56
+#define MIWRH       0x57
+#define MIRDL       0x58
+#define MIRDH       0x59
+#define MAADR1      0x60
+#define MAADR0      0x61
+#define MAADR3      0x62
+#define MAADR2      0x63
+#define MAADR5      0x64
+#define MAADR4      0x65
+#define MISTAT      0x6A
+#define MIBUSY  0x01
+#define ECOCON      0x75
+
+// Ether phy registers
+#define PHCON1      0x00
+#define PDPXMD 0x0100
+#define PHSTAT1     0x01
+#define LSTAT  0x0400
+#define PHCON2      0x10
+#define HDLDIS 0x0100
+#define PHLCON      0x14
+
+// ------------------------------------------------------------------------------
+//  Globals
+// ------------------------------------------------------------------------------
+
+uint8_t nextPacketLsb = 0x00;
+uint8_t nextPacketMsb = 0x00;
+uint16_t rxFrameAddress = 0;            // start of the frame being read in the rx buffer
+uint16_t rxFrameSize = 0;
+uint16_t rxFrameRead = 0;
+uint16_t txAbortCount = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Buffer is configured as follows
+// Receive buffer starts at 0x0000 (bottom 6666 bytes of 8K space)
+// Transmit buffer at 01A0A (top 1526 bytes of 8K space)
+
+void etherCsOn()
+{
+    setPinValue(CS, 0);
+    _delay_cycles(4);                    // allow line to settle
+}
+
+void etherCsOff()
+{
+    setPinValue(CS, 1);
+}
+
+void etherWriteReg(uint8_t reg, uint8_t data)
+{
+    etherCsOn();
+    writeSpi0Data(0x40 | (reg & 0x1F));
+    readSpi0Data();
+    writeSpi0Data(data);
+    readSpi0Data();
+    etherCsOff();
+}
+
+uint8_t etherReadReg(uint8_t reg)
+{
+    uint8_t data;
+    etherCsOn();
+    writeSpi0Data(0x00 | (reg & 0x1F));
+    readSpi0Data();
+    writeSpi0Data(0);
+    data = readSpi0Data();
+    etherCsOff();
+    return data;
+}
+
+void etherSetReg(uint8_t reg, uint8_t mask)
+{
+    etherCsOn();
+    writeSpi0Data(0x80 | (reg & 0x1F));
+    readSpi0Data();
+    writeSpi0Data(mask);
+    readSpi0Data();
+    etherCsOff();
+}
+
+void etherClearReg(uint8_t reg, uint8_t mask)
+{
+    etherCsOn();
+    writeSpi0Data(0xA0 | (reg & 0x1F));
+    readSpi0Data();
+    writeSpi0Data(mask);
+    readSpi0Data();
+    etherCsOff();
+}
+
+void etherSetBank(uint8_t reg)
+{
+    etherClearReg(ECON1, 0x03);
+    etherSetReg(ECON1, reg >> 5);
+}
+
+void etherWritePhy(uint8_t reg, uint16_t data)
+{
+    etherSetBank(MIREGADR);
+    etherWriteReg(MIREGADR, reg);
+    etherWriteReg(MIWRL, data & 0xFF);
+    etherWriteReg(MIWRH, (data >> 8) & 0xFF);
+}
+
+uint16_t etherReadPhy(uint8_t reg)
+{
+    uint16_t data, dataH;
+    etherSetBank(MIREGADR);
+    etherWriteReg(MIREGADR, reg);
+    etherWriteReg(MICMD, MIIRD);
+    waitMicrosecond(11);
+    etherSetBank(MISTAT);
+    while ((etherReadReg(MISTAT) & MIBUSY) != 0);
+    etherSetBank(MICMD);
+    etherWriteReg(MICMD, 0);
+    data = etherReadReg(MIRDL);
+    dataH = etherReadReg(MIRDH);
+    data |= (dataH << 8);
+    return data;
+}
+
+void etherWriteMemStart()
+{
+    etherCsOn();
+    writeSpi0Data(0x7A);
+    readSpi0Data();
+}
+
+void etherWriteMem(uint8_t data)
+{
+    writeSpi0Data(data);
+    readSpi0Data();
+}
+
+void etherWriteMemStop()
+{
+    etherCsOff();
+}
+
+void etherReadMemStart()
+{
+    etherCsOn();
+    writeSpi0Data(0x3A);
+    readSpi0Data();
+}
+
+uint8_t etherReadMem()
+{
+    writeSpi0Data(0);
+    return readSpi0Data();
+}
+
+void etherReadMemStop()
+{
+    etherCsOff();
+}
+
+// Sets up SPI0 and the control pins, call early so the rest of the boot
+// overlaps the ENC28J60 oscillator start-up timer
+void etherStart()
+{
+    // Initialize SPI0
+    initSpi0(USE_SSI0_RX);
+    setSpi0BaudRate(4e6, 40e6);
+    setSpi0Mode(0, 0);
+
+    // Enable clocks
+    enablePort(PORTA);
+    enablePort(PORTB);
+    enablePort(PORTC);
+
+    // Configure pins for ethernet module
+    selectPinPushPullOutput(CS);
+    selectPinDigitalInput(WOL);
+    selectPinDigitalInput(INT);
+}
+
+// Returns true once the oscillator start-up timer has expired
+bool etherIsClockReady()
+{
+    return (etherReadReg(ESTAT) & CLKRDY) != 0;
+}
+
+// Initializes ethernet device, after etherStart()
+// Uses order suggested in Chapter 6 of datasheet except 6.4 OST which is first here
+// The PHY LEDs are left flashing until etherEndLedTest()
+void etherInit(uint16_t mode)
+{
+    uint8_t mac[6];
+
+    // make sure that oscillator start-up timer has expired
+    while (!etherIsClockReady()) {}
+    bootMark(bootEtherClock);
+
+    // disable transmission and reception of packets
+    etherClearReg(ECON1, RXEN);
+    etherClearReg(ECON1, TXRTS);
+
+    // initialize receive buffer space
+    etherSetBank(ERXSTL);
+    etherWriteReg(ERXSTL, LOBYTE(0x0000));
+    etherWriteReg(ERXSTH, HIBYTE(0x0000));
+    etherWriteReg(ERXNDL, LOBYTE(0x1A09));
+    etherWriteReg(ERXNDH, HIBYTE(0x1A09));
+   
+    // initialize receiver write and read ptrs
+    // at startup, will write from 0 to 1A08 only and will not overwrite rd ptr
+    etherWriteReg(ERXWRPTL, LOBYTE(0x0000));
+    etherWriteReg(ERXWRPTH, HIBYTE(0x0000));
+    etherWriteReg(ERXRDPTL, LOBYTE(0x1A09));
+    etherWriteReg(ERXRDPTH, HIBYTE(0x1A09));
+    etherWriteReg(ERDPTL, LOBYTE(0x0000));
+    etherWriteReg(ERDPTH, HIBYTE(0x0000));
+
+    // setup receive filter
+    // always check CRC, use OR mode
+    etherSetBank(ERXFCON);
+    etherWriteReg(ERXFCON, (mode | ETHER_CHECKCRC) & 0xFF);
+
+    // bring mac out of reset
+    etherSetBank(MACON2);
+    etherWriteReg(MACON2, 0);
+  
+    // enable mac rx, enable pause control for full duplex
+    etherWriteReg(MACON1, TXPAUS | RXPAUS | MARXEN);
+
+    // enable padding to 60 bytes (no runt packets)
+    // add crc to tx packets, set full or half duplex
+    if ((mode & ETHER_FULLDUPLEX) != 0)
+        etherWriteReg(MACON3, FULDPX | FRMLNEN | TXCRCEN | PAD60);
+    else
+        etherWriteReg(MACON3, FRMLNEN | TXCRCEN | PAD60);
+
+    // leave MACON4 as reset
+
+    // set maximum rx packet size
+    etherWriteReg(MAMXFLL, LOBYTE(1518));
+    etherWriteReg(MAMXFLH, HIBYTE(1518));
+
+    // set back-to-back inter-packet gap to 9.6us
+    if ((mode & ETHER_FULLDUPLEX) != 0)
+        etherWriteReg(MABBIPG, 0x15);
+    else
+        etherWriteReg(MABBIPG, 0x12);
+
+    // set non-back-to-back inter-packet gap registers
+    etherWriteReg(MAIPGL, 0x12);
+    etherWriteReg(MAIPGH, 0x0C);
+
+    // leave collision window MACLCON2 as reset
+
+    // setup mac address
+    etherGetMacAddress(mac);
+    etherSetBank(MAADR0);
+    etherWriteReg(MAADR5, mac[0]);
+    etherWriteReg(MAADR4, mac[1]);
+    etherWriteReg(MAADR3, mac[2]);
+    etherWriteReg(MAADR2, mac[3]);
+    etherWriteReg(MAADR1, mac[4]);
+    etherWriteReg(MAADR0, mac[5]);
+
+    // initialize phy duplex
+    if ((mode & ETHER_FULLDUPLEX) != 0)
+        etherWritePhy(PHCON1, PDPXMD);
+    else
+        etherWritePhy(PHCON1, 0);
+
+    // disable phy loopback if in half-duplex mode
+    etherWritePhy(PHCON2, HDLDIS);
+
+    // Flash LEDA and LEDB
+    etherWritePhy(PHLCON, 0x0880);
+
+    // enable reception
+    etherSetReg(ECON1, RXEN);
+
+    // INT is held low while a frame is waiting or a transmission has finished
+    etherWriteReg(EIE, INTIE | PKTIE | TXIE);
+    selectPinInterruptLowLevel(INT);
+    NVIC_EN0_R |= 1 << (INT_GPIOC-16);               // turn-on interrupt 18 (GPIOC)
+    enablePinInterrupt(INT);
+}
+
+// Ends the LED flash started by etherInit()
+void etherEndLedTest()
+{
+    // set LEDA (link status) and LEDB (tx/rx activity)
+    // stretch LED on to 40ms (default)
+    etherWritePhy(PHLCON, 0x0472);
+}
+
+// INT is level sensitive, so the pin interrupt is masked here until the
+// network handler has serviced the controller and calls etherEnableInterrupt()
+void etherIsr()
+{
+    disablePinInterrupt(INT);
+    schedPost(schedNetwork);
+}
+
+void etherEnableInterrupt()
+{
+    enablePinInterrupt(INT);
+}
+
+// Returns true if link is up
+bool etherIsLinkUp()
+{
+    return (etherReadPhy(PHSTAT1) & LSTAT) != 0;
+}
+
+// Returns TRUE if packet received
+bool etherIsDataAvailable()
+{
+    return ((etherReadReg(EIR) & PKTIF) != 0);
+}
+
+// Returns true once after each transmission finishes, counting those that were aborted
+bool etherIsTxDone()
+{
+    if ((etherReadReg(EIR) & TXIF) == 0)
+        return false;
+    etherClearReg(EIR, TXIF);
+    if ((etherReadReg(ESTAT) & TXABORT) != 0)
+        txAbortCount++;
+    return true;
+}
+
+uint16_t etherGetTxAbortCount()
+{
+    return txAbortCount;
+}
+
+// Returns true if rx buffer overflowed after correcting the problem
+bool etherIsOverflow()
+{
+    bool err;
+    err = (etherReadReg(EIR) & RXERIF) != 0;
+    if (err)
+        etherClearReg(EIR, RXERIF);
+    return err;
+}
+
+// Starts reading the next packet, copying up to peekSize bytes to the data buffer
+// Returns the full size of the frame, the rest stays in the rx buffer
+uint16_t etherPeekPacket(etherHeader *ether, uint16_t peekSize)
+{
+    uint16_t i = 0, tmp16, status;
+    uint8_t *packet = (uint8_t*)ether;
+
+    // frame follows the 6 byte header at the previous next packet pointer
+    rxFrameAddress = ((nextPacketMsb << 8) | nextPacketLsb) + 6;
+    if (rxFrameAddress > 0x1A09)
+        rxFrameAddress -= 0x1A0A;
+
+    // enable read from FIFO buffers
+    etherReadMemStart();
+
+    // get next packet information
+    nextPacketLsb = etherReadMem();
+    nextPacketMsb = etherReadMem();
+
+    // calc size
+    // don't return crc, instead return size + status, so size is correct
+    rxFrameSize = etherReadMem();
+    tmp16 = etherReadMem();
+    rxFrameSize |= (tmp16 << 8);
+
+    // get status (currently unused)
+    status = etherReadMem();
+    tmp16 = etherReadMem();
+    status |= (tmp16 << 8);
+
+    // copy data
+    if (peekSize > rxFrameSize)
+        peekSize = rxFrameSize;
+    while (i < peekSize)
+        packet[i++] = etherReadMem();
+    rxFrameRead = peekSize;
+
+    // end read from FIFO buffers
+    etherReadMemStop();
+
+    return rxFrameSize;
+}
+
+// Releases the packet being read back to the rx buffer
+void etherDiscardPacket()
+{
+    // advance read pointer
+    etherSetBank(ERXRDPTL);
+    etherWriteReg(ERXRDPTL, nextPacketLsb); // hw ptr
+    etherWriteReg(ERXRDPTH, nextPacketMsb);
+    etherWriteReg(ERDPTL, nextPacketLsb);   // dma rd ptr
+    etherWriteReg(ERDPTH, nextPacketMsb);
+
+    // decrement packet counter so that PKTIF is maintained correctly
+    etherSetReg(ECON2, PKTDEC);
+}
+
+// Copies the rest of a peeked packet, up to max_size bytes in total, and releases it
+// Returns number of bytes copied to buffer
+uint16_t etherFinishPacket(etherHeader *ether, uint16_t maxSize)
+{
+    uint16_t i = rxFrameRead, size = rxFrameSize;
+    uint8_t *packet = (uint8_t*)ether;
+
+    // read pointer was left just past the peeked bytes
+    if (size > maxSize)
+        size = maxSize;
+    if (i < size)
+    {
+        etherReadMemStart();
+        while (i < size)
+            packet[i++] = etherReadMem();
+        etherReadMemStop();
+    }
+    etherDiscardPacket();
+    return size;
+}
+
+// Returns up to max_size characters in data buffer
+// Returns number of bytes copied to buffer
+// Contents written are 16-bit size, 16-bit status, payload excl crc
+uint16_t etherGetPacket(etherHeader *ether, uint16_t maxSize)
+{
+    etherPeekPacket(ether, maxSize);
+    return etherFinishPacket(ether, maxSize);
+}
+
+// Clears out any tx errors before a new frame is written
+void etherPrepareTx()
+{
+    // the previous frame may still be leaving the tx buffer
+    while ((etherReadReg(ECON1) & TXRTS) != 0 && (etherReadReg(EIR) & TXERIF) == 0);
+    if ((etherReadReg(EIR) & TXERIF) != 0)
+    {
+        etherClearReg(EIR, TXERIF);
+        etherSetReg(ECON1, TXRTS);
+        etherClearReg(ECON1, TXRTS);
+    }
+}
+
+// Writes the control byte and the first size bytes of a frame to the tx buffer
+void etherWriteTx(uint8_t *packet, uint16_t size)
+{
+    uint16_t i;
+
+    // set DMA start address
+    etherSetBank(EWRPTL);
+    etherWriteReg(EWRPTL, LOBYTE(0x1A0A));
+    etherWriteReg(EWRPTH, HIBYTE(0x1A0A));
+
+    // start FIFO buffer write
+    etherWriteMemStart();
+
+    // write control byte
+    etherWriteMem(0);
+
+    // write data
+    for (i = 0; i < size; i++)
+        etherWriteMem(packet[i]);
+
+    // stop write
+    etherWriteMemStop();
+}
+
+// Starts sending the size byte frame in the tx buffer
+// Returns without waiting, TXIF raises INT when the frame has gone
+bool etherTransmit(uint16_t size)
+{
+    // request transmit
+    etherSetBank(ETXSTL);
+    etherWriteReg(ETXSTL, LOBYTE(0x1A0A));
+    etherWriteReg(ETXSTH, HIBYTE(0x1A0A));
+    etherWriteReg(ETXNDL, LOBYTE(0x1A0A+size));
+    etherWriteReg(ETXNDH, HIBYTE(0x1A0A+size));
+    etherClearReg(EIR, TXIF);
+    etherSetReg(ECON1, TXRTS);
+    return true;
+}
+
+// Writes a packet
+bool etherPutPacket(etherHeader *ether, uint16_t size)
+{
+    etherPrepareTx();
+    etherWriteTx((uint8_t*)ether, size);
+    return etherTransmit(size);
+}
+
+// Returns true if the first peekSize bytes of the frame being read were peeked
+// and the frame holds size bytes (the controller counts the crc as well)
+bool etherIsPeeked(uint16_t peekSize, uint16_t size)
+{
+    return rxFrameRead >= peekSize && size + 4 <= rxFrameSize;
+}
+
+// Copies size bytes at offset in the frame being read to the same offset in the tx buffer
+// Uses the controller DMA, so the bytes never cross the SPI bus
+void etherCopyRxToTx(uint16_t offset, uint16_t size)
+{
+    uint16_t start = rxFrameAddress + offset;
+    uint16_t end;
+    if (start > 0x1A09)
+        start -= 0x1A0A;
+    // DMA wraps at the end of the rx buffer when end is below start
+    end = start + size - 1;
+    if (end > 0x1A09)
+        end -= 0x1A0A;
+    etherSetBank(EDMASTL);
+    etherWriteReg(EDMASTL, LOBYTE(start));
+    etherWriteReg(EDMASTH, HIBYTE(start));
+    etherWriteReg(EDMANDL, LOBYTE(end));
+    etherWriteReg(EDMANDH, HIBYTE(end));
+    etherWriteReg(EDMADSTL, LOBYTE(0x1A0B + offset));
+    etherWriteReg(EDMADSTH, HIBYTE(0x1A0B + offset));
+    etherClearReg(ECON1, CSUMEN);
+    etherSetReg(ECON1, DMAST);
+    while ((etherReadReg(ECON1) & DMAST) != 0);
+}
+
+// Sends the peeked frame back out and releases it, the first headerSize bytes
+// come from ether and the rest of the size bytes are copied by etherCopyRxToTx()
+bool etherPutPacketInPlace(etherHeader *ether, uint16_t headerSize, uint16_t size)
+{
+    etherPrepareTx();
+    etherWriteTx((uint8_t*)ether, headerSize);
+    etherCopyRxToTx(headerSize, size - headerSize);
+    etherDiscardPacket();
+    return etherTransmit(size);
+}
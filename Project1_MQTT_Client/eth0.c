@@ -10,13 +10,7 @@
 // System Clock:    40 MHz
 
 // Hardware configuration:
-// ENC28J60 Ethernet controller on SPI0
-//   MOSI (SSI0Tx) on PA5
-//   MISO (SSI0Rx) on PA4
-//   SCLK (SSI0Clk) on PA2
-//   ~CS (SW controlled) on PA3
-//   WOL on PB3
-//   INT on PC6
+// ENC28J60 Ethernet controller, see enc28j60.c
 
 //-----------------------------------------------------------------------------
 // Device includes, defines, and assembler directives
@@ -26,94 +20,12 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
-#include "tm4c123gh6pm.h"
-#include "wait.h"
-#include "gpio.h"
-#include "spi0.h"
 #include "uart0.h"
-
-// Pins
-#define CS PORTA,3
-#define WOL PORTB,3
-#define INT PORTC,6
-
-// Ether registers
-#define ERDPTL      0x00
-#define ERDPTH      0x01
-#define EWRPTL      0x02
-#define EWRPTH      0x03
-#define ETXSTL      0x04
-#define ETXSTH      0x05
-#define ETXNDL      0x06
-#define ETXNDH      0x07
-#define ERXSTL      0x08
-#define ERXSTH      0x09
-#define ERXNDL      0x0A
-#define ERXNDH      0x0B
-#define ERXRDPTL    0x0C
-#define ERXRDPTH    0x0D
-#define ERXWRPTL    0x0E
-#define ERXWRPTH    0x0F
-#define EIE         0x1B
-#define EIR         0x1C
-#define RXERIF  0x01
-#define TXERIF  0x02
-#define TXIF    0x08
-#define PKTIF   0x40
-#define ESTAT       0x1D
-#define CLKRDY  0x01
-#define TXABORT 0x02
-#define ECON2       0x1E
-#define PKTDEC  0x40
-#define ECON1       0x1F
-#define RXEN    0x04
-#define TXRTS   0x08
-#define ERXFCON     0x38
-#define EPKTCNT     0x39
-#define MACON1      0x40
-#define MARXEN  0x01
-#define RXPAUS  0x04
-#define TXPAUS  0x08
-#define MACON2      0x41
-#define MARST   0x80
-#define MACON3      0x42
-#define FULDPX  0x01
-#define FRMLNEN 0x02
-#define TXCRCEN 0x10
-#define PAD60   0x20
-#define MACON4      0x43
-#define MABBIPG     0x44
-#define MAIPGL      0x46
-#define MAIPGH      0x47
-#define MACLCON1    0x48
-#define MACLCON2    0x49
-#define MAMXFLL     0x4A
-#define MAMXFLH     0x4B
-#define MICMD       0x52
-#define MIIRD   0x01
-#define MIREGADR    0x54
-#define MIWRL       0x56
-#define MIWRH       0x57
-#define MIRDL       0x58
-#define MIRDH       0x59
-#define MAADR1      0x60
-#define MAADR0      0x61
-#define MAADR3      0x62
-#define MAADR2      0x63
-#define MAADR5      0x64
-#define MAADR4      0x65
-#define MISTAT      0x6A
-#define MIBUSY  0x01
-#define ECOCON      0x75
-
-// Ether phy registers
-#define PHCON1      0x00
-#define PDPXMD 0x0100
-#define PHSTAT1     0x01
-#define LSTAT  0x0400
-#define PHCON2      0x10
-#define HDLDIS 0x0100
-#define PHLCON      0x14
+#include "console.h"
+#include "alias.h"
+#include "session.h"
+#include "arp.h"
+#include "trace.h"
 
 // Packets
 #define IP_ADD_LENGTH 4
@@ -123,374 +35,21 @@
 //  Globals
 // ------------------------------------------------------------------------------
 
-uint8_t nextPacketLsb = 0x00;
-uint8_t nextPacketMsb = 0x00;
 uint8_t sequenceId = 1;
 uint8_t macAddress[HW_ADD_LENGTH] = {2,3,4,5,6,7};
 uint8_t ipAddress[IP_ADD_LENGTH] = {0,0,0,0};
 uint8_t ipSubnetMask[IP_ADD_LENGTH] = {255,255,255,0};
 uint8_t ipGwAddress[IP_ADD_LENGTH] = {0,0,0,0};
 uint8_t mqttBrokerIpAddress[IP_ADD_LENGTH] = {0,0,0,0};
-uint8_t mqttBrokerMacAddress[HW_ADD_LENGTH] = {0,0,0,0,0,0};
-extern uint32_t sequenceNumber;
-extern uint32_t acknowledgementNumber;
 extern uint32_t payLoadLength;
 bool    dhcpEnabled = true;
+uint16_t mqttPacketId = 0x000C;
+uint8_t mqttProtocolVersion = 4;
 
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
-// Buffer is configured as follows
-// Receive buffer starts at 0x0000 (bottom 6666 bytes of 8K space)
-// Transmit buffer at 01A0A (top 1526 bytes of 8K space)
-
-void etherCsOn()
-{
-    setPinValue(CS, 0);
-    _delay_cycles(4);                    // allow line to settle
-}
-
-void etherCsOff()
-{
-    setPinValue(CS, 1);
-}
-
-void etherWriteReg(uint8_t reg, uint8_t data)
-{
-    etherCsOn();
-    writeSpi0Data(0x40 | (reg & 0x1F));
-    readSpi0Data();
-    writeSpi0Data(data);
-    readSpi0Data();
-    etherCsOff();
-}
-
-uint8_t etherReadReg(uint8_t reg)
-{
-    uint8_t data;
-    etherCsOn();
-    writeSpi0Data(0x00 | (reg & 0x1F));
-    readSpi0Data();
-    writeSpi0Data(0);
-    data = readSpi0Data();
-    etherCsOff();
-    return data;
-}
-
-void etherSetReg(uint8_t reg, uint8_t mask)
-{
-    etherCsOn();
-    writeSpi0Data(0x80 | (reg & 0x1F));
-    readSpi0Data();
-    writeSpi0Data(mask);
-    readSpi0Data();
-    etherCsOff();
-}
-
-void etherClearReg(uint8_t reg, uint8_t mask)
-{
-    etherCsOn();
-    writeSpi0Data(0xA0 | (reg & 0x1F));
-    readSpi0Data();
-    writeSpi0Data(mask);
-    readSpi0Data();
-    etherCsOff();
-}
-
-void etherSetBank(uint8_t reg)
-{
-    etherClearReg(ECON1, 0x03);
-    etherSetReg(ECON1, reg >> 5);
-}
-
-void etherWritePhy(uint8_t reg, uint16_t data)
-{
-    etherSetBank(MIREGADR);
-    etherWriteReg(MIREGADR, reg);
-    etherWriteReg(MIWRL, data & 0xFF);
-    etherWriteReg(MIWRH, (data >> 8) & 0xFF);
-}
-
-uint16_t etherReadPhy(uint8_t reg)
-{
-    uint16_t data, dataH;
-    etherSetBank(MIREGADR);
-    etherWriteReg(MIREGADR, reg);
-    etherWriteReg(MICMD, MIIRD);
-    waitMicrosecond(11);
-    etherSetBank(MISTAT);
-    while ((etherReadReg(MISTAT) & MIBUSY) != 0);
-    etherSetBank(MICMD);
-    etherWriteReg(MICMD, 0);
-    data = etherReadReg(MIRDL);
-    dataH = etherReadReg(MIRDH);
-    data |= (dataH << 8);
-    return data;
-}
-
-void etherWriteMemStart()
-{
-    etherCsOn();
-    writeSpi0Data(0x7A);
-    readSpi0Data();
-}
-
-void etherWriteMem(uint8_t data)
-{
-    writeSpi0Data(data);
-    readSpi0Data();
-}
-
-void etherWriteMemStop()
-{
-    etherCsOff();
-}
-
-void etherReadMemStart()
-{
-    etherCsOn();
-    writeSpi0Data(0x3A);
-    readSpi0Data();
-}
-
-uint8_t etherReadMem()
-{
-    writeSpi0Data(0);
-    return readSpi0Data();
-}
-
-void etherReadMemStop()
-{
-    etherCsOff();
-}
-
-// Initializes ethernet device
-// Uses order suggested in Chapter 6 of datasheet except 6.4 OST which is first here
-void etherInit(uint16_t mode)
-{
-    // Initialize SPI0
-    initSpi0(USE_SSI0_RX);
-    setSpi0BaudRate(4e6, 40e6);
-    setSpi0Mode(0, 0);
-
-    // Enable clocks
-    enablePort(PORTA);
-    enablePort(PORTB);
-    enablePort(PORTC);
-
-    // Configure pins for ethernet module
-    selectPinPushPullOutput(CS);
-    selectPinDigitalInput(WOL);
-    selectPinDigitalInput(INT);
-
-    // make sure that oscillator start-up timer has expired
-    while ((etherReadReg(ESTAT) & CLKRDY) == 0) {}
-
-    // disable transmission and reception of packets
-    etherClearReg(ECON1, RXEN);
-    etherClearReg(ECON1, TXRTS);
-
-    // initialize receive buffer space
-    etherSetBank(ERXSTL);
-    etherWriteReg(ERXSTL, LOBYTE(0x0000));
-    etherWriteReg(ERXSTH, HIBYTE(0x0000));
-    etherWriteReg(ERXNDL, LOBYTE(0x1A09));
-    etherWriteReg(ERXNDH, HIBYTE(0x1A09));
-   
-    // initialize receiver write and read ptrs
-    // at startup, will write from 0 to 1A08 only and will not overwrite rd ptr
-    etherWriteReg(ERXWRPTL, LOBYTE(0x0000));
-    etherWriteReg(ERXWRPTH, HIBYTE(0x0000));
-    etherWriteReg(ERXRDPTL, LOBYTE(0x1A09));
-    etherWriteReg(ERXRDPTH, HIBYTE(0x1A09));
-    etherWriteReg(ERDPTL, LOBYTE(0x0000));
-    etherWriteReg(ERDPTH, HIBYTE(0x0000));
-
-    // setup receive filter
-    // always check CRC, use OR mode
-    etherSetBank(ERXFCON);
-    etherWriteReg(ERXFCON, (mode | ETHER_CHECKCRC) & 0xFF);
-
-    // bring mac out of reset
-    etherSetBank(MACON2);
-    etherWriteReg(MACON2, 0);
-  
-    // enable mac rx, enable pause control for full duplex
-    etherWriteReg(MACON1, TXPAUS | RXPAUS | MARXEN);
-
-    // enable padding to 60 bytes (no runt packets)
-    // add crc to tx packets, set full or half duplex
-    if ((mode & ETHER_FULLDUPLEX) != 0)
-        etherWriteReg(MACON3, FULDPX | FRMLNEN | TXCRCEN | PAD60);
-    else
-        etherWriteReg(MACON3, FRMLNEN | TXCRCEN | PAD60);
-
-    // leave MACON4 as reset
-
-    // set maximum rx packet size
-    etherWriteReg(MAMXFLL, LOBYTE(1518));
-    etherWriteReg(MAMXFLH, HIBYTE(1518));
-
-    // set back-to-back inter-packet gap to 9.6us
-    if ((mode & ETHER_FULLDUPLEX) != 0)
-        etherWriteReg(MABBIPG, 0x15);
-    else
-        etherWriteReg(MABBIPG, 0x12);
-
-    // set non-back-to-back inter-packet gap registers
-    etherWriteReg(MAIPGL, 0x12);
-    etherWriteReg(MAIPGH, 0x0C);
-
-    // leave collision window MACLCON2 as reset
-
-    // setup mac address
-    etherSetBank(MAADR0);
-    etherWriteReg(MAADR5, macAddress[0]);
-    etherWriteReg(MAADR4, macAddress[1]);
-    etherWriteReg(MAADR3, macAddress[2]);
-    etherWriteReg(MAADR2, macAddress[3]);
-    etherWriteReg(MAADR1, macAddress[4]);
-    etherWriteReg(MAADR0, macAddress[5]);
-
-    // initialize phy duplex
-    if ((mode & ETHER_FULLDUPLEX) != 0)
-        etherWritePhy(PHCON1, PDPXMD);
-    else
-        etherWritePhy(PHCON1, 0);
-
-    // disable phy loopback if in half-duplex mode
-    etherWritePhy(PHCON2, HDLDIS);
-
-    // Flash LEDA and LEDB
-    etherWritePhy(PHLCON, 0x0880);
-    waitMicrosecond(100000);
-
-    // set LEDA (link status) and LEDB (tx/rx activity)
-    // stretch LED on to 40ms (default)
-    etherWritePhy(PHLCON, 0x0472);
-
-    // enable reception
-    etherSetReg(ECON1, RXEN);
-}
-
-// Returns true if link is up
-bool etherIsLinkUp()
-{
-    return (etherReadPhy(PHSTAT1) & LSTAT) != 0;
-}
-
-// Returns TRUE if packet received
-bool etherIsDataAvailable()
-{
-    return ((etherReadReg(EIR) & PKTIF) != 0);
-}
-
-// Returns true if rx buffer overflowed after correcting the problem
-bool etherIsOverflow()
-{
-    bool err;
-    err = (etherReadReg(EIR) & RXERIF) != 0;
-    if (err)
-        etherClearReg(EIR, RXERIF);
-    return err;
-}
-
-// Returns up to max_size characters in data buffer
-// Returns number of bytes copied to buffer
-// Contents written are 16-bit size, 16-bit status, payload excl crc
-uint16_t etherGetPacket(etherHeader *ether, uint16_t maxSize)
-{
-    uint16_t i = 0, size, tmp16, status;
-    uint8_t *packet = (uint8_t*)ether;
-
-    // enable read from FIFO buffers
-    etherReadMemStart();
-
-    // get next packet information
-    nextPacketLsb = etherReadMem();
-    nextPacketMsb = etherReadMem();
-
-    // calc size
-    // don't return crc, instead return size + status, so size is correct
-    size = etherReadMem();
-    tmp16 = etherReadMem();
-    size |= (tmp16 << 8);
-
-    // get status (currently unused)
-    status = etherReadMem();
-    tmp16 = etherReadMem();
-    status |= (tmp16 << 8);
-
-    // copy data
-    if (size > maxSize)
-        size = maxSize;
-    while (i < size)
-        packet[i++] = etherReadMem();
-
-    // end read from FIFO buffers
-    etherReadMemStop();
-
-    // advance read pointer
-    etherSetBank(ERXRDPTL);
-    etherWriteReg(ERXRDPTL, nextPacketLsb); // hw ptr
-    etherWriteReg(ERXRDPTH, nextPacketMsb);
-    etherWriteReg(ERDPTL, nextPacketLsb);   // dma rd ptr
-    etherWriteReg(ERDPTH, nextPacketMsb);
-
-    // decrement packet counter so that PKTIF is maintained correctly
-    etherSetReg(ECON2, PKTDEC);
-
-    return size;
-}
-
-// Writes a packet
-bool etherPutPacket(etherHeader *ether, uint16_t size)
-{
-    uint16_t i;
-    uint8_t *packet = (uint8_t*) ether;
-
-    // clear out any tx errors
-    if ((etherReadReg(EIR) & TXERIF) != 0)
-    {
-        etherClearReg(EIR, TXERIF);
-        etherSetReg(ECON1, TXRTS);
-        etherClearReg(ECON1, TXRTS);
-    }
-
-    // set DMA start address
-    etherSetBank(EWRPTL);
-    etherWriteReg(EWRPTL, LOBYTE(0x1A0A));
-    etherWriteReg(EWRPTH, HIBYTE(0x1A0A));
-
-    // start FIFO buffer write
-    etherWriteMemStart();
-
-    // write control byte
-    etherWriteMem(0);
-
-    // write data
-    for (i = 0; i < size; i++)
-        etherWriteMem(packet[i]);
-
-    // stop write
-    etherWriteMemStop();
-  
-    // request transmit
-    etherWriteReg(ETXSTL, LOBYTE(0x1A0A));
-    etherWriteReg(ETXSTH, HIBYTE(0x1A0A));
-    etherWriteReg(ETXNDL, LOBYTE(0x1A0A+size));
-    etherWriteReg(ETXNDH, HIBYTE(0x1A0A+size));
-    etherClearReg(EIR, TXIF);
-    etherSetReg(ECON1, TXRTS);
-
-    // wait for completion
-    while ((etherReadReg(ECON1) & TXRTS) != 0);
-
-    // determine success
-    return ((etherReadReg(ESTAT) & TXABORT) == 0);
-}
-
 // Calculate sum of words
 // Must use getEtherChecksum to complete 1's compliment addition
 void etherSumWords(void* data, uint16_t sizeInBytes, uint32_t* sum)
@@ -524,6 +83,16 @@ uint16_t getEtherChecksum(uint32_t sum)
     return ~result;
 }
 
+// Patches a checksum after one 16-bit word changed from oldWord to newWord
+// Uses HC' = ~(~HC + ~m + m') from rfc1624, which works in either byte order
+uint16_t etherUpdateChecksum(uint16_t check, uint16_t oldWord, uint16_t newWord)
+{
+    uint32_t sum = (uint16_t)~check;
+    sum += (uint16_t)~oldWord;
+    sum += newWord;
+    return getEtherChecksum(sum);
+}
+
 void etherCalcIpChecksum(ipHeader *ip)
 {
     uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
@@ -579,6 +148,27 @@ bool etherIsIpUnicast(etherHeader *ether)
     return ok;
 }
 
+// Determines whether ip is on the local subnet
+bool etherIsIpOnLink(uint8_t ip[4])
+{
+    uint8_t i;
+    bool ok = true;
+    for (i = 0; i < IP_ADD_LENGTH; i++)
+        ok &= ((ip[i] & ipSubnetMask[i]) == (ipAddress[i] & ipSubnetMask[i]));
+    return ok;
+}
+
+// Picks the next hop for ip: ip itself when on the local subnet, otherwise the gateway
+// Returns false if ip is off the subnet and no gateway is set
+bool etherGetNextHop(uint8_t ip[4], uint8_t nextHop[4])
+{
+    uint8_t i;
+    bool onLink = etherIsIpOnLink(ip);
+    for (i = 0; i < IP_ADD_LENGTH; i++)
+        nextHop[i] = onLink ? ip[i] : ipGwAddress[i];
+    return onLink || ipGwAddress[0] != 0 || ipGwAddress[1] != 0 || ipGwAddress[2] != 0 || ipGwAddress[3] != 0;
+}
+
 // Determines whether packet is ping request
 // Must be an IP packet
 bool etherIsPingRequest(etherHeader *ether)
@@ -589,15 +179,15 @@ bool etherIsPingRequest(etherHeader *ether)
     return (ip->protocol == 0x01 & icmp->type == 8);
 }
 
-// Sends a ping response given the request data
-void etherSendPingResponse(etherHeader *ether)
+// Turns a ping request into its response in place
+// Swapping addresses leaves both checksums unchanged, only the type word needs patching
+void etherMakePingResponse(etherHeader *ether)
 {
     ipHeader *ip = (ipHeader*)ether->data;
     uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
     icmpHeader *icmp = (icmpHeader*)((uint8_t*)ip + ipHeaderLength);
     uint8_t i, tmp;
-    uint16_t icmp_size;
-    uint32_t sum = 0;
+    uint16_t oldWord;
     // swap source and destination fields
     for (i = 0; i < HW_ADD_LENGTH; i++)
     {
@@ -612,16 +202,40 @@ void etherSendPingResponse(etherHeader *ether)
         ip->sourceIp[i] = tmp;
     }
     // this is a response
+    oldWord = *(uint16_t*)icmp;
     icmp->type = 0;
-    // calc icmp checksum
-    icmp->check = 0;
-    icmp_size = ntohs(ip->length) - ipHeaderLength;
-    etherSumWords(icmp, icmp_size, &sum);
-    icmp->check = getEtherChecksum(sum);
+    icmp->check = etherUpdateChecksum(icmp->check, oldWord, *(uint16_t*)icmp);
+}
+
+// Sends a ping response given the request data
+void etherSendPingResponse(etherHeader *ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    etherMakePingResponse(ether);
     // send packet
     etherPutPacket(ether, sizeof(etherHeader) + ntohs(ip->length));
 }
 
+// Answers a ping request from a packet started with etherPeekPacket
+// Only the headers go over SPI, the echo data is copied inside the controller
+// Returns false, leaving the packet unread, if it is not a ping request to us
+bool etherSendPingResponseInPlace(etherHeader *ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    uint16_t headerSize = sizeof(etherHeader) + ipHeaderLength + 4;
+    uint16_t frameSize;
+    if (!etherIsPeeked(headerSize, headerSize) || !etherIsIp(ether) || !etherIsIpUnicast(ether) || !etherIsPingRequest(ether))
+        return false;
+    frameSize = sizeof(etherHeader) + ntohs(ip->length);
+    if (ntohs(ip->length) < ipHeaderLength + sizeof(icmpHeader) || !etherIsPeeked(headerSize, frameSize))
+        return false;
+    etherMakePingResponse(ether);
+    // headers up to the icmp checksum come from ram, id, sequence and data stay put
+    etherPutPacketInPlace(ether, headerSize, frameSize);
+    return true;
+}
+
 // Determines whether packet is ARP request
 bool etherIsArpRequest(etherHeader *ether)
 {
@@ -813,6 +427,75 @@ void etherIncId()
     sequenceId++;
 }
 
+// Sends a UDP datagram from sourcePort to destIp:destPort
+// 255.255.255.255 goes out as a link broadcast, anything else to its next hop via the ARP cache
+// udpData may already sit in place at the UDP payload of ether
+// Returns false if the datagram had to be dropped
+bool etherSendUdp(etherHeader *ether, uint16_t sourcePort, uint8_t destIp[4], uint16_t destPort, uint8_t *udpData, uint16_t udpSize)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    udpHeader *udp;
+    uint8_t *copyData;
+    uint8_t i;
+    uint8_t nextHop[IP_ADD_LENGTH];
+    uint16_t j, tmp16, udpLength;
+    uint32_t sum = 0;
+    bool broadcast = (destIp[0] & destIp[1] & destIp[2] & destIp[3]) == 0xFF;
+
+    // fill ethernet frame, the destination is set once the next hop is known
+    for (i = 0; i < HW_ADD_LENGTH; i++)
+    {
+        ether->sourceAddress[i] = macAddress[i];
+        ether->destAddress[i] = 0xFF;
+    }
+    ether->frameType = htons(0x0800);
+    // fill ip header
+    ip->revSize = 0x45;
+    ip->typeOfService = 0x00;
+    ip->id = 0x0000;
+    ip->flagsAndOffset = 0x0000;
+    ip->ttl = 128;
+    ip->protocol = 0x11;
+    for (i = 0; i < IP_ADD_LENGTH; i++)
+    {
+        ip->sourceIp[i] = ipAddress[i];
+        ip->destIp[i] = destIp[i];
+    }
+    udp = (udpHeader*)((uint8_t*)ip + 20);
+    udpLength = 8 + udpSize;
+    ip->length = htons(20 + udpLength);
+    etherCalcIpChecksum(ip);
+    // fill udp header and data
+    udp->sourcePort = htons(sourcePort);
+    udp->destPort = htons(destPort);
+    udp->length = htons(udpLength);
+    copyData = udp->data;
+    if (copyData != udpData)
+        for (j = 0; j < udpSize; j++)
+            copyData[j] = udpData[j];
+    // 32-bit sum over pseudo-header
+    etherSumWords(ip->sourceIp, 8, &sum);
+    tmp16 = ip->protocol;
+    sum += (tmp16 & 0xff) << 8;
+    etherSumWords(&udp->length, 2, &sum);
+    // add udp header and data
+    udp->check = 0;
+    etherSumWords(udp, udpLength, &sum);
+    udp->check = getEtherChecksum(sum);
+
+    if (broadcast)
+        return etherPutPacket(ether, sizeof(etherHeader) + 20 + udpLength);
+    if (!etherGetNextHop(destIp, nextHop))
+        return false;
+    return arpResolve(ether, nextHop, sizeof(etherHeader) + 20 + udpLength);
+}
+
+// Gets pointer to where etherSendUdp expects the UDP payload of an outgoing frame
+uint8_t * etherGetUdpTxData(etherHeader *ether)
+{
+    return ether->data + 20 + 8;
+}
+
 // Enable or disable DHCP mode
 void etherEnableDhcpMode()
 {
@@ -925,50 +608,73 @@ void etherGetMqttBrokerIpAddress(uint8_t mqttBIp[4])
 // Sets MQTT Broker MAC Address
 void etherSetMqttBrokerHW(uint8_t mqttBMac0,uint8_t mqttBMac1,uint8_t mqttBMac2,uint8_t mqttBMac3,uint8_t mqttBMac4,uint8_t mqttBMac5)
 {
-    mqttBrokerMacAddress[0] = mqttBMac0;
-    mqttBrokerMacAddress[1] = mqttBMac1;
-    mqttBrokerMacAddress[2] = mqttBMac2;
-    mqttBrokerMacAddress[3] = mqttBMac3;
-    mqttBrokerMacAddress[4] = mqttBMac4;
-    mqttBrokerMacAddress[5] = mqttBMac5;
+    uint8_t mqttBMac[HW_ADD_LENGTH];
+    mqttBMac[0] = mqttBMac0;
+    mqttBMac[1] = mqttBMac1;
+    mqttBMac[2] = mqttBMac2;
+    mqttBMac[3] = mqttBMac3;
+    mqttBMac[4] = mqttBMac4;
+    mqttBMac[5] = mqttBMac5;
+    uint8_t nextHop[IP_ADD_LENGTH];
+    etherGetNextHop(mqttBrokerIpAddress, nextHop);
+    arpLearn(nextHop, mqttBMac, true);
 }
 
-// Gets MQTT Broker MAC address
+// Gets the MAC frames to the MQTT Broker are sent to, which is the gateway's for an
+// off subnet broker, all zero if it is not in the ARP cache
 void etherGetMqttBrokerMacAddress(uint8_t mqttBMac[6])
 {
     uint8_t i;
-    for (i = 0; i < 6; i++)
-        mqttBMac[i] = mqttBrokerMacAddress[i];
+    uint8_t nextHop[IP_ADD_LENGTH];
+    if(!etherGetNextHop(mqttBrokerIpAddress, nextHop) || !arpLookup(nextHop, mqttBMac))
+        for (i = 0; i < 6; i++)
+            mqttBMac[i] = 0;
 }
 
-//Store MAC Address from ARP response
-void etherStoreMqttMacAddress(etherHeader* ether)
+//Determines whether packet is ARP
+bool etherIsArp(etherHeader* ether)
+{
+    return ether->frameType == htons(0x0806);
+}
+
+//Learns the sender of any ARP packet, new entries only from packets aimed at us
+void etherLearnArp(etherHeader* ether)
 {
     arpPacket *arp = (arpPacket*)ether->data;
+    bool forUs = true;
     uint8_t i;
-    for(i = 0; i < HW_ADD_LENGTH; i++)
-    {
-        mqttBrokerMacAddress[i] = arp->sourceAddress[i];
-    }
+    if(arp->sourceIp[0] == 0 && arp->sourceIp[1] == 0 && arp->sourceIp[2] == 0 && arp->sourceIp[3] == 0)
+        return;
+    for(i = 0; i < IP_ADD_LENGTH; i++)
+        forUs &= (arp->destIp[i] == ipAddress[i]);
+    arpLearn(arp->sourceIp, arp->sourceAddress, forUs);
 }
 
-//Fills up the Socket
-void etherFillUpMqttConnectionSocket(socket* s)
+//True once the broker's next hop MAC is in the ARP cache, so a connection can skip ARP
+bool etherIsMqttBrokerMacKnown()
 {
-    etherGetMqttBrokerMacAddress(s->destAddress);
-    etherGetMacAddress(s->sourceAddress);
-    etherGetMqttBrokerIpAddress(s->destIp);
-    etherGetIpAddress(s->sourceIp);
-    s->destPort = htons(1883);
-    s->sourcePort = htons(110);
+    uint8_t mqttBMac[HW_ADD_LENGTH];
+    uint8_t nextHop[IP_ADD_LENGTH];
+    return etherGetNextHop(mqttBrokerIpAddress, nextHop) && arpLookup(nextHop, mqttBMac);
+}
+
+//Drops the cached next hop MAC for the broker, the next connection ARPs again
+void etherForgetMqttBrokerMac()
+{
+    uint8_t nextHop[IP_ADD_LENGTH];
+    etherGetNextHop(mqttBrokerIpAddress, nextHop);
+    arpRemove(nextHop);
 }
 
 //Sends a TCP Message
 void etherSendTcp(etherHeader* ether,socket* s,uint16_t flags,uint8_t* tcpData,uint16_t dataLength)
 {
     uint8_t i,tcpDataOffset;
+    uint16_t j;
+    uint8_t nextHop[IP_ADD_LENGTH];
     uint8_t* copyData;
-    etherFillUpMqttConnectionSocket(s);
+    if(s == 0)
+        return;
     //Fill up ethernet Header
     for(i = 0;i < HW_ADD_LENGTH;i++)
         ether->sourceAddress[i] = s->sourceAddress[i];
@@ -995,16 +701,17 @@ void etherSendTcp(etherHeader* ether,socket* s,uint16_t flags,uint8_t* tcpData,u
     tcp->destPort = s->destPort;
     if(flags == TCP_SYNC)
     {
-        sequenceNumber = 0;
-        acknowledgementNumber = 0;
-        tcp->sequenceNumber = sequenceNumber;
-        tcp->acknowledgementNumber = acknowledgementNumber;
-    }
-    else
-    {
-        tcp->sequenceNumber = sequenceNumber;
-        tcp->acknowledgementNumber = acknowledgementNumber;
+        s->sequenceNumber = 0;
+        s->acknowledgementNumber = 0;
+        s->unacknowledged = 0;
+        s->windowEnd = 0;
+        s->state = tcpSynSent;
     }
+    if(flags == TCP_FIN || flags == TCP_RESET)
+        s->state = tcpClosing;
+    tcp->sequenceNumber = s->sequenceNumber;
+    tcp->acknowledgementNumber = s->acknowledgementNumber;
+    TRACE(traceTcpSend, flags, htonl(s->sequenceNumber), htonl(s->acknowledgementNumber));
     tcp->urgentPointer = 0x0000;
     tcp->windowSize = htons(1220);
 
@@ -1017,8 +724,8 @@ void etherSendTcp(etherHeader* ether,socket* s,uint16_t flags,uint8_t* tcpData,u
          uint8_t *tcpOptions = (uint8_t*)&tcp->data;
          tcpOptions[0] = 0x02;  //Kind
          tcpOptions[1] = 0x04;  //Length
-         tcpOptions[2] = 0x04;  //Value
-         tcpOptions[3] = 0xc4;
+         tcpOptions[2] = HIBYTE(TCP_MSS);  //Value
+         tcpOptions[3] = LOBYTE(TCP_MSS);
     }
     if(flags == TCP_ACK || flags == TCP_FIN_ACK || flags == TCP_RESET || flags == TCP_REST_ACK || flags== TCP_FIN)
     {
@@ -1030,8 +737,8 @@ void etherSendTcp(etherHeader* ether,socket* s,uint16_t flags,uint8_t* tcpData,u
         tcpDataOffset = 5;
         tcp->offsetFields = htons((tcpDataOffset << 12) + TCP_PUSH_ACK);
         copyData = tcp->data;
-        for(i = 0;i < dataLength;i++)
-            copyData[i] = tcpData[i];
+        for(j = 0;j < dataLength;j++)
+            copyData[j] = tcpData[j];
     }
     uint16_t tcpLength = (tcpDataOffset*4) + dataLength;
     //Calculate length of IP message and IP header Checksum
@@ -1049,7 +756,15 @@ void etherSendTcp(etherHeader* ether,socket* s,uint16_t flags,uint8_t* tcpData,u
     //add contents of tcp message
     etherSumWords(tcp, (tcpLength), &sum);
     tcp->checksum = getEtherChecksum(sum);
-    etherPutPacket(ether, sizeof(etherHeader) + ((ip->revSize & 0xF) * 4) + tcpLength);
+    if(etherGetNextHop(s->destIp, nextHop))
+        arpResolve(ether, nextHop, sizeof(etherHeader) + ((ip->revSize & 0xF) * 4) + tcpLength);
+
+    //Advance sequence number past the data so back to back segments don't overlap,
+    //SYN and FIN take one sequence number each
+    if(flags == TCP_PUSH_ACK)
+        s->sequenceNumber = htonl(htonl(s->sequenceNumber) + dataLength);
+    if(flags == TCP_SYNC || flags == TCP_FIN)
+        s->sequenceNumber = htonl(htonl(s->sequenceNumber) + 1);
 }
 
 
@@ -1078,6 +793,15 @@ bool etherIsTcpAck(etherHeader *ether)
     return ok;
 }
 
+//Number of data bytes carried by a TCP segment
+uint16_t etherGetTcpDataLength(etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
+    return ntohs(ip->length) - ipHeaderLength - ((htons(tcp->offsetFields) >> 12) * 4);
+}
+
 bool etherIsTcpFinAck(etherHeader* ether)
 {
     bool ok = true;
@@ -1092,18 +816,14 @@ bool etherIsTcpFinAck(etherHeader* ether)
     return ok;
 }
 
-bool etherIsTcpResetAck(etherHeader* ether)
+//Is it a TCP reset, with or without an ACK
+bool etherIsTcpReset(etherHeader* ether)
 {
-    bool ok = true;
-    uint8_t i = 0;
-    for(i = 0;i < HW_ADD_LENGTH;i++)
-        ok &= (ether->destAddress[i] == macAddress[i]);
     ipHeader *ip = (ipHeader*)ether->data;
     uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
     tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
     uint16_t tcpFieldType = htons(tcp->offsetFields) & 0x0FFF;
-    ok = (tcpFieldType == TCP_REST_ACK);
-    return ok;
+    return tcpFieldType == TCP_RESET || tcpFieldType == TCP_REST_ACK;
 }
 
 //Check if the packet is Mqtt Connection Acknowledgement
@@ -1120,11 +840,41 @@ bool etherIsMqttConnectAck(etherHeader* ether)
     if(ok)
     {
         ok = (copyData[0] == 0x20); //Is it Connect Ack Mqtt Payload
-        ok &= (copyData[2] == 0x00);//It it an accepted connection
+        ok &= (copyData[3] == 0x00);//It it an accepted connection
+        //Mqtt 5.0 properties can take the remaining length past one byte
+        payLoadLength = etherMqttGetPacketLength(copyData);
     }
     return ok;
 }
 
+//Applies the properties of an accepted Connect Ack and starts a fresh alias table
+void etherMqttProcessConnectAck(etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
+    uint8_t* copyData = tcp->data;
+    uint16_t brokerAliasMaximum = 0;
+    uint32_t propertyLength;
+    uint16_t offset, end;
+    if(mqttProtocolVersion == 5)
+    {
+        //Fixed header (2), flags and reason code (2), then properties
+        offset = 4;
+        offset += etherMqttDecodeLength(&copyData[offset], &propertyLength);
+        end = offset + propertyLength;
+        while(offset < end)
+        {
+            uint8_t id = copyData[offset++];
+            if(id == MQTT_PROP_TOPIC_ALIAS_MAXIMUM)
+                brokerAliasMaximum = (copyData[offset] << 8) | copyData[offset+1];
+            offset += etherMqttPropertySize(id, &copyData[offset]);
+        }
+    }
+    sessionSetPresent(copyData[2] & 0x01);
+    aliasReset(brokerAliasMaximum);
+}
+
 //Check if the packet is Mqtt SubscribeAck Packet
 bool etherIsMqttSubAck(etherHeader* ether)
 {
@@ -1139,7 +889,7 @@ bool etherIsMqttSubAck(etherHeader* ether)
     if(ok)
     {
         ok &= (copyData[0] == 0x90);
-        payLoadLength = copyData[1] + 2;
+        payLoadLength = etherMqttGetPacketLength(copyData);
     }
     return ok;
 }
@@ -1158,7 +908,7 @@ bool etherIsMqttUnSubAck(etherHeader* ether)
     if(ok)
     {
         ok &= (copyData[0] == 0xb0);
-        payLoadLength = copyData[1] + 2;
+        payLoadLength = etherMqttGetPacketLength(copyData);
     }
     return ok;
 }
@@ -1177,89 +927,312 @@ bool etherIsMqttPublish(etherHeader* ether)
     if(ok)
     {
         ok &= (copyData[0] == 0x30);
-        payLoadLength = copyData[1] + 2;
+        payLoadLength = etherMqttGetPacketLength(copyData);
     }
     return ok;
 }
 
 
-//Create a MQTT connect Data Payload
-uint8_t* etherMqttCreateConnectPayload(uint8_t* mqttPayload)
+//Check if the packet is Mqtt PingResp Packet
+bool etherIsMqttPingResp(etherHeader* ether)
+{
+    bool ok = true;
+    uint8_t i = 0;
+    for(i = 0;i < HW_ADD_LENGTH;i++)
+        ok &= (ether->destAddress[i] == macAddress[i]);
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
+    uint8_t* copyData = tcp->data;
+    if(ok)
+    {
+        ok &= (copyData[0] == 0xD0);
+        payLoadLength = 2;
+    }
+    return ok;
+}
+
+//Builds a Mqtt Connect for version 4 or 5 from the parameters alone, returns its length
+//A persistent session sends clean session = 0; Mqtt 5.0 adds a property block advertising
+//how many inbound topic aliases we accept, and a Session Expiry Interval since a 5.0
+//session otherwise ends with the connection
+uint16_t etherMqttBuildConnect(uint8_t* mqttPayload, uint8_t version, bool persistent, uint16_t keepAlive, char* clientId)
 {
+    uint16_t clientIdLength = strLen(clientId);
+    uint8_t propertyLength = persistent ? 8 : 3;
+    uint16_t i, offset;
     mqttPayload[0] = 0x10;
-    mqttPayload[1] = 15;
-    mqttPayload[2] = 0x00;
-    mqttPayload[3] = 0x04;
-    mqttPayload[4] = (uint8_t)'M';
-    mqttPayload[5] = (uint8_t)'Q';
-    mqttPayload[6] = (uint8_t)'T';
-    mqttPayload[7] = (uint8_t)'T';
-    mqttPayload[8] = 0x04;
-    mqttPayload[9] = 0x02;
-    mqttPayload[10] = 0x00;
-    mqttPayload[11] = 0x3c;
-    mqttPayload[12] = 0x00;
-    mqttPayload[13] = 0x03;
-    mqttPayload[14] = (uint8_t)'r';
-    mqttPayload[15] = (uint8_t)'b';
-    mqttPayload[16] = (uint8_t)'v';
-    payLoadLength = mqttPayload[1]+2;
-    return mqttPayload;
+    offset = 1 + etherMqttEncodeLength(&mqttPayload[1], 10 + ((version == 5) ? 1 + propertyLength : 0) + 2 + clientIdLength);
+    mqttPayload[offset++] = 0x00;
+    mqttPayload[offset++] = 0x04;
+    mqttPayload[offset++] = (uint8_t)'M';
+    mqttPayload[offset++] = (uint8_t)'Q';
+    mqttPayload[offset++] = (uint8_t)'T';
+    mqttPayload[offset++] = (uint8_t)'T';
+    mqttPayload[offset++] = version;
+    mqttPayload[offset++] = persistent ? 0x00 : 0x02;
+    mqttPayload[offset++] = HIBYTE(keepAlive);
+    mqttPayload[offset++] = LOBYTE(keepAlive);
+    if(version == 5)
+    {
+        mqttPayload[offset++] = propertyLength;
+        mqttPayload[offset++] = MQTT_PROP_TOPIC_ALIAS_MAXIMUM;
+        mqttPayload[offset++] = HIBYTE(ALIAS_INBOUND_MAX);
+        mqttPayload[offset++] = LOBYTE(ALIAS_INBOUND_MAX);
+        if(persistent)
+        {
+            mqttPayload[offset++] = MQTT_PROP_SESSION_EXPIRY;
+            mqttPayload[offset++] = 0;
+            mqttPayload[offset++] = 0;
+            mqttPayload[offset++] = HIBYTE(SESSION_EXPIRY);
+            mqttPayload[offset++] = LOBYTE(SESSION_EXPIRY);
+        }
+    }
+    mqttPayload[offset++] = HIBYTE(clientIdLength);
+    mqttPayload[offset++] = LOBYTE(clientIdLength);
+    for(i = 0;i < clientIdLength;i++)
+        mqttPayload[offset++] = clientId[i];
+    return offset;
 }
 
-//Creates a Mqtt Subscribe payload to topic subTopic
-uint8_t* etherMqttCreateSubscribePayload(uint8_t* mqttPayload,char* subTopic)
+//Create a MQTT connect Data Payload for the broker session, under a client ID unique to this board
+uint8_t* etherMqttCreateConnectPayload(uint8_t* mqttPayload)
 {
-    uint16_t subTopicLength = strLen(subTopic);
-    uint8_t i;
-    mqttPayload[0] = 0x82;
-    mqttPayload[1] = subTopicLength + 2 + 2 + 1;
-    mqttPayload[2] = 0x00;
-    mqttPayload[3] = 0x0C;
-    uint16_t* ptr = (uint16_t*)&mqttPayload[4];
-    *ptr = htons(subTopicLength);
-    for(i = 0;i < subTopicLength; i++)
-        mqttPayload[i+6] = subTopic[i];
-    mqttPayload[i+6] = 0x00;
-    payLoadLength = mqttPayload[1]+2;
+    payLoadLength = etherMqttBuildConnect(mqttPayload, mqttProtocolVersion, sessionIsPersistent(),
+                                          MQTT_KEEPALIVE, sessionGetClientId());
     return mqttPayload;
 }
 
-//Creates a Mqtt Unsubscribe Payload to topic subTopic
-uint8_t* etherMqttCreateUnSubscribePayload(uint8_t* mqttPayload,char* subTopic)
+//Returns the next non zero Mqtt packet identifier
+uint16_t etherMqttNextPacketId()
 {
-    uint16_t subTopicLength = strLen(subTopic);
-    uint8_t i;
-    mqttPayload[0] = 0xA2;
-    mqttPayload[1] = subTopicLength + 2 + 2;
-    mqttPayload[2] = 0x00;
-    mqttPayload[3] = 0x0C;
-    uint16_t* ptr = (uint16_t*)&mqttPayload[4];
-    *ptr = htons(subTopicLength);
-    for(i = 0;i < subTopicLength; i++)
-        mqttPayload[i+6] = subTopic[i];
-    mqttPayload[i+6] = 0x00;
-    payLoadLength = mqttPayload[1]+2;
-    return mqttPayload;
+    mqttPacketId++;
+    if(mqttPacketId == 0)
+        mqttPacketId = 1;
+    return mqttPacketId;
 }
 
-//Creates a Mqtt Topic Payload with passed parametres topic and data
-uint8_t* etherMqttCreatePublishPayload(uint8_t* mqttPayload,char* topic,char* data)
+//Encodes the Mqtt remaining length field, returns number of bytes used
+uint8_t etherMqttEncodeLength(uint8_t* dest, uint32_t length)
+{
+    uint8_t i = 0;
+    do
+    {
+        dest[i] = length & 0x7F;
+        length >>= 7;
+        if(length > 0)
+            dest[i] |= 0x80;
+        i++;
+    } while(length > 0 && i < 4);
+    return i;
+}
+
+//Decodes the Mqtt remaining length field, returns number of bytes used
+uint8_t etherMqttDecodeLength(uint8_t* src, uint32_t* length)
+{
+    uint8_t i = 0;
+    *length = 0;
+    do
+    {
+        *length |= (uint32_t)(src[i] & 0x7F) << (7 * i);
+    } while((src[i++] & 0x80) && i < 4);
+    return i;
+}
+
+//Returns the size of a whole Mqtt packet from its fixed header
+uint32_t etherMqttGetPacketLength(uint8_t* packet)
+{
+    uint32_t remainingLength;
+    uint8_t lengthBytes = etherMqttDecodeLength(&packet[1], &remainingLength);
+    return 1 + lengthBytes + remainingLength;
+}
+
+//Returns the number of value bytes of the Mqtt 5.0 property id, value points past the id
+uint16_t etherMqttPropertySize(uint8_t id, uint8_t* value)
+{
+    uint32_t length;
+    switch(id)
+    {
+        //Byte
+        case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A:
+            return 1;
+        //Two byte integer
+        case 0x13: case 0x21: case 0x22: case 0x23:
+            return 2;
+        //Four byte integer
+        case 0x02: case 0x11: case 0x18: case 0x27:
+            return 4;
+        //Variable byte integer
+        case 0x0B:
+            return etherMqttDecodeLength(value, &length);
+        //String pair
+        case 0x26:
+            length = 2 + ((value[0] << 8) | value[1]);
+            return length + 2 + ((value[length] << 8) | value[length+1]);
+        //String or binary data
+        default:
+            return 2 + ((value[0] << 8) | value[1]);
+    }
+}
+
+//Selects Mqtt 3.1.1 (4) or Mqtt 5.0 (5) for the next connection
+void etherMqttSetProtocolVersion(uint8_t version)
+{
+    if(version == 4 || version == 5)
+        mqttProtocolVersion = version;
+}
+
+uint8_t etherMqttGetProtocolVersion()
+{
+    return mqttProtocolVersion;
+}
+
+//Builds a Subscribe or Unsubscribe packet holding as many of the topics as fit in maxSize
+//Returns the number of topics packed, total packet length is left in payLoadLength
+uint8_t etherMqttCreateTopicListPayload(uint8_t* mqttPayload, uint16_t maxSize, uint8_t type, char* topics[], uint8_t qos[], uint8_t count)
+{
+    uint32_t bodyLength = (mqttProtocolVersion == 5) ? 3 : 2;
+    uint16_t topicLength, offset, j;
+    uint8_t n = 0, i, headerLength;
+    uint8_t lengthField[4];
+    uint8_t entryExtra = (type == 0x82) ? 3 : 2;
+
+    //Work out how many topics fit before writing anything
+    while(n < count)
+    {
+        topicLength = strLen(topics[n]);
+        headerLength = 1 + etherMqttEncodeLength(lengthField, bodyLength + topicLength + entryExtra);
+        if(headerLength + bodyLength + topicLength + entryExtra > maxSize)
+            break;
+        bodyLength += topicLength + entryExtra;
+        n++;
+    }
+    if(n == 0)
+    {
+        payLoadLength = 0;
+        return 0;
+    }
+
+    mqttPayload[0] = type;
+    offset = 1 + etherMqttEncodeLength(&mqttPayload[1], bodyLength);
+    uint16_t packetId = etherMqttNextPacketId();
+    mqttPayload[offset++] = HIBYTE(packetId);
+    mqttPayload[offset++] = LOBYTE(packetId);
+    //Mqtt 5.0 empty property block
+    if(mqttProtocolVersion == 5)
+        mqttPayload[offset++] = 0;
+    for(i = 0; i < n; i++)
+    {
+        topicLength = strLen(topics[i]);
+        mqttPayload[offset++] = HIBYTE(topicLength);
+        mqttPayload[offset++] = LOBYTE(topicLength);
+        for(j = 0; j < topicLength; j++)
+            mqttPayload[offset++] = topics[i][j];
+        if(type == 0x82)
+            mqttPayload[offset++] = qos[i] & 0x03;
+    }
+    payLoadLength = offset;
+    return n;
+}
+
+//Creates a Mqtt Subscribe payload for a list of topics with per topic QoS
+uint8_t etherMqttCreateSubscribeListPayload(uint8_t* mqttPayload, uint16_t maxSize, char* topics[], uint8_t qos[], uint8_t count)
+{
+    return etherMqttCreateTopicListPayload(mqttPayload, maxSize, 0x82, topics, qos, count);
+}
+
+//Creates a Mqtt Unsubscribe payload for a list of topics
+uint8_t etherMqttCreateUnSubscribeListPayload(uint8_t* mqttPayload, uint16_t maxSize, char* topics[], uint8_t count)
+{
+    return etherMqttCreateTopicListPayload(mqttPayload, maxSize, 0xA2, topics, 0, count);
+}
+
+//Copies the per topic return codes of the SubAck starting start bytes into the
+//segment, returns the number of codes
+uint8_t etherMqttGetSubAckReturnCodes(etherHeader* ether, uint16_t start, uint8_t codes[], uint8_t maxCodes)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
+    uint8_t* copyData = &tcp->data[start];
+    uint16_t dataLength = etherGetTcpDataLength(ether);
+    uint32_t remainingLength;
+    uint32_t propertyLength;
+    uint32_t offset, end;
+    uint8_t n = 0;
+    //at least a fixed header and packet identifier must be in this segment
+    if(dataLength < start + 4)
+        return 0;
+    dataLength -= start;
+    offset = 1 + etherMqttDecodeLength(&copyData[1], &remainingLength);
+    end = offset + remainingLength;
+    //codes past the end of the segment are not read, whatever the length claims
+    if(end > dataLength)
+        end = dataLength;
+    //skip packet identifier and, for Mqtt 5.0, the properties
+    offset += 2;
+    if(mqttProtocolVersion == 5 && offset < end)
+    {
+        offset += etherMqttDecodeLength(&copyData[offset], &propertyLength);
+        offset += propertyLength;
+    }
+    while(offset + n < end && n < maxCodes)
+    {
+        codes[n] = copyData[offset + n];
+        n++;
+    }
+    return n;
+}
+
+//Builds a QoS 0 Mqtt Publish of topic and data, returns its length
+//With Mqtt 5.0 a non zero alias is sent as a property, and replaces the topic once known
+uint16_t etherMqttBuildPublish(uint8_t* mqttPayload, uint8_t version, char* topic, char* data, uint16_t alias, bool known)
 {
-    uint8_t i,j;
+    uint16_t i, offset;
     uint16_t topicLength = strLen(topic);
     uint16_t dataLength = strLen(data);
+    uint16_t sendTopicLength = (version == 5 && known) ? 0 : topicLength;
+    uint8_t propertyLength = (version == 5 && alias != 0) ? 3 : 0;
     mqttPayload[0] = 0x30;
-    mqttPayload[1] = topicLength + dataLength + 2 + 2;
-    uint16_t* ptr = (uint16_t*)&mqttPayload[2];
-    *ptr = htons(topicLength);
-    for(i = 0;i < topicLength;i++)
-        mqttPayload[i+4] = topic[i];
-    mqttPayload[i+4] = 0x10;
-    mqttPayload[i+5] = 0x11 + i;
-    for(j = 0;j < dataLength;j++)
-        mqttPayload[i+6+j] = data[j];
-    payLoadLength = mqttPayload[1] + 2;
+    offset = 1 + etherMqttEncodeLength(&mqttPayload[1], 2 + sendTopicLength + ((version == 5) ? 1 + propertyLength : 0) + dataLength);
+    mqttPayload[offset++] = HIBYTE(sendTopicLength);
+    mqttPayload[offset++] = LOBYTE(sendTopicLength);
+    for(i = 0;i < sendTopicLength;i++)
+        mqttPayload[offset++] = topic[i];
+    //QoS 0 publish carries no packet identifier
+    if(version == 5)
+    {
+        mqttPayload[offset++] = propertyLength;
+        if(propertyLength != 0)
+        {
+            mqttPayload[offset++] = MQTT_PROP_TOPIC_ALIAS;
+            mqttPayload[offset++] = HIBYTE(alias);
+            mqttPayload[offset++] = LOBYTE(alias);
+        }
+    }
+    for(i = 0;i < dataLength;i++)
+        mqttPayload[offset++] = data[i];
+    return offset;
+}
+
+//Creates a Mqtt Topic Payload with passed parametres topic and data
+//With Mqtt 5.0 a topic alias replaces the topic once the broker knows it
+uint8_t* etherMqttCreatePublishPayload(uint8_t* mqttPayload,char* topic,char* data)
+{
+    uint16_t alias = 0;
+    bool known = false;
+    if(mqttProtocolVersion == 5)
+        alias = aliasGetOutbound(topic, strLen(topic), &known);
+    payLoadLength = etherMqttBuildPublish(mqttPayload, mqttProtocolVersion, topic, data, alias, known);
+    return mqttPayload;
+}
+
+//Creates a Mqtt PingReq payload
+uint8_t* etherMqttCreatePingReqPayload(uint8_t* mqttPayload)
+{
+    mqttPayload[0] = 0xC0;
+    mqttPayload[1] = 0x00;
+    payLoadLength = 2;
     return mqttPayload;
 }
 
@@ -1271,37 +1244,97 @@ uint8_t* etherMqttCreateDisconnectPayload(uint8_t* mqttPayload)
     return mqttPayload;
 }
 
-void printPublishData(etherHeader* ether)
+//Locates the topic and data of a received Mqtt Publish
+//Topic is not null terminated, a packet identifier is skipped for QoS 1 and 2
+//Returns false if the lengths do not fit in the packet or the segment, the packet is then dropped
+bool etherMqttGetPublishData(etherHeader* ether, char** topic, uint16_t* topicLength, uint8_t** data, uint16_t* dataLength)
 {
     ipHeader *ip = (ipHeader*)ether->data;
     uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
     tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
     uint8_t* copyData = tcp->data;
-    uint16_t* ptr = (uint16_t*)&copyData[2];
-    uint16_t topicLength = htons(*ptr);
+    uint16_t segmentLength = etherGetTcpDataLength(ether);
+    uint32_t remainingLength, propertyLength;
+    uint32_t offset, header, last, end;
+    uint16_t length, alias = 0;
+    if(segmentLength < 2)
+        return false;
+    offset = 1 + etherMqttDecodeLength(&copyData[1], &remainingLength);
+    header = offset;
+    last = offset + remainingLength;
+    if(last > segmentLength || offset + 2 > last)
+        return false;
+    length = (copyData[offset] << 8) | copyData[offset+1];
+    offset += 2 + length;
+    if((copyData[0] & 0x06) != 0)
+        offset += 2;
+    if(offset > last)
+        return false;
+    if(mqttProtocolVersion == 5)
+    {
+        offset += etherMqttDecodeLength(&copyData[offset], &propertyLength);
+        end = offset + propertyLength;
+        if(end > last)
+            return false;
+        while(offset < end)
+        {
+            uint8_t id = copyData[offset++];
+            if(id == MQTT_PROP_TOPIC_ALIAS)
+                alias = (copyData[offset] << 8) | copyData[offset+1];
+            offset += etherMqttPropertySize(id, &copyData[offset]);
+        }
+        if(offset != end)
+            return false;
+    }
+    *topicLength = length;
+    *topic = (char*)&copyData[header+2];
+    //An aliased publish either sets the mapping or relies on it
+    if(alias != 0)
+    {
+        if(*topicLength > 0)
+            aliasStoreInbound(alias, *topic, *topicLength);
+        else
+        {
+            *topic = aliasGetInbound(alias, topicLength);
+            if(*topic == 0)
+            {
+                *topic = "";
+                *topicLength = 0;
+            }
+        }
+    }
+    *data = &copyData[offset];
+    *dataLength = last - offset;
+    return true;
+}
+
+void printPublishData(etherHeader* ether)
+{
+    char* topic;
+    uint8_t* data;
+    uint16_t topicLength, dataLength;
+    if(etherMqttGetPublishData(ether, &topic, &topicLength, &data, &dataLength))
+        printTopicData(topic, topicLength, data, dataLength);
+}
+
+// Prints a received publish to Putty, also used for publishes arriving over MQTT-SN
+void printTopicData(char* topic, uint16_t topicLength, uint8_t* data, uint16_t dataLength)
+{
     char str[20];
-    uint8_t i,j;
     putsUart0("There has been a publish to topic you have subscribed\r\n");
     putsUart0("Topic Length : ");
-    itoa((uint16_t)topicLength,str,10);
+    itoa(topicLength,str,10);
     putsUart0(str);
     putsUart0("\r\n");
     putsUart0("Topic : ");
-    for(i = 0;i < topicLength;i++)
-    {
-        putcUart0((char)copyData[i+4]);
-    }
+    writeUart0(topic, topicLength);
     putsUart0("\r\n");
-    uint8_t dataLength = copyData[1] - 4 - topicLength;
     putsUart0("Data Length : ");
     itoa(dataLength, str, 10);
     putsUart0(str);
     putsUart0("\r\n");
     putsUart0("Data : ");
-    for(j = 0;j < dataLength;j++)
-    {
-        putcUart0((char)copyData[i+j+6]);
-    }
+    writeUart0((char*)data, dataLength);
     putsUart0("\r\n");
 
 }
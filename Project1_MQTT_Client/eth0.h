@@ -126,6 +126,15 @@ typedef struct _tcpHeader // 20 or more bytes
   uint8_t  data[0];
 } tcpHeader;
 
+typedef enum _tcpState
+{
+    tcpClosed = 0,                  // slot is free
+    tcpSynSent = 1,
+    tcpEstablished = 2,
+    tcpClosing = 3
+} tcpState;
+
+// Connection control block, see tcp.c
 typedef struct _socket
 {
   uint16_t sourcePort;
@@ -134,6 +143,11 @@ typedef struct _socket
   uint16_t destPort;
   uint8_t  destIp[4];
   uint8_t  destAddress[6];
+  uint8_t  state;
+  uint32_t sequenceNumber;
+  uint32_t acknowledgementNumber;
+  uint32_t unacknowledged;          // oldest sequence number not yet acknowledged (SND.UNA)
+  uint32_t windowEnd;               // first sequence number past the peer's receive window
 } socket;
 
 typedef enum
@@ -155,7 +169,8 @@ typedef enum
     waitForFinAck = 15,
     acknowLedgeConnection = 16,
     closeConnection = 17,
-    waitForServerReset = 18
+    sendPingReq = 19,
+    resolveBroker = 20
 
 } state;
 
@@ -170,6 +185,9 @@ typedef enum
 #define ETHER_HALFDUPLEX     0x00
 #define ETHER_FULLDUPLEX     0x100
 
+// Enough of a frame to see ethernet, ip with options and the start of icmp
+#define ETHER_PEEK_SIZE 82
+
 #define LOBYTE(x) ((x) & 0xFF)
 #define HIBYTE(x) (((x) >> 8) & 0xFF)
 
@@ -182,23 +200,49 @@ typedef enum
 #define TCP_FIN      0x01
 #define TCP_RESET    0x04
 #define TCP_REST_ACK 0x14
+
+// Maximum segment size advertised in SYN, also used to split outbound Mqtt packets
+#define TCP_MSS      1220
+
+// Mqtt keepalive advertised in CONNECT (seconds)
+#define MQTT_KEEPALIVE 60
+
+// Mqtt SubAck return codes at or above this value reject the topic
+#define MQTT_SUBACK_FAILURE 0x80
+
+// Mqtt 5.0 property identifiers
+#define MQTT_PROP_SESSION_EXPIRY      0x11
+#define MQTT_PROP_TOPIC_ALIAS_MAXIMUM 0x22
+#define MQTT_PROP_TOPIC_ALIAS         0x23
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
+void etherStart();
+bool etherIsClockReady();
 void etherInit(uint16_t mode);
+void etherEndLedTest();
 bool etherIsLinkUp();
 
 bool etherIsDataAvailable();
 bool etherIsOverflow();
+void etherIsr();
+void etherEnableInterrupt();
+bool etherIsTxDone();
+uint16_t etherGetTxAbortCount();
 uint16_t etherGetPacket(etherHeader *ether, uint16_t maxSize);
+uint16_t etherPeekPacket(etherHeader *ether, uint16_t peekSize);
+uint16_t etherFinishPacket(etherHeader *ether, uint16_t maxSize);
 bool etherPutPacket(etherHeader *ether, uint16_t size);
+bool etherIsPeeked(uint16_t peekSize, uint16_t size);
+bool etherPutPacketInPlace(etherHeader *ether, uint16_t headerSize, uint16_t size);
 
 bool etherIsIp(etherHeader *ether);
 bool etherIsIpUnicast(etherHeader *ether);
 
 bool etherIsPingRequest(etherHeader *ether);
 void etherSendPingResponse(etherHeader *ether);
+bool etherSendPingResponseInPlace(etherHeader *ether);
 
 bool etherIsArpRequest(etherHeader *ether);
 void etherSendArpResponse(etherHeader *ether);
@@ -209,6 +253,8 @@ bool etherIsUdp(etherHeader *ether);
 uint8_t* etherGetUdpData(etherHeader *ether);
 void etherSendUdpResponse(etherHeader *ether, uint8_t* udpData, uint8_t udpSize);
 
+bool etherSendUdp(etherHeader *ether, uint16_t sourcePort, uint8_t destIp[4], uint16_t destPort, uint8_t *udpData, uint16_t udpSize);
+uint8_t * etherGetUdpTxData(etherHeader *ether);
 void etherEnableDhcpMode();
 void etherDisableDhcpMode();
 bool etherIsDhcpEnabled();
@@ -226,27 +272,47 @@ void etherSetMqttBrokerIp(uint8_t mqttBIp0,uint8_t mqttBIp1,uint8_t mqttBIp2,uin
 void etherGetMqttBrokerIpAddress(uint8_t mqttBIp[4]);
 void etherSetMqttBrokerHW(uint8_t mqttBMac0,uint8_t mqttBMac1,uint8_t mqttBMac2,uint8_t mqttBMac3,uint8_t mqttBMac4,uint8_t mqttBMac5);
 void etherGetMqttBrokerMacAddress(uint8_t mqttBMac[6]);
-void etherStoreMqttMacAddress(etherHeader* ether);
-void etherFillUpMqttConnectionSocket();
+bool etherIsArp(etherHeader* ether);
+bool etherIsIpOnLink(uint8_t ip[4]);
+bool etherGetNextHop(uint8_t ip[4], uint8_t nextHop[4]);
+void etherLearnArp(etherHeader* ether);
+bool etherIsMqttBrokerMacKnown();
+void etherForgetMqttBrokerMac();
 
 void etherSendTcp(etherHeader* ether,socket* s,uint16_t flags,uint8_t* tcpData,uint16_t dataLength);
 bool etherIsTcp(etherHeader *ether);
 bool etherIsTcpAck(etherHeader *ether);
+uint16_t etherGetTcpDataLength(etherHeader* ether);
 bool etherIsTcpFinAck(etherHeader* ether);
-bool etherIsTcpResetAck(etherHeader* ether);
+bool etherIsTcpReset(etherHeader* ether);
 
+uint16_t etherMqttBuildConnect(uint8_t* mqttPayload, uint8_t version, bool persistent, uint16_t keepAlive, char* clientId);
+uint16_t etherMqttBuildPublish(uint8_t* mqttPayload, uint8_t version, char* topic, char* data, uint16_t alias, bool known);
 uint8_t* etherMqttCreateConnectPayload(uint8_t* mqttPayload);
-uint8_t* etherMqttCreateSubscribePayload(uint8_t* mqttPayload,char* subTopic);
-uint8_t* etherMqttCreateUnSubscribePayload(uint8_t* mqttPayload,char* subTopic);
 uint8_t* etherMqttCreatePublishPayload(uint8_t* mqttPayload,char* topic,char* data);
 uint8_t* etherMqttCreateDisconnectPayload(uint8_t* mqttPayload);
+uint8_t* etherMqttCreatePingReqPayload(uint8_t* mqttPayload);
+uint8_t etherMqttCreateSubscribeListPayload(uint8_t* mqttPayload, uint16_t maxSize, char* topics[], uint8_t qos[], uint8_t count);
+uint8_t etherMqttCreateUnSubscribeListPayload(uint8_t* mqttPayload, uint16_t maxSize, char* topics[], uint8_t count);
+uint8_t etherMqttGetSubAckReturnCodes(etherHeader* ether, uint16_t start, uint8_t codes[], uint8_t maxCodes);
+uint16_t etherMqttNextPacketId();
+uint8_t etherMqttEncodeLength(uint8_t* dest, uint32_t length);
+uint8_t etherMqttDecodeLength(uint8_t* src, uint32_t* length);
+uint32_t etherMqttGetPacketLength(uint8_t* packet);
+uint16_t etherMqttPropertySize(uint8_t id, uint8_t* value);
+void etherMqttSetProtocolVersion(uint8_t version);
+uint8_t etherMqttGetProtocolVersion();
 
 bool etherIsMqttConnectAck(etherHeader* ether);
+void etherMqttProcessConnectAck(etherHeader* ether);
 bool etherIsMqttSubAck(etherHeader* ether);
 bool etherIsMqttUnSubAck(etherHeader* ether);
 bool etherIsMqttPublish(etherHeader* ether);
+bool etherIsMqttPingResp(etherHeader* ether);
 
+bool etherMqttGetPublishData(etherHeader* ether, char** topic, uint16_t* topicLength, uint8_t** data, uint16_t* dataLength);
 void printPublishData(etherHeader* ether);
+void printTopicData(char* topic, uint16_t topicLength, uint8_t* data, uint16_t dataLength);
 
 uint16_t htons(uint16_t value);
 uint32_t htonl(uint32_t value);
@@ -29,8 +29,8 @@
 //   DIN (UART1TX) on PC5
 //   DOUT (UART1RX) on PC4
 
-// My MAC address assigned
-// 02-03-04-05-06-112
+// MAC address
+// 02-03-xx-xx-xx-xx made up on first boot and kept in EEPROM, or SET MAC
 // My IP address assigned
 // 192.168.1.112
 
@@ -63,11 +63,35 @@
 #include "clock.h"
 #include "gpio.h"
 #include "spi0.h"
+#include "adc0.h"
 #include "uart0.h"
+#include "console.h"
 #include "wait.h"
 #include "eth0.h"
 #include "eeprom.h"
-#include "tm4c123gh6pm.h"
+#include "config.h"
+#include "boot.h"
+#include "spool.h"
+#include "topic.h"
+#include "alias.h"
+#include "timer.h"
+#include "timer4.h"
+#include "keepalive.h"
+#include "session.h"
+#include "reconnect.h"
+#include "arp.h"
+#include "dhcp.h"
+#include "dns.h"
+#include "udp.h"
+#include "mqttsn.h"
+#include "tcp.h"
+#include "mirror.h"
+#include "cli.h"
+#include "trace.h"
+#include "sched.h"
+#include "idle.h"
+#include "pbuf.h"
+#include "cpu.h"
 
 // Pins
 #define RED_LED PORTF,1
@@ -76,16 +100,12 @@
 #define PUSH_BUTTON PORTF,4
 
 //Macros
-#define IP_STORED_PERSISTENTLY  100
-#define MQTT_STORED_PERSITENTLY 200
-#define IP_IN_EEPROM            readEeprom(0x0000) == IP_STORED_PERSISTENTLY
-#define MQTT_IN_EEPROM          readEeprom(0x0010) == MQTT_STORED_PERSITENTLY
+#define UDP_DEMO_PORT           1024
 
 //Globals
-uint32_t sequenceNumber = 0;
-uint32_t acknowledgementNumber = 0;
 uint32_t payLoadLength = 0;
 state currentState = idle;
+bool mqttSnTransport = false;
 
 //-----------------------------------------------------------------------------
 // Subroutines                
@@ -99,7 +119,6 @@ void initHw()
 
     // Enable clocks
     enablePort(PORTF);
-    _delay_cycles(3);
 
     // Configure LED and pushbutton pins
     selectPinPushPullOutput(RED_LED);
@@ -108,9 +127,78 @@ void initHw()
     selectPinDigitalInput(PUSH_BUTTON);
 }
 
-void displayConnectionInfo()
+//Broker hostname, empty when the broker is set by address
+char mqttHost[DNS_NAME_LENGTH];
+
+//Hostname is stored without its terminator
+void storeMqttHost()
+{
+    configSet(configMqttHost, mqttHost, strlen(mqttHost));
+}
+
+void loadMqttHost()
+{
+    uint8_t length = configGet(configMqttHost, mqttHost, DNS_NAME_LENGTH - 1);
+    mqttHost[length < DNS_NAME_LENGTH - 1 ? length : DNS_NAME_LENGTH - 1] = '\0';
+}
+
+//Stores the four address fields of a SET command under key
+void storeAddress(configKey key, USER_DATA* info)
+{
+    uint8_t i;
+    uint8_t address[4];
+    for(i = 0; i < 4; i++)
+        address[i] = getFieldInt(info, 3 + i);
+    configSet(key, address, 4);
+}
+
+//Reports any topic of a SubAck batch the broker refused
+//start is the offset of the SubAck within the segment
+void reportSubAck(etherHeader* data, uint16_t start)
+{
+    uint8_t subAckCodes[SESSION_MAX_TOPICS];
+    uint8_t i, codeCount;
+    char str[40];
+    codeCount = etherMqttGetSubAckReturnCodes(data, start, subAckCodes, SESSION_MAX_TOPICS);
+    for(i = 0; i < codeCount; i++)
+        if(subAckCodes[i] >= MQTT_SUBACK_FAILURE)
+        {
+            sprintf(str, "Subscription %u of batch rejected\r\n", i + 1);
+            putsUart0(str);
+        }
+}
+
+//Sends an Mqtt packet to the primary broker, every packet sent restarts the keepalive interval
+void sendMqttPacket(etherHeader* data, socket* s, uint8_t* payload, uint16_t length)
+{
+    etherSendTcp(data, s, TCP_PUSH_ACK, payload, length);
+    keepAliveNoteSent();
+}
+
+//Largest Mqtt Publish of topic and data, checked against the broker's window before
+//the packet is built since building it may assign a topic alias
+uint16_t getPublishSizeBound(char* topic, char* data)
+{
+    return strlen(topic) + strlen(data) + 9;
+}
+
+//Turns the green LED on or off for "on" and "off" sent to the UDP demo port
+void udpDemoHandler(etherHeader* data, uint8_t srcIp[4], uint16_t srcPort, uint8_t* udpData, uint16_t size)
 {
+    char command[4] = {0};
     uint8_t i;
+    for(i = 0; i < size && i < 3; i++)
+        command[i] = udpData[i];
+    if (strcmp(command, "on") == 0)
+        setPinValue(GREEN_LED, 1);
+    if (strcmp(command, "off") == 0)
+        setPinValue(GREEN_LED, 0);
+    udpSendTo(data, UDP_DEMO_PORT, srcIp, srcPort, (uint8_t*)"Received", 9);
+}
+
+void displayConnectionInfo()
+{
+    uint8_t i, j;
     char str[10];
     uint8_t mac[6];
     uint8_t ip[4];
@@ -148,6 +236,17 @@ void displayConnectionInfo()
             putcUart0('.');
     }
     putsUart0("\r\n");
+    if (etherIsDhcpEnabled())
+    {
+        char dhcpStr[60];
+        if (dhcpIsBound())
+            sprintf(dhcpStr, "DHCP: bound, %lu s of lease left\r\n", (unsigned long)dhcpGetLeaseRemaining());
+        else
+            sprintf(dhcpStr, "DHCP: acquiring (state %u)\r\n", dhcpGetState());
+        putsUart0(dhcpStr);
+    }
+    else
+        putsUart0("DHCP: off, static address\r\n");
     etherGetIpGatewayAddress(ip);
     putsUart0("GW: ");
     for (i = 0; i < 4; i++)
@@ -168,6 +267,43 @@ void displayConnectionInfo()
             putcUart0('.');
     }
     putsUart0("\r\n");
+    if (mqttHost[0] != '\0')
+    {
+        putsUart0("MQTT host: ");
+        putsUart0(mqttHost);
+        putsUart0("\r\n");
+    }
+    {
+        char udpStr[40];
+        sprintf(udpStr, "UDP: %u sockets, %u dropped\r\n", udpGetBoundCount(), udpGetDropCount());
+        putsUart0(udpStr);
+    }
+    {
+        char uartStr[50];
+        sprintf(uartStr, "Console: %u tx dropped, %u rx dropped\r\n", getUart0TxDropCount(), getUart0RxDropCount());
+        putsUart0(uartStr);
+    }
+    dnsGetServer(ip);
+    putsUart0("DNS: ");
+    for (i = 0; i < 4; i++)
+    {
+        sprintf(str, "%u", ip[i]);
+        putsUart0(str);
+        if (i < 4-1)
+            putcUart0('.');
+    }
+    putsUart0("\r\n");
+    etherGetMqttBrokerIpAddress(ip);
+    if (etherIsIpOnLink(ip))
+        putsUart0("MQTT route: direct\r\n");
+    else if (etherGetNextHop(ip, ip))
+    {
+        char routeStr[50];
+        sprintf(routeStr, "MQTT route: via gateway %u.%u.%u.%u\r\n", ip[0], ip[1], ip[2], ip[3]);
+        putsUart0(routeStr);
+    }
+    else
+        putsUart0("MQTT route: none, broker is off subnet and no gateway is set\r\n");
     etherGetMqttBrokerMacAddress(mac);
     putsUart0("MQTT HW: ");
     for (i = 0; i < 6; i++)
@@ -178,6 +314,17 @@ void displayConnectionInfo()
             putcUart0(':');
     }
     putsUart0("\r\n");
+    for (j = 0; j < ARP_CACHE_SIZE; j++)
+    {
+        char arpStr[60];
+        uint32_t age;
+        if (arpGetEntry(j, ip, mac, &age))
+        {
+            sprintf(arpStr, "ARP: %u.%u.%u.%u at %02x:%02x:%02x:%02x:%02x:%02x, %lu s old\r\n",
+                    ip[0], ip[1], ip[2], ip[3], mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], (unsigned long)(age / 1000));
+            putsUart0(arpStr);
+        }
+    }
     if (etherIsLinkUp())
         putsUart0("Link is up\r\n");
     else
@@ -190,358 +337,1325 @@ void displayConnectionInfo()
         putsUart0("Tcp Connection is Active\r\n");
     else
         putsUart0("Tcp Connection is closed\r\n");
+    sprintf(str, "%u", etherMqttGetProtocolVersion());
+    putsUart0("Mqtt protocol level: ");
+    putsUart0(str);
+    putsUart0("\r\n");
+    if(etherMqttGetProtocolVersion() == 5)
+    {
+        char aliasStr[64];
+        snprintf(aliasStr, sizeof(aliasStr), "Topic aliases: %lu publishes, %ld bytes saved\r\n", (unsigned long)aliasGetAliasedCount(), (long)aliasGetBytesSaved());
+        putsUart0(aliasStr);
+    }
+    if(mqttSnTransport)
+    {
+        char snStr[96];
+        snprintf(snStr, sizeof(snStr), "MQTT-SN: %s, %u topics registered, %lu messages in %lu bytes\r\n",
+                mqttSnGetState() == mqttSnConnected ? "connected" : "not connected", mqttSnGetRegisteredCount(),
+                (unsigned long)mqttSnGetSentCount(), (unsigned long)mqttSnGetSentBytes());
+        putsUart0(snStr);
+    }
+    {
+        char tcpStr[80];
+        uint8_t mirrorIp[4];
+        mirrorGetBroker(mirrorIp);
+        sprintf(tcpStr, "TCP connections: %u of %u\r\n", tcpGetOpenCount(), TCP_MAX_CONNECTIONS);
+        putsUart0(tcpStr);
+        if(mirrorIp[0] | mirrorIp[1] | mirrorIp[2] | mirrorIp[3])
+        {
+            sprintf(tcpStr, "Mirror %u.%u.%u.%u: %s, %lu publishes copied\r\n", mirrorIp[0], mirrorIp[1], mirrorIp[2], mirrorIp[3],
+                    mirrorGetState() == mirrorLive ? "connected" : "not connected", (unsigned long)mirrorGetPublishCount());
+            putsUart0(tcpStr);
+        }
+    }
+    {
+        char traceStr[50];
+        sprintf(traceStr, "Trace: %lu records, %lu lost\r\n", (unsigned long)traceGetCount(), (unsigned long)traceGetLostCount());
+        putsUart0(traceStr);
+    }
+    putsUart0("Spooled messages: ");
+    sprintf(str, "%u", spoolGetCount());
+    putsUart0(str);
+    putsUart0("\r\n");
+    {
+        char configStr[80];
+        sprintf(configStr, "Config: commit %lu in slot %u, %u of %u bytes%s\r\n", (unsigned long)configGetSequence(),
+                configGetSlot(), configGetUsed(), CONFIG_MAX_BYTES, configIsPending() ? ", saving" : "");
+        putsUart0(configStr);
+    }
+    putsUart0("Client ID: ");
+    putsUart0(sessionGetClientId());
+    putsUart0(sessionIsPersistent() ? ", persistent session" : ", clean session");
+    putsUart0(sessionIsPresent() ? " (resumed)\r\n" : "\r\n");
+    if(reconnectIsEnabled())
+    {
+        char reconnectStr[104];
+        snprintf(reconnectStr, sizeof(reconnectStr), "Reconnect: %u failed attempts, last %lu ms to CONNACK, %lu ms to first message\r\n",
+                reconnectGetAttempts(), (unsigned long)reconnectGetConnectLatency(), (unsigned long)reconnectGetMessageLatency());
+        putsUart0(reconnectStr);
+    }
 }
 
 //-----------------------------------------------------------------------------
 // Main
 //-----------------------------------------------------------------------------
 
-// Max packet is calculated as:
-// Ether frame header (18) + Max MTU (1500) + CRC (4)
-#define MAX_PACKET_SIZE 1522
-#define MAX_PAYLOAD 50
-int main(void)
+#define MAX_PAYLOAD TCP_MSS
+uint8_t mqttPayload[MAX_PAYLOAD];
+
+//Commands hand work to the main loop through these
+//A reconnect resubscribes every topic the session holds, so the list is sized to match
+char* topicList[SESSION_MAX_TOPICS];
+uint8_t qosList[SESSION_MAX_TOPICS];
+uint8_t topicCount = 0;
+uint8_t topicsSent = 0;
+//A list can take several passes to send, so its topics point into this copy of the
+//command line rather than into the console buffer the next line overwrites
+char topicLine[MAX_CHARS+1];
+//Topics held by the session are still to be resubscribed after CONNECT
+bool resubscribe = false;
+char* pubTopic;
+char* pubData;
+socket* brokerSocket = 0;
+//The oldest spooled message is on the wire, and is retired once the broker
+//acknowledges the sequence number just past it
+bool spoolSent = false;
+uint32_t spoolSentEnd;
+
+//True from CONNACK until the connection ends, including the steps that send on it
+bool isBrokerSessionUp()
 {
-    uint8_t* udpData;
-    uint8_t mqttPayload[MAX_PAYLOAD];
-    char* subTopic;
-    char* pubTopic;
-    char* pubData;
-    char* unSubTopic;
-    uint8_t buffer[MAX_PACKET_SIZE];
-    etherHeader *data = (etherHeader*) buffer;
-    socket s;
-    USER_DATA info;
+    return currentState == mqttSocketLive || currentState == acknowLedgeConnection || currentState == keepConnectionAlive
+            || currentState == sendSubPacket || currentState == sendUnSubPacket || currentState == sendPublishPacket
+            || currentState == sendPingReq;
+}
 
-    // Init controller
-    initHw();
+//Returns the broker connection to the TCP table once it has ended
+//A spooled message still waiting for its ACK is sent again on the next connection,
+//as are the session's subscriptions if the broker has lost them
+void closeBrokerSocket()
+{
+    tcpClose(brokerSocket);
+    brokerSocket = 0;
+    spoolSent = false;
+    resubscribe = false;
+}
 
-    // Setup UART0
-    initUart0();
-    setUart0BaudRate(115200, 40e6);
+//-----------------------------------------------------------------------------
+// Console commands
+//-----------------------------------------------------------------------------
 
-    // Setup EEPROM
-    initEeprom();
+cliTable commandTable;
+cliTable setTable;
 
-    // Init ethernet interface (eth0)
-    putsUart0("Starting eth0\r\n");
-    etherSetMacAddress(2, 3, 4, 5, 6, 112);
+//Reset the board, after settings are saved and the reply has left the UART
+void commandReboot(USER_DATA* info, etherHeader* ether)
+{
+    configFlush();
+    putsUart0("Is a Valid Command for Reset,Performing System Reset\r\n");
+    flushUart0();
+    resetSystem();
+}
+
+void commandStatus(USER_DATA* info, etherHeader* ether)
+{
+    displayConnectionInfo();
+}
+
+//Per event counts and the longest wait and run times, in microseconds
+void commandEvents(USER_DATA* info, etherHeader* ether)
+{
+    uint8_t i;
+    char eventStr[128];
+    const char* eventNames[schedEventCount] = {"network", "tx done", "mqtt", "timer", "console"};
+    const char* idleNames[idleStateCount] = {"sleep", "tickless"};
+    uint32_t uptime, residency;
+    for(i = 0; i < schedEventCount; i++)
+    {
+        sprintf(eventStr, "Event %s: %lu handled, longest wait %lu us, longest run %lu us\r\n", eventNames[i],
+                (unsigned long)schedGetDispatchCount((schedEvent)i), (unsigned long)schedGetMaxWait((schedEvent)i),
+                (unsigned long)schedGetMaxRun((schedEvent)i));
+        putsUart0(eventStr);
+    }
+    sprintf(eventStr, "Ethernet: %u transmissions aborted\r\n", etherGetTxAbortCount());
+    putsUart0(eventStr);
+    uptime = idleGetUptime();
+    for(i = 0; i < idleStateCount; i++)
+    {
+        residency = idleGetResidency((idleState)i);
+        sprintf(eventStr, "Idle %s: %lu entries, %lu ms (%lu%%), wake to dispatch %lu us avg %lu us max\r\n", idleNames[i],
+                (unsigned long)idleGetEntries((idleState)i), (unsigned long)residency,
+                (unsigned long)(uptime != 0 ? (uint64_t)residency * 100 / uptime : 0),
+                (unsigned long)idleGetAverageWake((idleState)i), (unsigned long)idleGetMaxWake((idleState)i));
+        putsUart0(eventStr);
+    }
+    sprintf(eventStr, "Idle mode: %s\r\n", idleGetTickless() ? "tickless" : "sleep");
+    putsUart0(eventStr);
+    for(i = 0; i < pbufClassCount; i++)
+    {
+        sprintf(eventStr, "Buffers %s: %u free, fewest %u, %lu refused\r\n", i == pbufSmall ? "small" : "large",
+                pbufGetFreeCount((pbufClass)i), pbufGetLowWater((pbufClass)i), (unsigned long)pbufGetExhaustedCount((pbufClass)i));
+        putsUart0(eventStr);
+    }
+}
+
+//Time from the time base starting to each boot step, in milliseconds
+void commandBoot(USER_DATA* info, etherHeader* ether)
+{
+    uint8_t i;
+    char bootStr[60];
+    uint32_t mark;
+    const char* bootNames[bootStepCount] = {"time base", "config", "ENC28J60 clock", "ENC28J60", "scheduler",
+                                            "link up", "address", "broker ARP", "TCP", "CONNACK"};
+    for(i = 0; i < bootStepCount; i++)
+    {
+        if(!bootIsMarked((bootStep)i))
+            continue;
+        mark = bootGetMark((bootStep)i);
+        sprintf(bootStr, "Boot %s: %lu.%03lu ms\r\n", bootNames[i], (unsigned long)(mark / 1000), (unsigned long)(mark % 1000));
+        putsUart0(bootStr);
+    }
+}
+
+void commandHelp(USER_DATA* info, etherHeader* ether)
+{
+    cliPrintHelp(&commandTable, "");
+    cliPrintHelp(&setTable, "SET ");
+}
+
+//A static address turns DHCP off until SET DHCP ON
+void setIp(USER_DATA* info, etherHeader* ether)
+{
+    dhcpStop();
     etherDisableDhcpMode();
+    etherSetIpAddress(getFieldInt(info,3),getFieldInt(info,4),getFieldInt(info,5),getFieldInt(info,6));
+    storeAddress(configIp, info);
+}
 
-    // Retrieve IP address from the one stored in EEPROM
-    if(IP_IN_EEPROM)
-        etherSetIpAddress(readEeprom(0x0060),readEeprom(0x0061),readEeprom(0x0062),readEeprom(0x0063));
+void setGw(USER_DATA* info, etherHeader* ether)
+{
+    etherSetIpGatewayAddress(getFieldInt(info,3),getFieldInt(info,4),getFieldInt(info,5),getFieldInt(info,6));
+    storeAddress(configGateway, info);
+}
+
+void setSn(USER_DATA* info, etherHeader* ether)
+{
+    etherSetIpSubnetMask(getFieldInt(info,3),getFieldInt(info,4),getFieldInt(info,5),getFieldInt(info,6));
+    storeAddress(configSubnet, info);
+}
+
+//SET MAC provisions the board's MAC address, the client ID follows it after a reset
+void setMac(USER_DATA* info, etherHeader* ether)
+{
+    uint8_t i;
+    uint8_t mac[6];
+    for(i = 0; i < 6; i++)
+        mac[i] = getFieldInt(info, 3 + i);
+    configSet(configMac, mac, 6);
+    putsUart0("MAC address is used after a reset\r\n");
+}
+
+//SET DHCP ON drops the static address and leases one, SET IP turns it off again
+void setDhcp(USER_DATA* info, etherHeader* ether)
+{
+    if(stringCompare(getFieldString(info, 3), "ON"))
+    {
+        configErase(configIp);
+        etherEnableDhcpMode();
+        etherSetIpAddress(0, 0, 0, 0);
+        initDhcp();
+    }
+}
+
+//SET VERSION 4|5 selects Mqtt 3.1.1 or 5.0 for the next CONNECT
+void setVersion(USER_DATA* info, etherHeader* ether)
+{
+    etherMqttSetProtocolVersion(getFieldInt(info, 3));
+}
+
+//SET MQTT a b c d sets the broker address, SET MQTT host.name resolves it by DNS
+void setMqtt(USER_DATA* info, etherHeader* ether)
+{
+    uint8_t i;
+    bool isAddress = (info->fieldCount == 7);
+    for(i = 3; i < info->fieldCount; i++)
+        isAddress &= (getFieldString(info, i)[0] >= '0' && getFieldString(info, i)[0] <= '9');
+    if(isAddress)
+    {
+        mqttHost[0] = '\0';
+        configErase(configMqttHost);
+        etherSetMqttBrokerIp(getFieldInt(info, 3), getFieldInt(info, 4), getFieldInt(info, 5), getFieldInt(info, 6));
+        storeAddress(configMqtt, info);
+    }
     else
-        etherSetIpAddress(192, 168, 1, 112);
+    {
+        //the parser split the name at its dots, put them back
+        uint8_t length = 0;
+        char* label;
+        for(i = 3; i < info->fieldCount; i++)
+        {
+            label = getFieldString(info, i);
+            if(i > 3 && length < DNS_NAME_LENGTH - 1)
+                mqttHost[length++] = '.';
+            while(*label != '\0' && length < DNS_NAME_LENGTH - 1)
+                mqttHost[length++] = *label++;
+        }
+        mqttHost[length] = '\0';
+        storeMqttHost();
+    }
+}
 
+//SET MIRROR a b c d copies every publish to a second broker, 0 0 0 0 turns it off
+void setMirror(USER_DATA* info, etherHeader* ether)
+{
+    uint8_t i;
+    uint8_t mirrorIp[4];
+    for(i = 0; i < 4; i++)
+        mirrorIp[i] = getFieldInt(info, 3 + i);
+    storeAddress(configMirror, info);
+    mirrorStop(ether);
+    mirrorSetBroker(mirrorIp);
+    if(reconnectIsEnabled())
+        mirrorStart();
+}
 
-    //Retrieve Mqtt Broker IP address if stored in EEPROM
-    if(MQTT_IN_EEPROM)
-        etherSetMqttBrokerIp(readEeprom(0x0080),readEeprom(0x0081),readEeprom(0x0082),readEeprom(0x0083));
+//SET TRANSPORT SN|TCP picks MQTT-SN to a gateway over UDP or MQTT over TCP
+void setTransport(USER_DATA* info, etherHeader* ether)
+{
+    if(currentState != idle || mqttSnGetState() != mqttSnDisconnected)
+        putsUart0("Disconnect before changing the transport\r\n");
     else
-        etherSetMqttBrokerIp(0, 0, 0, 0);
+        mqttSnTransport = stringCompare(getFieldString(info, 3), "SN");
+}
 
-    etherSetIpSubnetMask(255, 255, 255, 0);
-    etherSetIpGatewayAddress(192, 168, 1, 1);
-    etherInit(ETHER_UNICAST | ETHER_BROADCAST | ETHER_HALFDUPLEX);
-    waitMicrosecond(100000);
-//  displayConnectionInfo();
+//SET TRACE ON|OFF streams trace records to the console for tools/tracedecode.py
+void setTrace(USER_DATA* info, etherHeader* ether)
+{
+    traceSetStreaming(stringCompare(getFieldString(info, 3), "ON"));
+}
 
-    // Flash LED
-    setPinValue(GREEN_LED, 1);
-    waitMicrosecond(100000);
-    setPinValue(GREEN_LED, 0);
-    waitMicrosecond(100000);
+void setIdle(USER_DATA* info, etherHeader* ether)
+{
+    idleSetTickless(stringCompare(getFieldString(info, 3), "TICKLESS"));
+}
+
+//SET AUTOCONNECT ON connects to the broker as soon as the board has an address
+void setAutoConnect(USER_DATA* info, etherHeader* ether)
+{
+    uint8_t on = stringCompare(getFieldString(info, 3), "ON");
+    configSet(configAutoConnect, &on, 1);
+}
+
+void setDns(USER_DATA* info, etherHeader* ether)
+{
+    uint8_t i;
+    uint8_t dnsIp[4];
+    for(i = 0; i < 4; i++)
+        dnsIp[i] = getFieldInt(info, 3 + i);
+    dnsSetServer(dnsIp);
+    configSet(configDns, dnsIp, 4);
+}
+
+const cliCommand setCommands[] =
+{
+    {"IP",        4, setIp,        "a b c d    static address, turns DHCP off"},
+    {"GW",        4, setGw,        "a b c d    gateway"},
+    {"SN",        4, setSn,        "a b c d    subnet mask"},
+    {"MAC",       6, setMac,       "a b c d e f board MAC address, after a reset"},
+    {"DNS",       4, setDns,       "a b c d    DNS server"},
+    {"DHCP",      1, setDhcp,      "ON         lease an address"},
+    {"VERSION",   1, setVersion,   "4|5        MQTT 3.1.1 or 5.0"},
+    {"MQTT",      1, setMqtt,      "a b c d|host broker address or name"},
+    {"MIRROR",    4, setMirror,    "a b c d    second broker, 0 0 0 0 for none"},
+    {"TRANSPORT", 1, setTransport, "SN|TCP     MQTT-SN over UDP or MQTT over TCP"},
+    {"TRACE",     1, setTrace,     "ON|OFF     stream trace records"},
+    {"IDLE",      1, setIdle,      "TICKLESS|SLEEP stretch the tick while idle"},
+    {"AUTOCONNECT", 1, setAutoConnect, "ON|OFF     connect at boot"},
+};
+
+void commandSet(USER_DATA* info, etherHeader* ether)
+{
+    cliResult result = cliDispatch(&setTable, info, 2, ether);
+    if(result == cliUnknown)
+        cliPrintHelp(&setTable, "SET ");
+    else if(result == cliMissingArgs)
+        putsUart0("Missing arguments, HELP lists them\r\n");
+}
+
+//Send arp and get MAC address of MQTT server
+//The connection is then supervised and re-established until DISCONNECT
+//Hands the broker connection to the reconnect supervisor
+void connectBroker()
+{
+    reconnectEnable();
+    mirrorStart();
+    currentState = (mqttHost[0] != '\0') ? resolveBroker : sendArpReq;
+}
 
-    // Main Loop
-    // RTOS and interrupts would greatly improve this code,
-    // but the goal here is simplicity
-    while (true)
+void commandConnect(USER_DATA* info, etherHeader* ether)
+{
+    if(mqttSnTransport)
     {
-        // Put terminal processing here
-        if (kbhitUart0())
-        {
-            getsUart0(&info);        //get uart data into a USER INFO structure
-            putsUart0(info.buffer);  //display the info onto the terminal
-            putsUart0("\n\r");
-            parseFields(&info);      //parse information in the buffer and store it in the structure
-            //Is Command Reboot, Yes then perform Reset
-            if(isCommand(&info, "REBOOT", 0))
-            {
-                putsUart0("Is a Valid Command for Reset,Performing System Reset\r\n");
-                waitMicrosecond(10000);
-                NVIC_APINT_R = NVIC_APINT_VECTKEY | NVIC_APINT_SYSRESETREQ ;
-            }
-            //Is command Status,if yes display
-            else if(isCommand(&info, "STATUS", 0))
-            {
-                displayConnectionInfo();
-            }
-            //Is Command Set, if yes set IP
-            else if(isCommand(&info, "SET", 2))
-            {
-                if(stringCompare(getFieldString(&info, 2), "IP"))
-                {
-                    etherSetIpAddress(getFieldInt(&info,3),getFieldInt(&info,4),getFieldInt(&info,5),getFieldInt(&info,6));
-                    writeEeprom(0x0000,IP_STORED_PERSISTENTLY);
-                    writeEeprom(0x0060,getFieldInt(&info,3));
-                    writeEeprom(0x0061,getFieldInt(&info,4));
-                    writeEeprom(0x0062,getFieldInt(&info,5));
-                    writeEeprom(0x0063,getFieldInt(&info,6));
-                }
-                else if(stringCompare(getFieldString(&info, 2), "MQTT"))
-                {
-                    etherSetMqttBrokerIp(getFieldInt(&info, 3), getFieldInt(&info, 4), getFieldInt(&info, 5), getFieldInt(&info, 6));
-                    writeEeprom(0x0010, MQTT_STORED_PERSITENTLY);
-                    writeEeprom(0x0080,getFieldInt(&info,3));
-                    writeEeprom(0x0081,getFieldInt(&info,4));
-                    writeEeprom(0x0082,getFieldInt(&info,5));
-                    writeEeprom(0x0083,getFieldInt(&info,6));
-                }
-            }
-            //Is command Connect,Send arp and get MAC address of MQTT server
-            else if(isCommand(&info, "CONNECT", 0))
-            {
-                currentState = sendArpReq;
-            }
-            else if(isCommand(&info, "SUBSCRIBE", 1))
-            {
-                if(currentState == mqttSocketLive)
-                {
-                    //parse the text field and build a mqtt packet for subscribe
-                    subTopic = getFieldString(&info, 2);
-                    currentState = sendSubPacket;
-                }
-                else
-                    putsUart0("Establish connection to Mqtt Broker before subscribing to a Topic\r\n");
+        //The gateway listens at the broker address, names are not resolved for MQTT-SN
+        uint8_t gatewayIp[4];
+        etherGetMqttBrokerIpAddress(gatewayIp);
+        mqttSnSetGateway(gatewayIp, MQTTSN_GATEWAY_PORT);
+        mqttSnConnect(ether);
+        return;
+    }
+    connectBroker();
+}
 
-            }
-            else if(isCommand(&info, "UNSUBSCRIBE", 1))
-            {
-                if(currentState == mqttSocketLive)
-                {
-                    //parse the text field and build a mqtt packet for unsubscribe
-                    unSubTopic = getFieldString(&info, 2);
-                    currentState = sendUnSubPacket;
-                }
-                else
-                    putsUart0("Establish connection to Mqtt Broker before unsubscribing to a Topic\r\n");
-            }
-            else if(isCommand(&info, "PUBLISH", 2))
-            {
-                if(currentState == mqttSocketLive)
-                {
-                    //parse the text field and build a mqtt packet for Publish
-                    pubTopic = getFieldString(&info, 2);
-                    pubData = getFieldString(&info, 3);
-                    currentState = sendPublishPacket;
-                }
-                else
-                    putsUart0("Establish connection to Mqtt Broker before Publishing to a Topic\r\n");
-            }
-            else if(isCommand(&info, "DISCONNECT", 0))
+//Copies the command line so the fields of a topic list outlive the console buffer
+void keepTopicLine(USER_DATA* info)
+{
+    uint8_t i;
+    for(i = 0; i <= MAX_CHARS; i++)
+        topicLine[i] = info->buffer[i];
+}
+
+//Returns field of the line saved by keepTopicLine()
+char* getTopicLineField(USER_DATA* info, uint8_t field)
+{
+    return &topicLine[getFieldString(info, field) - info->buffer];
+}
+
+//Topics change only with no broker connection, or a live one with no topic list still going out
+//Between the two, a topic added now would miss the list already taken from the session
+bool isTopicListBusy()
+{
+    return (brokerSocket != 0 && currentState != mqttSocketLive) || resubscribe;
+}
+
+//A full session table or an overlong topic is reported, never dropped quietly
+void reportTopicNotKept(char* topic, char* consequence)
+{
+    char str[60];
+    putsUart0("Topic ");
+    putsUart0(topic);
+    putsUart0(" ");
+    putsUart0(consequence);
+    sprintf(str, ", the session holds %u topics of up to %u characters\r\n",
+            SESSION_MAX_TOPICS, SESSION_TOPIC_LENGTH - 1);
+    putsUart0(str);
+}
+
+//Remembers a subscription for reconnects and registers its filter so matching publishes are printed
+bool keepSubscription(char* topic, uint8_t qos)
+{
+    char* topics[SESSION_MAX_TOPICS];
+    uint8_t levels[SESSION_MAX_TOPICS];
+    uint8_t i, count;
+    if(!sessionAddSubscription(topic, qos))
+        return false;
+    if(topicTrieAdd(topic, printTopicData))
+        return true;
+    //Unsubscribed filters keep their nodes, rebuild the trie from the subscriptions still held
+    initTopicTrie();
+    count = sessionGetSubscriptions(topics, levels, SESSION_MAX_TOPICS);
+    for(i = 0; i < count; i++)
+        topicTrieAdd(topics[i], printTopicData);
+    return true;
+}
+
+//A persistent session can outlive the subscriptions held here, e.g. across a reboot
+void reportUnclaimedPublish(char* topic, uint16_t topicLength, uint8_t* data, uint16_t dataLength)
+{
+    putsUart0("Publish to ");
+    writeUart0(topic, topicLength);
+    putsUart0(" matches no subscription held here, SUBSCRIBE to see it\r\n");
+}
+
+void commandSubscribe(USER_DATA* info, etherHeader* ether)
+{
+    uint8_t i;
+    if(mqttSnTransport)
+    {
+        //Sent one at a time once connected, QoS 0 only
+        for(i = 2; i < info->fieldCount; i++)
+        {
+            char* field = getFieldString(info, i);
+            if(!(field[0] >= '0' && field[0] <= '2' && field[1] == '\0') && !mqttSnSubscribe(field))
+                putsUart0("MQTT-SN topic table full\r\n");
+        }
+    }
+    else if(isTopicListBusy())
+        putsUart0("Broker connection busy, SUBSCRIBE again in a moment\r\n");
+    else if(currentState == mqttSocketLive)
+    {
+        //SUBSCRIBE topic [qos] topic [qos] ..., all sent in as few packets as possible
+        keepTopicLine(info);
+        topicCount = 0;
+        topicsSent = 0;
+        for(i = 2; i < info->fieldCount; i++)
+        {
+            char* field = getTopicLineField(info, i);
+            if(topicCount > 0 && field[0] >= '0' && field[0] <= '2' && field[1] == '\0')
+                qosList[topicCount-1] = field[0] - '0';
+            else
             {
-                if(currentState == mqttSocketLive)
-                {
-                    //parse the text field and build a mqtt packet for disconnect
-                    currentState = sendDisconnect;
-                }
-                else
-                    putsUart0("Establish connection to Mqtt Broker before disconnecting\r\n");
+                topicList[topicCount] = field;
+                qosList[topicCount++] = 0;
             }
+        }
+        //Remembered so they can be restored if the broker loses the session
+        for(i = 0; i < topicCount; i++)
+            if(!keepSubscription(topicList[i], qosList[i]))
+                reportTopicNotKept(topicList[i], "subscribed now but not restored after a reconnect");
+        currentState = sendSubPacket;
+    }
+    else
+    {
+        //Held until CONNECT, which sends them in the same segment
+        char* topic = 0;
+        for(i = 2; i < info->fieldCount; i++)
+        {
+            char* field = getFieldString(info, i);
+            if(topic != 0 && field[0] >= '0' && field[0] <= '2' && field[1] == '\0')
+                sessionAddSubscription(topic, field[0] - '0');
             else
             {
-                putsUart0("Enter a Valid Command\r\n");
+                topic = field;
+                if(!keepSubscription(topic, 0))
+                    reportTopicNotKept(topic, "not subscribed");
             }
-
         }
+        putsUart0("Not connected, topics will be subscribed on CONNECT\r\n");
+    }
+}
 
-        //Check if the machine is in sendArpReq,if it is then send and wait for Arp Response
-        if(currentState == sendArpReq)
+void commandUnsubscribe(USER_DATA* info, etherHeader* ether)
+{
+    uint8_t i;
+    if(mqttSnTransport)
+    {
+        for(i = 2; i < info->fieldCount; i++)
+            mqttSnUnsubscribe(getFieldString(info, i));
+    }
+    else if(isTopicListBusy())
+        putsUart0("Broker connection busy, UNSUBSCRIBE again in a moment\r\n");
+    else if(currentState == mqttSocketLive)
+    {
+        //UNSUBSCRIBE topic topic ..., all sent in as few packets as possible
+        keepTopicLine(info);
+        topicCount = 0;
+        topicsSent = 0;
+        for(i = 2; i < info->fieldCount; i++)
         {
-            uint8_t mqttBIp[4];
-            etherGetMqttBrokerIpAddress(mqttBIp);
-            etherSendArpRequest(data,mqttBIp);
-            currentState = waitArpRes;
+            topicList[topicCount] = getTopicLineField(info, i);
+            sessionRemoveSubscription(topicList[topicCount]);
+            topicTrieRemove(topicList[topicCount++]);
         }
+        currentState = sendUnSubPacket;
+    }
+    else
+        putsUart0("Establish connection to Mqtt Broker before unsubscribing to a Topic\r\n");
+}
 
-        //Check if the machine is in sendSync state,if its send sync message and wait for syncack
-        if(currentState == sendTcpSyn)
+void commandPublish(USER_DATA* info, etherHeader* ether)
+{
+    if(mqttSnTransport)
+    {
+        //QoS 0 when connected, QoS -1 to short or predefined topics when not
+        pubData = getFieldString(info, 3);
+        if(!mqttSnPublish(ether, getFieldString(info, 2), (uint8_t*)pubData, strlen(pubData)))
+            putsUart0("MQTT-SN publish not sent\r\n");
+        return;
+    }
+    //The mirror broker gets its copy whatever the state of the primary
+    mirrorPublish(ether, getFieldString(info, 2), getFieldString(info, 3));
+    if(currentState == mqttSocketLive && spoolIsEmpty()
+            && tcpCanSend(brokerSocket, getPublishSizeBound(getFieldString(info, 2), getFieldString(info, 3))))
+    {
+        //parse the text field and build a mqtt packet for Publish
+        pubTopic = getFieldString(info, 2);
+        pubData = getFieldString(info, 3);
+        currentState = sendPublishPacket;
+    }
+    //Broker offline, its window full or earlier messages pending, keep order by spooling
+    else if(spoolPush(getFieldString(info, 2), getFieldString(info, 3)))
+        putsUart0(currentState == mqttSocketLive ? "Broker busy, message spooled\r\n" : "Broker not connected, message spooled\r\n");
+    else
+        putsUart0("Spool full, message dropped\r\n");
+}
+
+void commandDisconnect(USER_DATA* info, etherHeader* ether)
+{
+    if(mqttSnTransport)
+    {
+        mqttSnDisconnect(ether);
+        return;
+    }
+    mirrorStop(ether);
+    if(currentState == mqttSocketLive)
+    {
+        //parse the text field and build a mqtt packet for disconnect
+        reconnectDisable();
+        currentState = sendDisconnect;
+    }
+    else if(reconnectIsEnabled())
+    {
+        //Stop retrying, abandoning any handshake in progress
+        if(currentState == waitTcpSynAck || currentState == waitForConectAck)
+            etherSendTcp(ether, brokerSocket, TCP_RESET, 0, 0);
+        closeBrokerSocket();
+        reconnectDisable();
+        currentState = idle;
+        putsUart0("Reconnect cancelled\r\n");
+    }
+    else
+        putsUart0("Establish connection to Mqtt Broker before disconnecting\r\n");
+}
+
+//Adding a command is one line here, verbs match in any case
+const cliCommand commands[] =
+{
+    {"REBOOT",      0, commandReboot,      "reset the board"},
+    {"STATUS",      0, commandStatus,      "show addresses and connection state"},
+    {"HELP",        0, commandHelp,        "list commands"},
+    {"EVENTS",      0, commandEvents,      "event counts, latencies and sleep"},
+    {"BOOT",        0, commandBoot,        "boot timeline"},
+    {"SET",         1, commandSet,         "setting ... see the SET lines"},
+    {"CONNECT",     0, commandConnect,     "connect and stay connected"},
+    {"DISCONNECT",  0, commandDisconnect,  "disconnect and stop reconnecting"},
+    {"SUBSCRIBE",   1, commandSubscribe,   "topic [qos] ..."},
+    {"UNSUBSCRIBE", 1, commandUnsubscribe, "topic ..."},
+    {"PUBLISH",     2, commandPublish,     "topic data"},
+};
+
+//-----------------------------------------------------------------------------
+// Event handlers
+//-----------------------------------------------------------------------------
+
+//Run by schedRun() in priority order, each to completion
+//Every received frame, and every handler that sends, takes a large packet buffer
+//of its own and frees it before returning, so a reply being built never
+//overwrites a frame that is still wanted
+//Frames handled per network event, so a flood cannot starve the other events
+#define NETWORK_BUDGET 4
+//Period of the services that retry, age and time out
+#define SERVICE_PERIOD_MS 10
+
+USER_DATA info;
+uint16_t connectLength;
+char spoolTopic[SPOOL_MAX_MESSAGE];
+char spoolData[SPOOL_MAX_MESSAGE];
+state tracedState = idle;
+//Green and PHY LED flash at boot
+#define BOOT_LED_MS 100
+bool bootLedsOn = false;
+uint32_t bootLedTime;
+bool autoConnect = false;
+
+//Flashes the red LED for a receive overflow without holding up the handler
+void redLedOff()
+{
+    setPinValue(RED_LED, 0);
+}
+
+//One line per event, further lines are handled by the event posted for them
+void consoleEvent()
+{
+    cliResult result;
+    pbuf* frame = pbufAlloc(PBUF_LARGE_SIZE);
+    etherHeader* data;
+    //Try again once a buffer is free
+    if (frame == 0)
+    {
+        schedPost(schedConsole);
+        return;
+    }
+    data = (etherHeader*)frame->payload;
+    // Put terminal processing here
+    // Characters are collected a few at a time, packets keep flowing while a line is typed
+    if (getLineUart0(&info))
+    {
+        putsUart0(info.buffer);  //display the info onto the terminal
+        putsUart0("\n\r");
+        parseFields(&info);      //parse information in the buffer and store it in the structure
+        //The command table finds the handler, HELP lists the table
+        result = cliDispatch(&commandTable, &info, 1, data);
+        if(result == cliUnknown)
+            putsUart0("Enter a Valid Command\r\n");
+        else if(result == cliMissingArgs)
+            putsUart0("Missing arguments, HELP lists them\r\n");
+
+    }
+    pbufFree(frame);
+    if (kbhitUart0())
+        schedPost(schedConsole);
+    schedPost(schedMqtt);
+}
+
+//Frames are received until the budget runs out, then INT is unmasked again
+void networkEvent()
+{
+    uint8_t frames;
+    pbuf* frame;
+    etherHeader* data;
+    if (etherIsTxDone())
+        schedPost(schedTxDone);
+    for (frames = 0; frames < NETWORK_BUDGET && etherIsDataAvailable(); frames++)
+    {
+        if (etherIsOverflow())
         {
-            etherSendTcp(data, &s, TCP_SYNC,0,0);
-            currentState = waitTcpSynAck;
+            setPinValue(RED_LED, 1);
+            if(!restartTimer(redLedOff))
+                startOneshotTimer(redLedOff, 100);
         }
 
-        if(currentState == sendTcpAck)
+        //Leave the frame in the ENC28J60 until a buffer is free
+        frame = pbufAlloc(PBUF_LARGE_SIZE);
+        if (frame == 0)
+            break;
+        data = (etherHeader*)frame->payload;
+
+        // Get packet, ping requests are answered without reading their data
+        etherPeekPacket(data, ETHER_PEEK_SIZE);
+        if (etherSendPingResponseInPlace(data))
         {
-            etherSendTcp(data, &s, TCP_ACK,0,0);
-            setPinValue(BLUE_LED, 1);
-            currentState = tcpConnectionActive;
+            pbufFree(frame);
+            continue;
         }
+        etherFinishPacket(data, frame->size);
 
-        if(currentState == tcpConnectionActive)
+        //Learn from every ARP packet, including gratuitous ones
+        if (etherIsArp(data))
+            etherLearnArp(data);
+
+        // Handle ARP request
+        if (etherIsArpRequest(data))
         {
-            etherSendTcp(data, &s, TCP_PUSH_ACK , etherMqttCreateConnectPayload(mqttPayload), mqttPayload[1]+2);
-            currentState = waitForConectAck;
+            etherSendArpResponse(data);
         }
-        if(currentState == acknowLedgeConnection)
+
+        //Handle ARP Reply
+        if(etherIsArpReply(data) && (currentState == waitArpRes) && etherIsMqttBrokerMacKnown())
         {
-            etherSendTcp(data, &s, TCP_PUSH_ACK, 0, 0);
-            currentState = mqttSocketLive;
+            bootMark(bootBrokerArp);
+            currentState = sendTcpSyn;
         }
-        if(currentState == sendSubPacket)
+
+        // Handle IP datagram
+        if (etherIsIp(data))
         {
-            etherSendTcp(data, &s, TCP_PUSH_ACK, etherMqttCreateSubscribePayload(mqttPayload,subTopic), mqttPayload[1]+2);
-            currentState = mqttSocketLive;
+            //DHCP replies may be broadcast, and arrive before we have an address
+            if (etherIsUdp(data) && dhcpIsMessage(data))
+                dhcpProcess(data);
+        	else if (etherIsIpUnicast(data))
+        	{
+        	    //Handle TCP Datagrams, each goes to the connection its 4-tuple names
+        	    if(etherIsTcp(data) && mirrorIsSegment(data))
+        	        mirrorProcess(data);
+        	    else if(etherIsTcp(data) && brokerSocket != 0 && tcpFind(data) == brokerSocket)
+        	    {
+        	        //Every segment carries the broker's acknowledgement and window, whatever else it holds
+        	        tcpAcceptAck(brokerSocket, data);
+        	        //Is it Ack To a Sync Message?
+        	        if(etherIsTcpAck(data) || etherIsTcpReset(data))
+        	        {
+        	            etherHeader* ether = (etherHeader*)data;
+                        ipHeader *ip = (ipHeader*)ether->data;
+                        uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+                        tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
+                        uint16_t tcpFieldType = htons(tcp->offsetFields) & 0x0FFF;
+                        //If its a TCP Sync Ack state update the state to next state
+                        if(currentState == waitTcpSynAck && tcpFieldType == TCP_SYNACK)
+                        {
+                            tcpAcceptSegment(brokerSocket, data, 1);
+                            bootMark(bootTcp);
+                            currentState = sendTcpAck;
+                        }
+
+                        //If its a Mqtt Connect Ack,make the state as MqttSocketLive
+                        if((currentState == waitForConectAck))
+                            if(etherIsMqttConnectAck(data) && tcpFieldType == TCP_PUSH_ACK)
+                            {
+                                //The SubAck of a pipelined SUBSCRIBE may share the segment,
+                                //anything after it is left unacknowledged for the broker to resend
+                                connectLength = payLoadLength;
+                                if(etherGetTcpDataLength(data) > connectLength && tcp->data[connectLength] == 0x90)
+                                {
+                                    reportSubAck(data, connectLength);
+                                    connectLength += etherMqttGetPacketLength(&tcp->data[connectLength]);
+                                }
+                                tcpAcceptSegment(brokerSocket, data, connectLength);
+                                etherMqttProcessConnectAck(data);
+                                keepAliveStart(MQTT_KEEPALIVE);
+                                reconnectConnected();
+                                bootMark(bootConnAck);
+                                //Subscribe whatever did not fit behind CONNECT, or everything
+                                //if the broker lost a session we expected it to keep
+                                if(topicCount == 0 && !sessionIsPresent())
+                                {
+                                    topicCount = sessionGetSubscriptions(topicList, qosList, SESSION_MAX_TOPICS);
+                                    topicsSent = 0;
+                                }
+                                resubscribe = topicsSent < topicCount;
+                                currentState = acknowLedgeConnection;
+                            }
+
+                        //Broker closed or aborted the connection on its own, possibly between
+                        //the steps of an exchange and with a reset that carries no ACK
+                        if(isBrokerSessionUp() && (etherIsTcpReset(data) || tcpFieldType == TCP_FIN_ACK))
+                        {
+                            if(tcpFieldType == TCP_FIN_ACK)
+                            {
+                                tcpAcceptSegment(brokerSocket, data, 1);
+                                etherSendTcp(data, brokerSocket, TCP_RESET, 0, 0);
+                            }
+                            closeBrokerSocket();
+                            putsUart0("Mqtt Broker closed the connection\r\n");
+                            keepAliveStop();
+                            setPinValue(BLUE_LED, 0);
+                            currentState = idle;
+                            reconnectConnectionLost();
+                            //The broker may have failed over to a new address
+                            dnsFlush(mqttHost);
+                        }
+                        if(currentState == mqttSocketLive)
+                        {
+                            if((etherIsMqttSubAck(data) || (etherIsMqttUnSubAck(data)) || (etherIsMqttPublish(data)) || (etherIsMqttPingResp(data)))&& tcpFieldType == TCP_PUSH_ACK)
+                            {
+                                keepAliveNoteReceived();
+                                if(etherIsMqttPublish(data))
+                                {
+                                    //Route to the handlers registered for the topic, report anything no subscription claims
+                                    char* topic;
+                                    uint8_t* topicData;
+                                    uint16_t topicLength, topicDataLength;
+                                    reconnectNoteMessage();
+                                    if(etherMqttGetPublishData(data, &topic, &topicLength, &topicData, &topicDataLength)
+                                            && topicTrieDispatch(topic, topicLength, topicData, topicDataLength) == 0)
+                                        reportUnclaimedPublish(topic, topicLength, topicData, topicDataLength);
+                                }
+                                else if(etherIsMqttSubAck(data))
+                                    reportSubAck(data, 0);
+                                tcpAcceptSegment(brokerSocket, data, payLoadLength);
+                                currentState = acknowLedgeConnection;
+                            }
+                            else
+                            {
+                                if(tcpFieldType == TCP_ACK)
+                                {
+                                    tcpAcceptSegment(brokerSocket, data, 0);
+                                    currentState = keepConnectionAlive;
+                                }
+                            }
+                        }
+                        if(currentState == waitForFinAck)
+                        {
+                            if(etherIsTcpFinAck(data) && tcpFieldType == TCP_FIN_ACK)
+                            {
+                                tcpAcceptSegment(brokerSocket, data, 1);
+                                currentState = closeConnection;
+                            }
+                            //A broker may reset rather than close after DISCONNECT
+                            else if(etherIsTcpReset(data))
+                            {
+                                closeBrokerSocket();
+                                setPinValue(BLUE_LED, 0);
+                                currentState = idle;
+                            }
+                        }
+        	        }
+        	    }
+
+        		// handle icmp ping request
+					if (etherIsPingRequest(data))
+					{
+					  etherSendPingResponse(data);
+					}
+
+					// Process UDP datagram
+					if (etherIsUdp(data) && dnsIsMessage(data))
+					    dnsProcess(data);
+					else if (etherIsUdp(data))
+					    udpDispatch(data);
+            }
         }
+        pbufFree(frame);
+    }
+    if (frames == NETWORK_BUDGET && etherIsDataAvailable())
+        schedPost(schedNetwork);
+    else
+        etherEnableInterrupt();
+    schedPost(schedMqtt);
+}
 
-        if(currentState == sendUnSubPacket)
+//The last frame has gone, so a topic list being sent a segment at a time can continue
+void txDoneEvent()
+{
+    schedPost(schedMqtt);
+}
+
+//Boot steps that wait on hardware are polled here instead of being waited for
+void bootService()
+{
+    //The green and PHY LEDs flash together without holding up the boot
+    if(bootLedsOn && getTimerTicks() - bootLedTime >= BOOT_LED_MS)
+    {
+        etherEndLedTest();
+        setPinValue(GREEN_LED, 0);
+        bootLedsOn = false;
+    }
+    if(bootIsMarked(bootAddress))
+        return;
+    //Lease an address as soon as there is a link, from INIT-REBOOT when one is stored
+    if(!bootIsMarked(bootLinkUp) && etherIsLinkUp())
+    {
+        bootMark(bootLinkUp);
+        if(etherIsDhcpEnabled())
+            initDhcp();
+    }
+    if(bootIsMarked(bootLinkUp) && etherIsIpValid())
+    {
+        bootMark(bootAddress);
+        if(autoConnect && !mqttSnTransport && !reconnectIsEnabled())
         {
-            etherSendTcp(data, &s, TCP_PUSH_ACK, etherMqttCreateUnSubscribePayload(mqttPayload, unSubTopic), mqttPayload[1]+2);
-            currentState = mqttSocketLive;
+            putsUart0("Connecting to Mqtt Broker\r\n");
+            connectBroker();
         }
+    }
+}
+
+//Services driven by time rather than by traffic
+void timerEvent()
+{
+    pbuf* frame = pbufAlloc(PBUF_LARGE_SIZE);
+    etherHeader* data;
+    //The services run again next period
+    if (frame == 0)
+        return;
+    data = (etherHeader*)frame->payload;
+
+    //Commit spooled messages to EEPROM a few words at a time
+    spoolService();
+
+    //Commit changed settings a few words at a time
+    configService();
+
+    //Finish booting as the hardware becomes ready
+    bootService();
+
+    //Age the ARP cache and renew the entries in use before they expire
+    arpService(data);
+
+    //Repeat MQTT-SN requests and keep the gateway alive
+    if(mqttSnTransport)
+        mqttSnService(data);
 
-        if(currentState == sendPublishPacket)
+    //Open, keep alive and re-open the mirror broker connection
+    mirrorService(data);
+
+    //Send and repeat DNS queries
+    dnsService(data);
+
+    //Acquire, renew or rebind the DHCP lease
+    if(etherIsDhcpEnabled())
+        dhcpService(data);
+
+    //Keep the broker connection alive while idle and notice when the broker goes away
+    if(currentState == mqttSocketLive)
+    {
+        keepAliveAction action = keepAlivePoll();
+        if(action == keepAliveSendPing)
+            currentState = sendPingReq;
+        else if(action == keepAliveExpired)
         {
-            etherSendTcp(data, &s, TCP_PUSH_ACK, etherMqttCreatePublishPayload(mqttPayload, pubTopic, pubData), mqttPayload[1]+2);
-            currentState = mqttSocketLive;
+            putsUart0("No PINGRESP from Mqtt Broker, dropping connection\r\n");
+            etherSendTcp(data, brokerSocket, TCP_RESET, 0, 0);
+            closeBrokerSocket();
+            setPinValue(BLUE_LED, 0);
+            currentState = idle;
+            reconnectConnectionLost();
+            //The broker may have failed over to a new address
+            dnsFlush(mqttHost);
         }
+    }
+
+    //A handshake step that gets no answer counts as a failed attempt
+    if((currentState == waitArpRes || currentState == waitTcpSynAck || currentState == waitForConectAck) && reconnectAttemptTimedOut())
+    {
+        if(currentState != waitArpRes)
+            etherSendTcp(data, brokerSocket, TCP_RESET, 0, 0);
+        closeBrokerSocket();
+        //A cached MAC may be stale, learn it again next time
+        if(currentState == waitTcpSynAck)
+            etherForgetMqttBrokerMac();
+        setPinValue(BLUE_LED, 0);
+        currentState = idle;
+        reconnectConnectionLost();
+        //The broker may have failed over to a new address
+        dnsFlush(mqttHost);
+        putsUart0("Mqtt Broker not answering\r\n");
+    }
+
+    //Back off, then try the broker again
+    if(currentState == idle && reconnectPoll())
+    {
+        putsUart0("Reconnecting to Mqtt Broker\r\n");
+        currentState = (mqttHost[0] != '\0') ? resolveBroker : sendArpReq;
+    }
+
+    pbufFree(frame);
+    schedPost(schedMqtt);
+}
 
-        if(currentState == sendDisconnect)
+//Takes the MQTT state machine one step, posting itself again while the state keeps moving
+void mqttEvent()
+{
+    state before = currentState;
+    pbuf* frame = pbufAlloc(PBUF_LARGE_SIZE);
+    etherHeader* data;
+    bool windowFull = false;
+    //The next timer event posts this again
+    if (frame == 0)
+        return;
+    data = (etherHeader*)frame->payload;
+
+    //Finish the subscriptions left over from connecting
+    if(currentState == mqttSocketLive && resubscribe)
+    {
+        resubscribe = false;
+        currentState = sendSubPacket;
+    }
+
+    //Replay spooled messages in order once the broker connection is live
+    //Nothing is retransmitted, so a message stays in the spool until the broker's ACK covers
+    //it, one lost with its segment or the connection is sent again after reconnecting
+    //A message that doesn't fit the broker's window waits for the timer event to try again
+    if(currentState == mqttSocketLive && spoolSent && tcpIsAcknowledged(brokerSocket, spoolSentEnd))
+    {
+        spoolRemoveOldest();
+        spoolSent = false;
+    }
+    if(currentState == mqttSocketLive && !spoolSent && spoolGetOldest(spoolTopic, spoolData, SPOOL_MAX_MESSAGE))
+    {
+        if(tcpCanSend(brokerSocket, getPublishSizeBound(spoolTopic, spoolData)))
         {
-            etherSendTcp(data, &s, TCP_PUSH_ACK, etherMqttCreateDisconnectPayload(mqttPayload), mqttPayload[1]+2);
-            currentState = waitForFinAck;
+            etherMqttCreatePublishPayload(mqttPayload, spoolTopic, spoolData);
+            sendMqttPacket(data, brokerSocket, mqttPayload, payLoadLength);
+            spoolSentEnd = tcpGetSendNext(brokerSocket);
+            spoolSent = true;
         }
+        else
+            windowFull = true;
+    }
 
-        if(currentState == closeConnection)
+    if(currentState == sendPingReq)
+    {
+        etherMqttCreatePingReqPayload(mqttPayload);
+        sendMqttPacket(data, brokerSocket, mqttPayload, payLoadLength);
+        keepAlivePingSent();
+        currentState = mqttSocketLive;
+    }
+
+    //Check if the machine is in sendArpReq,if it is then send and wait for Arp Response
+    //A broker MAC learned on an earlier connection skips the ARP round trip
+    //An off subnet broker is reached through the gateway, so the gateway is ARPed instead
+    //Look the broker up by name, the answer may take a few passes
+    if(currentState == resolveBroker && etherIsIpValid())
+    {
+        uint8_t brokerIp[4];
+        dnsResult result = dnsLookup(mqttHost, brokerIp);
+        if(result == dnsFound)
         {
-            etherSendTcp(data, &s, TCP_FIN, 0, 0);
-            etherSendTcp(data, &s, TCP_RESET, 0, 0);
-            setPinValue(BLUE_LED, 0);
-            currentState = waitForServerReset;
+            etherSetMqttBrokerIp(brokerIp[0], brokerIp[1], brokerIp[2], brokerIp[3]);
+            currentState = sendArpReq;
         }
+        else if(result == dnsFailed)
+        {
+            putsUart0("Could not resolve Mqtt Broker hostname\r\n");
+            currentState = idle;
+            reconnectConnectionLost();
+        }
+    }
 
-        if(currentState == keepConnectionAlive)
+    //Held here until there is an address to connect from
+    if(currentState == sendArpReq && etherIsIpValid())
+    {
+        uint8_t mqttBIp[4];
+        uint8_t nextHop[4];
+        reconnectAttemptStarted();
+        etherGetMqttBrokerIpAddress(mqttBIp);
+        if(!etherGetNextHop(mqttBIp, nextHop))
         {
-            etherSendTcp(data, &s, TCP_ACK, 0, 0);
-            currentState = mqttSocketLive;
+            putsUart0("Mqtt Broker is off subnet and no gateway is set\r\n");
+            reconnectDisable();
+            currentState = idle;
         }
-        // Packet processing
-        if (etherIsDataAvailable())
+        else if(etherIsMqttBrokerMacKnown())
         {
-            if (etherIsOverflow())
-            {
-                setPinValue(RED_LED, 1);
-                waitMicrosecond(100000);
-                setPinValue(RED_LED, 0);
-            }
+            bootMark(bootBrokerArp);
+            currentState = sendTcpSyn;
+        }
+        else
+        {
+            etherSendArpRequest(data,nextHop);
+            currentState = waitArpRes;
+        }
+    }
 
-            // Get packet
-            etherGetPacket(data, MAX_PACKET_SIZE);
+    //Check if the machine is in sendSync state,if its send sync message and wait for syncack
+    if(currentState == sendTcpSyn)
+    {
+        //A fresh local port keeps the broker from mistaking this for a connection it still holds
+        uint8_t mqttBIp[4];
+        etherGetMqttBrokerIpAddress(mqttBIp);
+        closeBrokerSocket();
+        brokerSocket = tcpOpen(mqttBIp, 1883, 49152 + random32() % 16384);
+        etherSendTcp(data, brokerSocket, TCP_SYNC,0,0);
+        currentState = waitTcpSynAck;
+    }
 
-            // Handle ARP request
-            if (etherIsArpRequest(data))
+    //The ACK completing the handshake carries CONNECT, and the SUBSCRIBE list
+    //follows in the same segment without waiting for CONNACK
+    //Subscriptions are left off when a persistent session is expected to hold them
+    if(currentState == sendTcpAck)
+    {
+        setPinValue(BLUE_LED, 1);
+        etherMqttCreateConnectPayload(mqttPayload);
+        connectLength = payLoadLength;
+        topicCount = 0;
+        topicsSent = 0;
+        if(!(sessionIsPersistent() && sessionIsPresent()))
+        {
+            topicCount = sessionGetSubscriptions(topicList, qosList, SESSION_MAX_TOPICS);
+            if(topicCount > 0)
             {
-                etherSendArpResponse(data);
+                topicsSent = etherMqttCreateSubscribeListPayload(&mqttPayload[connectLength], MAX_PAYLOAD - connectLength, topicList, qosList, topicCount);
+                if(topicsSent > 0)
+                    connectLength += payLoadLength;
             }
+        }
+        sendMqttPacket(data, brokerSocket, mqttPayload, connectLength);
+        currentState = waitForConectAck;
+    }
+    if(currentState == acknowLedgeConnection)
+    {
+        etherSendTcp(data, brokerSocket, TCP_PUSH_ACK, 0, 0);
+        currentState = mqttSocketLive;
+    }
+    //Send the topic list, one segment per pass until every topic has gone out
+    if(currentState == sendSubPacket || currentState == sendUnSubPacket)
+    {
+        uint8_t packed;
+        if(currentState == sendSubPacket)
+            packed = etherMqttCreateSubscribeListPayload(mqttPayload, MAX_PAYLOAD, &topicList[topicsSent], &qosList[topicsSent], topicCount - topicsSent);
+        else
+            packed = etherMqttCreateUnSubscribeListPayload(mqttPayload, MAX_PAYLOAD, &topicList[topicsSent], topicCount - topicsSent);
+        if(packed > 0)
+            sendMqttPacket(data, brokerSocket, mqttPayload, payLoadLength);
+        else
+            putsUart0("Topic too long to fit in a segment\r\n");
+        topicsSent += packed;
+        if(packed == 0 || topicsSent >= topicCount)
+            currentState = mqttSocketLive;
+    }
 
-            //Handle ARP Reply
-            if(etherIsArpReply(data) && (currentState == waitArpRes))
-            {
-                etherStoreMqttMacAddress(data);
-                currentState = sendTcpSyn;
-            }
+    if(currentState == sendPublishPacket)
+    {
+        etherMqttCreatePublishPayload(mqttPayload, pubTopic, pubData);
+        sendMqttPacket(data, brokerSocket, mqttPayload, payLoadLength);
+        currentState = mqttSocketLive;
+    }
 
-            // Handle IP datagram
-            if (etherIsIp(data))
-            {
-            	if (etherIsIpUnicast(data))
-            	{
-            	    //Handle TCP Datagrams
-            	    if(etherIsTcp(data))
-            	    {
-            	        //Is it Ack To a Sync Message?
-            	        if(etherIsTcpAck(data))
-            	        {
-            	            //Update Sequence and Acknowledge Numbers
-            	            etherHeader* ether = (etherHeader*)data;
-                            ipHeader *ip = (ipHeader*)ether->data;
-                            uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
-                            tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
-                            uint16_t tcpFieldType = htons(tcp->offsetFields) & 0x0FFF;
-                            //If its a TCP Sync Ack state update the state to next state
-                            if(currentState == waitTcpSynAck && tcpFieldType == TCP_SYNACK)
-                            {
-                                sequenceNumber = tcp->acknowledgementNumber;
-                                acknowledgementNumber = tcp->sequenceNumber + htonl(1);
-                                currentState = sendTcpAck;
-                            }
+    if(currentState == sendDisconnect)
+    {
+        etherMqttCreateDisconnectPayload(mqttPayload);
+        sendMqttPacket(data, brokerSocket, mqttPayload, payLoadLength);
+        keepAliveStop();
+        currentState = waitForFinAck;
+    }
 
-                            //If its a Mqtt Connect Ack,make the state as MqttSocketLive
-                            if((currentState == waitForConectAck))
-                                if(etherIsMqttConnectAck(data) && tcpFieldType == TCP_PUSH_ACK)
-                                {
-                                    sequenceNumber = tcp->acknowledgementNumber;
-                                    acknowledgementNumber = tcp->sequenceNumber + htonl(4);
-                                    currentState = acknowLedgeConnection;
-                                }
+    if(currentState == closeConnection)
+    {
+        etherSendTcp(data, brokerSocket, TCP_FIN, 0, 0);
+        etherSendTcp(data, brokerSocket, TCP_RESET, 0, 0);
+        closeBrokerSocket();
+        setPinValue(BLUE_LED, 0);
+        currentState = idle;
+    }
 
-                            if(currentState == mqttSocketLive)
-                            {
-                                if((etherIsMqttSubAck(data) || (etherIsMqttUnSubAck(data)) || (etherIsMqttPublish(data)))&& tcpFieldType == TCP_PUSH_ACK)
-                                {
-                                    if(etherIsMqttPublish(data))
-                                    {
-                                        //Print contents of the topic subscribed from the message to Putty
-                                        printPublishData(data);
-                                    }
-                                    sequenceNumber = tcp->acknowledgementNumber;
-                                    acknowledgementNumber = tcp->sequenceNumber + htonl(payLoadLength);
-                                    currentState = acknowLedgeConnection;
-                                }
-                                else
-                                {
-                                    if(tcpFieldType == TCP_ACK)
-                                    {
-                                        sequenceNumber = tcp->acknowledgementNumber;
-                                        acknowledgementNumber = tcp->sequenceNumber;
-                                        currentState = keepConnectionAlive;
-                                    }
-                                }
-                            }
-                            if(currentState == waitForFinAck)
-                                if(etherIsTcpFinAck(data) && tcpFieldType == TCP_FIN_ACK)
-                                {
-                                    sequenceNumber = tcp->acknowledgementNumber;
-                                    acknowledgementNumber = tcp->sequenceNumber + htonl(1);
-                                    currentState = closeConnection;
-                                }
-                            if(currentState == waitForServerReset)
-                                if(etherIsTcpResetAck(data))
-                                {
-                                    currentState = idle;
-                                }
-            	        }
-            	    }
+    if(currentState == keepConnectionAlive)
+    {
+        etherSendTcp(data, brokerSocket, TCP_ACK, 0, 0);
+        currentState = mqttSocketLive;
+    }
 
-            		// handle icmp ping request
-					if (etherIsPingRequest(data))
-					{
-					  etherSendPingResponse(data);
-					}
+    pbufFree(frame);
+    //A message waiting for its ACK is picked up again by the network event that brings it
+    if(currentState != before || (currentState == mqttSocketLive && !spoolIsEmpty() && !windowFull && !spoolSent))
+        schedPost(schedMqtt);
+}
 
-					// Process UDP datagram
-					if (etherIsUdp(data))
-					{
-						udpData = etherGetUdpData(data);
-						if (strcmp((char*)udpData, "on") == 0)
-			                setPinValue(GREEN_LED, 1);
-                        if (strcmp((char*)udpData, "off") == 0)
-			                setPinValue(GREEN_LED, 0);
-						etherSendUdpResponse(data, (uint8_t*)"Received", 9);
-					}
-                }
-            }
-        }
+//Runs whenever nothing is pending, just before the core sleeps
+void idleEvent()
+{
+    //State changes are traced once per pass, wherever they were made
+    if(currentState != tracedState)
+    {
+        TRACE(traceMainState, tracedState, currentState, 0);
+        tracedState = currentState;
     }
+
+    //Send trace records while the console has room
+    traceService();
+}
+
+void postTimerEvent()
+{
+    schedPost(schedTimer);
+}
+
+// Host tests under host/test bring their own main() and define HOST_TEST
+#ifndef HOST_TEST
+int main(void)
+{
+    uint8_t mac[6];
+    uint8_t address[4];
+    uint8_t i;
+
+    // Init controller
+    initHw();
+
+    // Setup millisecond time base and software timers
+    initTimer();
+
+    // Trace records are timestamped from Timer 4A, so nothing is traced before this
+    initTrace();
+    bootMark(bootTimeBase);
+
+    // SPI0 and the ENC28J60 pins first, its oscillator starts up while the rest is set up
+    etherStart();
+
+    // Event queue, the UART0 and ENC28J60 interrupts post to it as soon as they are enabled
+    initSched();
+    initIdle();
+
+    // Frame buffers, then the ARP cache that holds frames in them while it resolves
+    initPbuf();
+    // ARP cache, entries are timed by the millisecond time base
+    initArpCache();
+
+    // Setup UART0
+    initUart0();
+    setUart0BaudRate(115200, 40e6);
+
+    // Setup EEPROM, then read the settings into RAM in one pass
+    initEeprom();
+    initConfig();
+    bootMark(bootConfig);
+
+    // Console command tables
+    cliBuild(&commandTable, commands, sizeof(commands) / sizeof(commands[0]));
+    cliBuild(&setTable, setCommands, sizeof(setCommands) / sizeof(setCommands[0]));
+
+    // Recover messages spooled while the broker was unreachable
+    initSpool();
+
+    // Each subscription registers printTopicData() for its filter with topicTrieAdd()
+    initTopicTrie();
+
+    // Init ethernet interface (eth0)
+    putsUart0("Starting eth0\r\n");
+
+    // Random numbers start from temperature sensor noise and the time it took to get here
+    initAdc0();
+    seedRandom(getTimer4Value());
+    for(i = 0; i < 32; i++)
+        stirRandom(((uint32_t)readAdc0Ss3() << 16) | (getTimer4Value() & 0xFFFF));
+
+    // Each board has its own MAC address, set with SET MAC or made up on first boot
+    if(configGet(configMac, mac, 6) != 6)
+    {
+        uint32_t r = random32();
+        mac[0] = 0x02;                          // locally administered, unicast
+        mac[1] = 0x03;
+        mac[2] = r >> 24;
+        mac[3] = r >> 16;
+        mac[4] = r >> 8;
+        mac[5] = r;
+        configSet(configMac, mac, 6);
+    }
+    etherSetMacAddress(mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    stirRandom(((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | (mac[4] << 8) | mac[5]);
+    initSession(mac);
+
+    // Retrieve IP address from the one stored in EEPROM, otherwise lease one by DHCP
+    if(configGet(configIp, address, 4) == 4)
+    {
+        etherDisableDhcpMode();
+        etherSetIpAddress(address[0], address[1], address[2], address[3]);
+    }
+    else
+    {
+        etherEnableDhcpMode();
+        etherSetIpAddress(0, 0, 0, 0);
+    }
+
+
+    //Retrieve Mqtt Broker IP address if stored in EEPROM
+    if(configGet(configMqtt, address, 4) == 4)
+        etherSetMqttBrokerIp(address[0], address[1], address[2], address[3]);
+    else
+        etherSetMqttBrokerIp(0, 0, 0, 0);
+
+    //Retrieve subnet mask and gateway, which route traffic to an off subnet broker
+    if(configGet(configSubnet, address, 4) == 4)
+        etherSetIpSubnetMask(address[0], address[1], address[2], address[3]);
+    else
+        etherSetIpSubnetMask(255, 255, 255, 0);
+    if(configGet(configGateway, address, 4) == 4)
+        etherSetIpGatewayAddress(address[0], address[1], address[2], address[3]);
+    else
+        etherSetIpGatewayAddress(192, 168, 1, 1);
+    etherInit(ETHER_UNICAST | ETHER_BROADCAST | ETHER_HALFDUPLEX);
+    bootMark(bootEther);
+
+    // TCP connection table, the primary broker and the mirror broker each hold one
+    initTcp();
+    initMirror();
+    if(configGet(configMirror, address, 4) == 4)
+        mirrorSetBroker(address);
+
+    // UDP sockets, datagrams to unbound ports are dropped
+    initUdp();
+    udpBind(UDP_DEMO_PORT, udpDemoHandler);
+
+    // MQTT-SN transport, selected with SET TRANSPORT SN
+    initMqttSn(printTopicData);
+
+    // Broker hostname and DNS server, without a DNS server the one from DHCP is used
+    initDns();
+    loadMqttHost();
+    if(configGet(configDns, address, 4) == 4)
+        dnsSetServer(address);
+
+    // DHCP starts once the link is up, and the broker is connected once there is an address
+    if(configGet(configAutoConnect, address, 1) == 1)
+        autoConnect = address[0];
+//  displayConnectionInfo();
+
+    // Flash LED, turned off by bootService()
+    setPinValue(GREEN_LED, 1);
+    bootLedTime = getTimerTicks();
+    bootLedsOn = true;
+
+    // Events replace the polling loop: the ENC28J60 INT pin, UART0 receive and
+    // a periodic timer post them, and each handler runs to completion
+    schedSetHandler(schedNetwork, networkEvent);
+    schedSetHandler(schedTxDone, txDoneEvent);
+    schedSetHandler(schedMqtt, mqttEvent);
+    schedSetHandler(schedTimer, timerEvent);
+    schedSetHandler(schedConsole, consoleEvent);
+    schedSetIdleHandler(idleEvent);
+    startPeriodicTimer(postTimerEvent, SERVICE_PERIOD_MS);
+    // Anything that arrived while booting
+    schedPost(schedNetwork);
+    schedPost(schedConsole);
+    bootMark(bootSchedule);
+    schedRun();
 }
+#endif
@@ -0,0 +1,41 @@
+// ADC0 Library
+// Host stand-in, temperature sensor noise from the kernel
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// Samples are a fixed reading with random low bits taken from getrandom(),
+// so each run draws different numbers the way each boot of a board does.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/random.h>
+#include "adc0.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initAdc0()
+{
+}
+
+uint16_t readAdc0Ss3()
+{
+    uint8_t noise = 0;
+    getrandom(&noise, sizeof(noise), 0);
+    return 0x700 | (noise & 0x0F);
+}
+
+#endif
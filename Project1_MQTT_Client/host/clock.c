@@ -0,0 +1,28 @@
+// Clock Library
+// Host stand-in
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include "clock.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initSystemClockTo40Mhz(void)
+{
+}
+
+#endif
@@ -0,0 +1,121 @@
+// CPU Library
+// Host stand-in, interrupts are emulated at the points the scheduler unmasks them
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// On the board an interrupt runs as soon as it is unmasked.  Here the
+// sources are polled instead: enableInterrupts() counts the milliseconds the
+// clock has moved on and takes any console or network input, which is what
+// the isrs would have done while the core slept.  waitForInterrupt() blocks
+// in select() until there is input or the next software timer falls due, or
+// in virtual time jumps the clock straight to whichever comes first.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include "cpu.h"
+#include "timer.h"
+#include "host.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Runs the emulated isrs for whatever has happened since the last call
+void hostService()
+{
+    hostTimer4Poll();
+    hostUart0Poll();
+    hostEtherPoll();
+}
+
+// Returns once there is something for hostService() to deliver
+void hostWait()
+{
+    uint64_t now, wake, next;
+    struct timeval timeout;
+    fd_set fds;
+    int fd, count = 0;
+
+    now = hostGetMicroseconds();
+    wake = hostGetTickTime() + (uint64_t)getTimerIdleTime() * 1000;
+    FD_ZERO(&fds);
+    fd = hostUart0GetFd();
+    if (fd >= 0)
+    {
+        FD_SET(fd, &fds);
+        count = fd + 1;
+    }
+    if (hostIsClockVirtual())
+    {
+        // typed input is taken as it comes, the capture sets the pace
+        fflush(stdout);
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 0;
+        if (count != 0 && select(count, &fds, 0, 0, &timeout) > 0)
+            return;
+        if (hostEtherIsReplayDone())
+        {
+            hostEtherReport();
+            exit(0);
+        }
+        if (hostEtherGetNextTime(&next) && next < wake)
+            wake = next;
+        hostAdvanceClock(wake);
+        return;
+    }
+    fd = hostEtherGetFd();
+    if (fd >= 0)
+    {
+        FD_SET(fd, &fds);
+        if (fd >= count)
+            count = fd + 1;
+    }
+    // console output and any frames being recorded are written out before blocking
+    fflush(0);
+    if (wake < now)
+        wake = now;
+    timeout.tv_sec = (wake - now) / 1000000;
+    timeout.tv_usec = (wake - now) % 1000000;
+    select(count, &fds, 0, 0, &timeout);
+}
+
+// Nothing runs behind the caller's back, so there is nothing to mask
+void disableInterrupts()
+{
+}
+
+void enableInterrupts()
+{
+    hostService();
+}
+
+void waitForInterrupt()
+{
+    hostWait();
+}
+
+// Starts the program again, settings survive when HOST_EEPROM names a file
+void resetSystem()
+{
+    fflush(stdout);
+    execl("/proc/self/exe", "mqtt-host", (char*)0);
+    exit(0);
+}
+
+#endif
@@ -0,0 +1,102 @@
+// EEPROM Library
+// Host stand-in, words kept in RAM and optionally in a file
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// Starts erased (all ones) like a new part.  When HOST_EEPROM names a file
+// its contents are loaded by initEeprom() and every write goes straight
+// through to it, so a run that is killed part way through a commit leaves
+// the same partial state a board that lost power would.
+// hostEepromCutAfter() does the same on demand: once the given number of
+// writes has been made every later write is dropped, as if the supply had
+// failed, until the cut is cleared again.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "eeprom.h"
+#include "host.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint32_t eepromWords[EEPROM_WORDS];
+int eepromFd = -1;
+int32_t eepromWritesLeft = -1;
+bool eepromCut = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initEeprom()
+{
+    char* name = getenv("HOST_EEPROM");
+    uint16_t i;
+    for (i = 0; i < EEPROM_WORDS; i++)
+        eepromWords[i] = 0xFFFFFFFF;
+    if (name != 0 && eepromFd < 0)
+    {
+        eepromFd = open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (eepromFd >= 0 && pread(eepromFd, eepromWords, sizeof(eepromWords), 0) != sizeof(eepromWords))
+        {
+            // new or short file, start it erased
+            for (i = 0; i < EEPROM_WORDS; i++)
+                eepromWords[i] = 0xFFFFFFFF;
+            pwrite(eepromFd, eepromWords, sizeof(eepromWords), 0);
+        }
+    }
+}
+
+// Drops every write after the next writes have been made, -1 clears the cut
+void hostEepromCutAfter(int32_t writes)
+{
+    eepromWritesLeft = writes;
+    eepromCut = false;
+}
+
+// Returns true if a write has been dropped since the cut was set
+bool hostEepromIsCut()
+{
+    return eepromCut;
+}
+
+void writeEeprom(uint16_t add, uint32_t data)
+{
+    if (add >= EEPROM_WORDS)
+        return;
+    if (eepromWritesLeft == 0)
+    {
+        eepromCut = true;
+        return;
+    }
+    if (eepromWritesLeft > 0)
+        eepromWritesLeft--;
+    eepromWords[add] = data;
+    if (eepromFd >= 0)
+        pwrite(eepromFd, &data, sizeof(data), add * sizeof(data));
+}
+
+uint32_t readEeprom(uint16_t add)
+{
+    if (add >= EEPROM_WORDS)
+        return 0xFFFFFFFF;
+    return eepromWords[add];
+}
+
+#endif
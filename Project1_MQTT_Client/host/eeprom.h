@@ -0,0 +1,32 @@
+// EEPROM Library
+// Host stand-in for the eeprom.h of the board support files
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+#include <stdint.h>
+
+// 2 KB, as on the TM4C123GH6PM
+#define EEPROM_WORDS 512
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initEeprom();
+void writeEeprom(uint16_t add, uint32_t data);
+uint32_t readEeprom(uint16_t add);
+
+#endif
@@ -0,0 +1,360 @@
+// ENC28J60 Library
+// Host stand-in, frames come from a TAP device or a pcap capture
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// The controller side of eth0.h over one of three backends, picked by
+// etherStart() from the environment:
+//   HOST_TAP=name    frames to and from a TAP device, in wall time
+//   HOST_PCAP=file   the frames of a capture are received at the times they
+//                    were captured, in virtual time, and whatever the stack
+//                    sends is dropped; the host exits once all are taken
+//   neither          the link stays down
+// HOST_PCAP_OUT=file records every frame received and sent with either.
+// One received frame is held at a time, as the controller's read pointer
+// would hold it, and its size counts 4 crc bytes the way the controller's
+// does.  Sends complete at once, so a tx done is always pending after one.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "eth0.h"
+#include "sched.h"
+#include "boot.h"
+#include "host.h"
+
+// Largest frame without its crc, and the shortest the controller sends (PAD60)
+#define ETHER_FRAME_MAX 1518
+#define ETHER_FRAME_MIN 60
+
+// pcap file format, microsecond and nanosecond timestamps
+#define PCAP_MAGIC      0xA1B2C3D4
+#define PCAP_MAGIC_NS   0xA1B23C4D
+#define PCAP_ETHERNET   1
+
+typedef struct _pcapHeader
+{
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    int32_t  thisZone;
+    uint32_t sigFigs;
+    uint32_t snapLength;
+    uint32_t linkType;
+} pcapHeader;
+
+typedef struct _pcapRecord
+{
+    uint32_t seconds;
+    uint32_t fraction;
+    uint32_t length;
+    uint32_t originalLength;
+} pcapRecord;
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint8_t etherRxFrame[ETHER_FRAME_MAX + 4];
+uint16_t etherRxSize = 0;               // held frame including crc, 0 when none
+uint16_t etherRxRead = 0;               // bytes copied out so far
+uint8_t etherTxFrame[ETHER_FRAME_MAX];
+bool etherTxDone = false;
+bool etherInterruptEnabled = false;
+uint16_t etherTxErrorCount = 0;
+uint32_t etherReceived = 0;
+uint32_t etherSent = 0;
+int etherTapFd = -1;
+FILE* etherReplay = 0;
+bool etherReplayNs = false;
+bool etherReplayHasNext = false;
+pcapRecord etherReplayNext;
+uint64_t etherReplayNextTime = 0;
+uint64_t etherReplayFirst = 0;          // capture time of the first frame
+uint64_t etherReplayStart = 0;          // clock when the first frame is due
+bool etherReplayStarted = false;
+FILE* etherRecord = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Reads the header of the next frame in the capture and works out when it is due
+void etherReplayRead()
+{
+    uint64_t time;
+    etherReplayHasNext = fread(&etherReplayNext, sizeof(etherReplayNext), 1, etherReplay) == 1;
+    if (!etherReplayHasNext)
+        return;
+    time = (uint64_t)etherReplayNext.seconds * 1000000;
+    time += etherReplayNs ? etherReplayNext.fraction / 1000 : etherReplayNext.fraction;
+    if (!etherReplayStarted)
+    {
+        etherReplayFirst = time;
+        etherReplayStarted = true;
+    }
+    // a capture that steps back in time has its frame delivered at once
+    etherReplayNextTime = etherReplayStart + (time > etherReplayFirst ? time - etherReplayFirst : 0);
+}
+
+void etherRecordFrame(uint8_t* frame, uint16_t size)
+{
+    pcapRecord record;
+    uint64_t time = hostGetMicroseconds();
+    if (etherRecord == 0)
+        return;
+    record.seconds = time / 1000000;
+    record.fraction = time % 1000000;
+    record.length = record.originalLength = size;
+    fwrite(&record, sizeof(record), 1, etherRecord);
+    fwrite(frame, 1, size, etherRecord);
+}
+
+// Opens the backends named in the environment
+void etherStart()
+{
+    pcapHeader header;
+    char* name;
+    name = getenv("HOST_TAP");
+    if (name != 0)
+    {
+        etherTapFd = hostTapOpen(name);
+        if (etherTapFd < 0)
+        {
+            fprintf(stderr, "cannot open TAP device %s\n", name);
+            exit(1);
+        }
+    }
+    name = getenv("HOST_PCAP");
+    if (name != 0 && etherTapFd < 0)
+    {
+        etherReplay = fopen(name, "rb");
+        if (etherReplay == 0 || fread(&header, sizeof(header), 1, etherReplay) != 1
+            || (header.magic != PCAP_MAGIC && header.magic != PCAP_MAGIC_NS) || header.linkType != PCAP_ETHERNET)
+        {
+            fprintf(stderr, "cannot replay %s, a little endian Ethernet pcap file is needed\n", name);
+            exit(1);
+        }
+        etherReplayNs = header.magic == PCAP_MAGIC_NS;
+        hostSetClockVirtual();
+    }
+    name = getenv("HOST_PCAP_OUT");
+    if (name != 0)
+    {
+        etherRecord = fopen(name, "wb");
+        if (etherRecord == 0)
+        {
+            fprintf(stderr, "cannot write %s\n", name);
+            exit(1);
+        }
+        memset(&header, 0, sizeof(header));
+        header.magic = PCAP_MAGIC;
+        header.versionMajor = 2;
+        header.versionMinor = 4;
+        header.snapLength = 65535;
+        header.linkType = PCAP_ETHERNET;
+        fwrite(&header, sizeof(header), 1, etherRecord);
+    }
+}
+
+bool etherIsClockReady()
+{
+    return true;
+}
+
+// The capture starts playing from here, as a link would come up
+void etherInit(uint16_t mode)
+{
+    bootMark(bootEtherClock);
+    etherRxSize = 0;
+    etherTxDone = false;
+    if (etherReplay != 0)
+    {
+        etherReplayStart = hostGetMicroseconds();
+        etherReplayRead();
+    }
+    etherInterruptEnabled = true;
+}
+
+void etherEndLedTest()
+{
+}
+
+void etherIsr()
+{
+    etherInterruptEnabled = false;
+    schedPost(schedNetwork);
+}
+
+void etherEnableInterrupt()
+{
+    etherInterruptEnabled = true;
+}
+
+bool etherIsLinkUp()
+{
+    return etherTapFd >= 0 || etherReplay != 0;
+}
+
+// Takes the next frame from the backend if none is held
+void etherFetch()
+{
+    int size = 0;
+    if (etherRxSize != 0)
+        return;
+    if (etherTapFd >= 0)
+        size = read(etherTapFd, etherRxFrame, ETHER_FRAME_MAX);
+    else if (etherReplayHasNext && etherReplayNextTime <= hostGetMicroseconds())
+    {
+        size_t length = etherReplayNext.length < ETHER_FRAME_MAX ? etherReplayNext.length : ETHER_FRAME_MAX;
+        size = fread(etherRxFrame, 1, length, etherReplay) == length ? (int)length : 0;
+        fseek(etherReplay, etherReplayNext.length - size, SEEK_CUR);
+        etherReplayRead();
+    }
+    if (size <= 0)
+        return;
+    etherRecordFrame(etherRxFrame, size);
+    memset(&etherRxFrame[size], 0, 4);
+    etherRxSize = size + 4;
+    etherRxRead = 0;
+    etherReceived++;
+}
+
+bool etherIsDataAvailable()
+{
+    etherFetch();
+    return etherRxSize != 0;
+}
+
+bool etherIsTxDone()
+{
+    if (!etherTxDone)
+        return false;
+    etherTxDone = false;
+    return true;
+}
+
+uint16_t etherGetTxAbortCount()
+{
+    return etherTxErrorCount;
+}
+
+bool etherIsOverflow()
+{
+    return false;
+}
+
+uint16_t etherPeekPacket(etherHeader *ether, uint16_t peekSize)
+{
+    etherFetch();
+    if (peekSize > etherRxSize)
+        peekSize = etherRxSize;
+    memcpy(ether, etherRxFrame, peekSize);
+    etherRxRead = peekSize;
+    return etherRxSize;
+}
+
+uint16_t etherFinishPacket(etherHeader *ether, uint16_t maxSize)
+{
+    uint16_t size = etherRxSize;
+    if (size > maxSize)
+        size = maxSize;
+    if (etherRxRead < size)
+        memcpy((uint8_t*)ether + etherRxRead, &etherRxFrame[etherRxRead], size - etherRxRead);
+    etherRxSize = 0;
+    return size;
+}
+
+uint16_t etherGetPacket(etherHeader *ether, uint16_t maxSize)
+{
+    etherPeekPacket(ether, maxSize);
+    return etherFinishPacket(ether, maxSize);
+}
+
+// Sends the size byte frame in etherTxFrame
+bool etherTransmit(uint16_t size)
+{
+    if (size < ETHER_FRAME_MIN)
+    {
+        memset(&etherTxFrame[size], 0, ETHER_FRAME_MIN - size);
+        size = ETHER_FRAME_MIN;
+    }
+    if (etherTapFd >= 0 && write(etherTapFd, etherTxFrame, size) != size)
+        etherTxErrorCount++;
+    etherRecordFrame(etherTxFrame, size);
+    etherSent++;
+    etherTxDone = true;
+    return true;
+}
+
+bool etherPutPacket(etherHeader *ether, uint16_t size)
+{
+    if (size > ETHER_FRAME_MAX)
+        size = ETHER_FRAME_MAX;
+    memcpy(etherTxFrame, ether, size);
+    return etherTransmit(size);
+}
+
+bool etherIsPeeked(uint16_t peekSize, uint16_t size)
+{
+    return etherRxRead >= peekSize && size + 4 <= etherRxSize;
+}
+
+bool etherPutPacketInPlace(etherHeader *ether, uint16_t headerSize, uint16_t size)
+{
+    memcpy(etherTxFrame, ether, headerSize);
+    memcpy(&etherTxFrame[headerSize], &etherRxFrame[headerSize], size - headerSize);
+    etherRxSize = 0;
+    return etherTransmit(size);
+}
+
+// File descriptor to wait on for frames, -1 when frames do not come from a device
+int hostEtherGetFd()
+{
+    return etherTapFd;
+}
+
+// Clock time the next frame of a capture is due
+bool hostEtherGetNextTime(uint64_t* time)
+{
+    *time = etherReplayNextTime;
+    return etherReplay != 0 && etherReplayHasNext;
+}
+
+bool hostEtherIsReplayDone()
+{
+    return etherReplay != 0 && !etherReplayHasNext && etherRxSize == 0;
+}
+
+void hostEtherReport()
+{
+    if (etherRecord != 0)
+        fflush(etherRecord);
+    fprintf(stderr, "%u frames received, %u sent, %.3f s simulated in %.3f s of cpu time\n",
+            etherReceived, etherSent, hostGetMicroseconds() / 1e6, (double)clock() / CLOCKS_PER_SEC);
+}
+
+// INT is asserted while a frame is waiting or a send has finished
+void hostEtherPoll()
+{
+    if (etherInterruptEnabled && (etherIsDataAvailable() || etherTxDone))
+        etherIsr();
+}
+
+#endif
@@ -0,0 +1,157 @@
+// GPIO Library
+// Host stand-in, pin values are kept in RAM
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// Outputs read back what was last written, inputs read high when their
+// pull-up is enabled (an unpressed button) and low otherwise.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gpio.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint8_t gpioValue[6];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint8_t* gpioGetPort(PORT port)
+{
+    switch(port)
+    {
+        case PORTA:
+            return &gpioValue[0];
+        case PORTB:
+            return &gpioValue[1];
+        case PORTC:
+            return &gpioValue[2];
+        case PORTD:
+            return &gpioValue[3];
+        case PORTE:
+            return &gpioValue[4];
+        default:
+            return &gpioValue[5];
+    }
+}
+
+void enablePort(PORT port)
+{
+}
+
+void disablePort(PORT port)
+{
+}
+
+void selectPinPushPullOutput(PORT port, uint8_t pin)
+{
+}
+
+void selectPinOpenDrainOutput(PORT port, uint8_t pin)
+{
+}
+
+void selectPinDigitalInput(PORT port, uint8_t pin)
+{
+}
+
+void selectPinAnalogInput(PORT port, uint8_t pin)
+{
+}
+
+void setPinCommitControl(PORT port, uint8_t pin)
+{
+}
+
+void enablePinPullup(PORT port, uint8_t pin)
+{
+    setPinValue(port, pin, 1);
+}
+
+void disablePinPullup(PORT port, uint8_t pin)
+{
+    setPinValue(port, pin, 0);
+}
+
+void enablePinPulldown(PORT port, uint8_t pin)
+{
+    setPinValue(port, pin, 0);
+}
+
+void disablePinPulldown(PORT port, uint8_t pin)
+{
+}
+
+void setPinAuxFunction(PORT port, uint8_t pin, uint32_t fn)
+{
+}
+
+void selectPinInterruptRisingEdge(PORT port, uint8_t pin)
+{
+}
+
+void selectPinInterruptFallingEdge(PORT port, uint8_t pin)
+{
+}
+
+void selectPinInterruptBothEdges(PORT port, uint8_t pin)
+{
+}
+
+void selectPinInterruptHighLevel(PORT port, uint8_t pin)
+{
+}
+
+void selectPinInterruptLowLevel(PORT port, uint8_t pin)
+{
+}
+
+void enablePinInterrupt(PORT port, uint8_t pin)
+{
+}
+
+void disablePinInterrupt(PORT port, uint8_t pin)
+{
+}
+
+void setPinValue(PORT port, uint8_t pin, bool value)
+{
+    uint8_t* data = gpioGetPort(port);
+    if (value)
+        *data |= 1 << pin;
+    else
+        *data &= ~(1 << pin);
+}
+
+bool getPinValue(PORT port, uint8_t pin)
+{
+    return (*gpioGetPort(port) >> pin) & 1;
+}
+
+void setPortValue(PORT port, uint8_t value)
+{
+    *gpioGetPort(port) = value;
+}
+
+uint8_t getPortValue(PORT port)
+{
+    return *gpioGetPort(port);
+}
+
+#endif
@@ -0,0 +1,105 @@
+// Host Library
+// Linux stand-ins for the TM4C123GH6PM drivers
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// The stack above the drivers builds unchanged against these files, so it
+// can be run, debugged and profiled (perf, valgrind, gprof) off the board.
+// Each file here replaces the driver of the same name in the project root
+// and is wrapped in #ifdef __linux__ so the CCS build skips it.
+//
+//   host/cpu.c       interrupts are taken when the scheduler sleeps
+//   host/timer4.c    simulated clock, wall time or virtual time
+//   host/uart0.c     console on stdin and stdout
+//   host/enc28j60.c  frames from a TAP device or a pcap capture
+//   host/eeprom.c    2 KB EEPROM in RAM, optionally kept in a file
+//   host/gpio.c      pin values kept in RAM
+//   host/adc0.c      temperature sensor noise from getrandom()
+//   host/wait.c, host/clock.c
+//
+// spi0.c has no stand-in, nothing above the ENC28J60 driver uses SPI.
+//
+// Build from the project root, as one command:
+//   gcc -O2 -g -std=gnu99 -Ihost -I. -o mqtt-host host/*.c
+//       alias.c arp.c boot.c cli.c config.c console.c dhcp.c dns.c eth0.c
+//       ethernet.c idle.c keepalive.c mirror.c mqttsn.c pbuf.c reconnect.c
+//       sched.c session.c spool.c tcp.c timer.c topic.c trace.c udp.c
+//
+// Tests and benchmarks in host/test each have their own main() and build
+// the same way with -DHOST_TEST, which leaves out the one in ethernet.c:
+//   gcc -O2 -g -std=gnu99 -DHOST_TEST -Ihost -I. -o spooltest
+//       host/test/spooltest.c host/*.c <the project files above>
+//
+//   host/test/spooltest.c  spool recovery after a cut at every EEPROM write
+//   host/test/triebench.c  topic trie matches per second, builds on its own
+//   host/test/clibench.c   console parse and dispatch cost per line
+//
+// Environment:
+//   HOST_TAP=tap0         attach to an existing TAP device (wall time)
+//   HOST_PCAP=in.pcap     replay a capture in virtual time, exit at its end
+//   HOST_PCAP_OUT=out.pcap  record every frame received and sent
+//   HOST_EEPROM=file      keep the EEPROM contents between runs
+//
+// A TAP device the current user can open is made with, for example:
+//   ip tuntap add dev tap0 mode tap user $USER
+//   ip addr add 192.168.1.1/24 dev tap0 && ip link set tap0 up
+// and the rest of the network is stood in for from tools/ on that device:
+//   tools/dhcpserver.py   leases addresses from a pool
+//   tools/dnsserver.py    answers broker hostnames from a fixed table
+//   tools/mqttbroker.py   MQTT broker over the workstation's own TCP
+//   tools/mqttsngw.py     MQTT-SN gateway that loops publishes back
+// tools/mqtttimeline.py lists the MQTT packets of a HOST_PCAP_OUT capture
+// with their times from SYN, and the times to CONNACK, to the last SUBACK
+// and to the first inbound publish.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// cpu.c
+void hostService();
+void hostWait();
+
+// timer4.c
+uint64_t hostGetMicroseconds();
+uint64_t hostGetTickTime();
+void hostSetClockVirtual();
+bool hostIsClockVirtual();
+void hostAdvanceClock(uint64_t time);
+void hostTimer4Poll();
+
+// uart0.c
+int hostUart0GetFd();
+void hostUart0Poll();
+
+// eeprom.c
+void hostEepromCutAfter(int32_t writes);
+bool hostEepromIsCut();
+
+// enc28j60.c
+int hostEtherGetFd();
+bool hostEtherGetNextTime(uint64_t* time);
+bool hostEtherIsReplayDone();
+void hostEtherReport();
+void hostEtherPoll();
+
+// tap.c
+int hostTapOpen(const char* name);
+
+#endif
@@ -0,0 +1,54 @@
+// TAP Library
+// Opens a Linux TAP device for host/enc28j60.c
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// Kept apart from enc28j60.c because the socket headers declare socket(),
+// which eth0.h uses as the name of the connection type.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+#include "host.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Returns a non-blocking descriptor that reads and writes whole frames, or -1
+int hostTapOpen(const char* name)
+{
+    struct ifreq ifr;
+    // closed across the exec of resetSystem(), so the restarted program can attach
+    int fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+    if (ioctl(fd, TUNSETIFF, &ifr) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif
@@ -0,0 +1,236 @@
+// CLI Benchmark
+// Parse and dispatch cost per console line
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// Each line is copied into a USER_DATA, split by parseFields() and its verb
+// dispatched BENCH_LINES times.  The tables hold the verbs of the console
+// and of SET in the same order, with handlers that only count, so nothing
+// but the lookup is measured.  Dispatch through cliDispatch(), which scans
+// its table, is timed against an open addressed FNV-1a index over the same
+// table, the one cli.c used to build.  Parse time is measured on its own
+// and subtracted, so the columns are nanoseconds of dispatch per line, the
+// best of BENCH_RUNS runs.
+//
+// Build as described in host/host.h and run with no arguments.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "cli.h"
+#include "console.h"
+
+#define BENCH_LINES 2000000
+#define BENCH_RUNS  5
+#define BENCH_SLOTS 32
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+cliTable benchTable;
+cliTable benchSetTable;
+uint8_t benchSlots[BENCH_SLOTS];            // command index + 1, 0 when empty
+uint8_t benchSetSlots[BENCH_SLOTS];
+uint32_t benchCalls = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+double benchSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void benchHandler(USER_DATA* info, etherHeader* ether)
+{
+    benchCalls++;
+}
+
+void benchSet(USER_DATA* info, etherHeader* ether)
+{
+    cliDispatch(&benchSetTable, info, 2, ether);
+}
+
+const cliCommand benchSetCommands[] =
+{
+    {"IP",          4, benchHandler, ""},
+    {"GW",          4, benchHandler, ""},
+    {"SN",          4, benchHandler, ""},
+    {"MAC",         6, benchHandler, ""},
+    {"DNS",         4, benchHandler, ""},
+    {"DHCP",        1, benchHandler, ""},
+    {"VERSION",     1, benchHandler, ""},
+    {"MQTT",        1, benchHandler, ""},
+    {"MIRROR",      4, benchHandler, ""},
+    {"TRANSPORT",   1, benchHandler, ""},
+    {"TRACE",       1, benchHandler, ""},
+    {"IDLE",        1, benchHandler, ""},
+    {"AUTOCONNECT", 1, benchHandler, ""},
+};
+
+const cliCommand benchCommands[] =
+{
+    {"REBOOT",      0, benchHandler, ""},
+    {"STATUS",      0, benchHandler, ""},
+    {"HELP",        0, benchHandler, ""},
+    {"EVENTS",      0, benchHandler, ""},
+    {"BOOT",        0, benchHandler, ""},
+    {"SET",         1, benchSet,     ""},
+    {"CONNECT",     0, benchHandler, ""},
+    {"DISCONNECT",  0, benchHandler, ""},
+    {"SUBSCRIBE",   1, benchHandler, ""},
+    {"UNSUBSCRIBE", 1, benchHandler, ""},
+    {"PUBLISH",     2, benchHandler, ""},
+};
+
+char benchUpper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? c - 32 : c;
+}
+
+uint32_t benchHash(char* verb)
+{
+    uint32_t hash = 2166136261;
+    while (*verb != '\0')
+    {
+        hash ^= (uint8_t)benchUpper(*verb++);
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+bool benchVerbMatches(char* verb, char* field)
+{
+    while (*verb != '\0' && benchUpper(*verb) == benchUpper(*field))
+    {
+        verb++;
+        field++;
+    }
+    return *verb == '\0' && *field == '\0';
+}
+
+// Indexes the commands of table into slots
+void benchIndex(cliTable* table, uint8_t slots[])
+{
+    uint8_t i, slot;
+    for (i = 0; i < BENCH_SLOTS; i++)
+        slots[i] = 0;
+    for (i = 0; i < table->count; i++)
+    {
+        slot = benchHash(table->commands[i].verb) & (BENCH_SLOTS - 1);
+        while (slots[slot] != 0)
+            slot = (slot + 1) & (BENCH_SLOTS - 1);
+        slots[slot] = i + 1;
+    }
+}
+
+// Dispatches field through the index, the way cliFind() did before the scan
+bool benchHashed(cliTable* table, uint8_t slots[], USER_DATA* info, uint8_t field)
+{
+    const cliCommand* command;
+    char* verb;
+    uint8_t slot;
+    if (info->fieldCount <= field)
+        return false;
+    verb = getFieldString(info, field);
+    slot = benchHash(verb) & (BENCH_SLOTS - 1);
+    while (slots[slot] != 0)
+    {
+        command = &table->commands[slots[slot] - 1];
+        if (benchVerbMatches(command->verb, verb))
+        {
+            if (command->handler == benchSet)
+                return benchHashed(&benchSetTable, benchSetSlots, info, 2);
+            benchCalls++;
+            return true;
+        }
+        slot = (slot + 1) & (BENCH_SLOTS - 1);
+    }
+    return false;
+}
+
+// Returns the fewest nanoseconds per line for line, mode 0 parses, 1 scans, 2 hashes
+double benchRun(char* line, uint8_t mode)
+{
+    USER_DATA info;
+    uint32_t n;
+    uint8_t run;
+    double start, time, best = 0;
+
+    for (run = 0; run < BENCH_RUNS; run++)
+    {
+        start = benchSeconds();
+        for (n = 0; n < BENCH_LINES; n++)
+        {
+            strcpy(info.buffer, line);
+            parseFields(&info);
+            if (mode == 1)
+                cliDispatch(&benchTable, &info, 1, 0);
+            else if (mode == 2)
+                benchHashed(&benchTable, benchSlots, &info, 1);
+        }
+        time = (benchSeconds() - start) * 1e9 / BENCH_LINES;
+        if (run == 0 || time < best)
+            best = time;
+    }
+    return best;
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(void)
+{
+    char* lines[] =
+    {
+        "reboot",
+        "PUBLISH sensors/temp 21",
+        "disconnect",
+        "SET TRANSPORT SN",
+        "set ip 192 168 1 50",
+    };
+    double parse, scanned, hashed;
+    uint32_t scannedCalls;
+    uint8_t i;
+
+    cliBuild(&benchTable, benchCommands, sizeof(benchCommands) / sizeof(benchCommands[0]));
+    cliBuild(&benchSetTable, benchSetCommands, sizeof(benchSetCommands) / sizeof(benchSetCommands[0]));
+    benchIndex(&benchTable, benchSlots);
+    benchIndex(&benchSetTable, benchSetSlots);
+
+    printf("clibench: %u lines each, ns per line\n", BENCH_LINES);
+    printf("  %-26s %7s %7s %7s\n", "line", "parse", "scan", "hashed");
+    for (i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+    {
+        parse = benchRun(lines[i], 0);
+        benchCalls = 0;
+        scanned = benchRun(lines[i], 1) - parse;
+        scannedCalls = benchCalls;
+        benchCalls = 0;
+        hashed = benchRun(lines[i], 2) - parse;
+        printf("  %-26s %7.1f %7.1f %7.1f%s\n", lines[i], parse, scanned, hashed,
+               scannedCalls == benchCalls ? "" : "  handler calls differ");
+    }
+    return 0;
+}
+
+#endif
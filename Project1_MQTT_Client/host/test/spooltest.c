@@ -0,0 +1,175 @@
+// Spool Test
+// Cuts the EEPROM supply after every word of a spool push and of a retire
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// For each lap the ring is first advanced by a number of pushed and retired
+// records, so the record under test lands on every alignment and straddles
+// the end of the ring.  A push (or a retire) is then made with the supply
+// cut after 0, 1, 2... EEPROM writes until it completes uncut.  After each
+// cut the spool is rebuilt by initSpool() as on a reset and must hold the
+// records from just before or just after the operation, never a mix, and
+// must still accept and recover a new record.
+//
+// Build as described in host/host.h and run with no arguments, the exit
+// status is non-zero if any case fails.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "eeprom.h"
+#include "spool.h"
+#include "host.h"
+
+#define TEST_LAPS   160
+#define TEST_SIZE   40
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint32_t testCases = 0;
+uint32_t testFailures = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Runs spoolService() until every retire and staged word has been written
+void testDrain()
+{
+    uint8_t i;
+    for (i = 0; i < 100; i++)
+        spoolService();
+}
+
+// Starts from an erased part and advances the ring by lap records
+void testPrepare(uint16_t lap)
+{
+    char topic[TEST_SIZE], data[TEST_SIZE];
+    uint16_t i;
+
+    hostEepromCutAfter(-1);
+    initEeprom();
+    initSpool();
+    for (i = 0; i < lap; i++)
+    {
+        snprintf(topic, sizeof(topic), "lap/%u", i);
+        snprintf(data, sizeof(data), "%.*s", i % 13, "0123456789abc");
+        spoolPush(topic, data);
+        testDrain();
+        spoolRemoveOldest();
+        testDrain();
+    }
+    spoolPush("base/0", "first record kept across the cut");
+    spoolPush("base/1", "second");
+    testDrain();
+}
+
+// Reboots the spool and checks it holds exactly the expected topics in order
+void testVerify(const char* what, uint16_t lap, int32_t cut, const char** topics, uint8_t count)
+{
+    char topic[SPOOL_MAX_MESSAGE], data[SPOOL_MAX_MESSAGE];
+    uint8_t i;
+    bool ok;
+
+    testCases++;
+    hostEepromCutAfter(-1);
+    initSpool();
+    ok = spoolGetCount() == count;
+    for (i = 0; ok && i < count; i++)
+    {
+        ok = spoolGetOldest(topic, data, sizeof(topic)) && strcmp(topic, topics[i]) == 0;
+        spoolRemoveOldest();
+    }
+    testDrain();
+
+    // the ring must still take a record and recover it after a reset
+    ok = ok && spoolPush("after", "cut") && spoolGetCount() == 1;
+    testDrain();
+    initSpool();
+    ok = ok && spoolGetCount() == 1 && spoolGetOldest(topic, data, sizeof(topic))
+            && strcmp(topic, "after") == 0 && strcmp(data, "cut") == 0;
+    if (!ok)
+    {
+        testFailures++;
+        printf("FAIL %s lap %u cut after %d writes\n", what, lap, cut);
+    }
+}
+
+// Cuts after every word of a push, the new record is all there or not at all
+void testPush(uint16_t lap)
+{
+    const char* topics[] = {"base/0", "base/1", "new"};
+    int32_t cut = 0;
+    bool wasCut;
+
+    do
+    {
+        testPrepare(lap);
+        hostEepromCutAfter(cut);
+        spoolPush("new", "record written while the supply fails");
+        testDrain();
+        wasCut = hostEepromIsCut();
+        testVerify("push", lap, cut, topics, wasCut ? 2 : 3);
+        cut++;
+    }
+    while (wasCut);
+}
+
+// Cuts during a retire, the oldest record is either still live or gone
+void testRetire(uint16_t lap)
+{
+    const char* topics[] = {"base/0", "base/1"};
+    int32_t cut = 0;
+    bool wasCut;
+
+    do
+    {
+        testPrepare(lap);
+        hostEepromCutAfter(cut);
+        spoolRemoveOldest();
+        testDrain();
+        wasCut = hostEepromIsCut();
+        if (wasCut)
+            testVerify("retire", lap, cut, topics, 2);
+        else
+            testVerify("retire", lap, cut, topics + 1, 1);
+        cut++;
+    }
+    while (wasCut);
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(void)
+{
+    uint16_t lap;
+
+    unsetenv("HOST_EEPROM");
+    for (lap = 0; lap < TEST_LAPS; lap++)
+    {
+        testPush(lap);
+        testRetire(lap);
+    }
+    printf("spooltest: %u cases, %u failures\n", testCases, testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
+
+#endif
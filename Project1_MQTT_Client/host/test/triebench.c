@@ -0,0 +1,198 @@
+// Topic Trie Benchmark
+// Publishes matched per second against thousands of subscription filters
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// Subscribes BENCH_FILTERS filters of the form bld/<b>/fl<f>/room<r>, with
+// one in eight replaced by a '+' or '#' filter, then dispatches publishes
+// to random rooms through topicTrieDispatch().  One in a hundred of the
+// same publishes is run through a linear scan of the filter strings, the
+// way a list of subscriptions would be searched.  The rate and the number
+// of handler calls (scaled up for the scan) are printed for both, so the
+// two can be checked against each other.
+//
+// The pools in topic.h are sized for the device and too small for this many
+// filters, so topic.c is included here with larger ones and nothing else is
+// needed.  Build from the project root with:
+//   gcc -O2 -g -std=gnu99 -I. -o triebench host/test/triebench.c
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TOPIC_MAX_NODES      8192
+#define TOPIC_EDGE_SLOTS     16384
+#define TOPIC_MAX_NAME_BYTES 60000
+#include "topic.c"
+
+#define BENCH_BUILDINGS  20
+#define BENCH_FLOORS     10
+#define BENCH_ROOMS      20
+#define BENCH_FILTERS    (BENCH_BUILDINGS * BENCH_FLOORS * BENCH_ROOMS)
+#define BENCH_TOPICS     1000
+#define BENCH_PUBLISHES  1000000
+#define BENCH_SIZE       32
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+char benchFilters[BENCH_FILTERS][BENCH_SIZE];
+char benchTopics[BENCH_TOPICS][BENCH_SIZE];
+uint16_t benchTopicLengths[BENCH_TOPICS];
+uint32_t benchCalls = 0;
+uint32_t benchSeed = 1;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint32_t benchRandom()
+{
+    benchSeed = benchSeed * 1664525 + 1013904223;
+    return benchSeed >> 8;
+}
+
+double benchSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void benchHandler(char* topic, uint16_t topicLength, uint8_t* data, uint16_t dataLength)
+{
+    benchCalls++;
+}
+
+// Returns true if filter i is the same as an earlier one
+bool benchIsRepeated(uint16_t i)
+{
+    uint16_t j;
+    for (j = 0; j < i; j++)
+        if (strcmp(benchFilters[j], benchFilters[i]) == 0)
+            return true;
+    return false;
+}
+
+// Matches one filter against a topic level by level, as a linear list would
+bool benchFilterMatches(char* filter, char* topic, uint16_t topicLength)
+{
+    uint16_t t = 0;
+    while (*filter != '\0')
+    {
+        if (filter[0] == '#')
+            return true;
+        if (filter[0] == '+')
+        {
+            while (t < topicLength && topic[t] != '/')
+                t++;
+            filter++;
+        }
+        else
+        {
+            while (*filter != '\0' && *filter != '/')
+            {
+                if (t >= topicLength || topic[t] != *filter)
+                    return false;
+                filter++;
+                t++;
+            }
+            if (t < topicLength && topic[t] != '/')
+                return false;
+        }
+        if (*filter == '/')
+        {
+            // "a/#" also matches "a"
+            if (t == topicLength)
+                return filter[1] == '#';
+            filter++;
+            t++;
+        }
+        else
+            return t == topicLength;
+    }
+    return t == topicLength;
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(void)
+{
+    uint16_t b, f, r, i = 0;
+    uint32_t n, calls;
+    double start, trieTime, linearTime;
+
+    initTopicTrie();
+    for (b = 0; b < BENCH_BUILDINGS; b++)
+        for (f = 0; f < BENCH_FLOORS; f++)
+            for (r = 0; r < BENCH_ROOMS; r++)
+            {
+                if (i % 16 == 7)
+                    snprintf(benchFilters[i], BENCH_SIZE, "bld/%u/+/room%u", b, r);
+                else if (i % 16 == 15)
+                    snprintf(benchFilters[i], BENCH_SIZE, "bld/%u/fl%u/#", b, f);
+                else
+                    benchFilters[i][0] = '\0';
+                // a repeated wildcard is one node in the trie, keep the list the same
+                if (benchFilters[i][0] == '\0' || benchIsRepeated(i))
+                    snprintf(benchFilters[i], BENCH_SIZE, "bld/%u/fl%u/room%u", b, f, r);
+                if (!topicTrieAdd(benchFilters[i], benchHandler))
+                {
+                    printf("triebench: pool full at filter %u\n", i);
+                    return 1;
+                }
+                i++;
+            }
+    for (i = 0; i < BENCH_TOPICS; i++)
+    {
+        snprintf(benchTopics[i], BENCH_SIZE, "bld/%u/fl%u/room%u", benchRandom() % BENCH_BUILDINGS,
+                 benchRandom() % BENCH_FLOORS, benchRandom() % BENCH_ROOMS);
+        benchTopicLengths[i] = strlen(benchTopics[i]);
+    }
+
+    start = benchSeconds();
+    for (n = 0; n < BENCH_PUBLISHES; n++)
+    {
+        i = n % BENCH_TOPICS;
+        topicTrieDispatch(benchTopics[i], benchTopicLengths[i], 0, 0);
+    }
+    trieTime = benchSeconds() - start;
+    calls = benchCalls;
+
+    benchCalls = 0;
+    start = benchSeconds();
+    for (n = 0; n < BENCH_PUBLISHES / 100; n++)
+    {
+        i = n % BENCH_TOPICS;
+        for (f = 0; f < BENCH_FILTERS; f++)
+            if (benchFilterMatches(benchFilters[f], benchTopics[i], benchTopicLengths[i]))
+                benchCalls++;
+    }
+    linearTime = benchSeconds() - start;
+
+    printf("triebench: %u filters, %u nodes\n", BENCH_FILTERS, topicTrieGetNodeCount());
+    printf("  trie:   %10.0f matches/s, %u handler calls in %u publishes\n",
+           BENCH_PUBLISHES / trieTime, calls, BENCH_PUBLISHES);
+    printf("  linear: %10.0f matches/s, %u handler calls in %u publishes\n",
+           (BENCH_PUBLISHES / 100) / linearTime, benchCalls * 100, BENCH_PUBLISHES);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,130 @@
+// Timer 4A Library
+// Host stand-in, a simulated clock for the Timer Service Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// The clock counts microseconds from initTimer4().  It follows the monotonic
+// clock unless hostSetClockVirtual() is called, after which it only moves
+// when hostAdvanceClock() or waitMicrosecond() moves it, so a replayed
+// capture runs as fast as the stack can take it with every timeout intact.
+// The whole milliseconds are counted by hostTimer4Poll(), the tickIsr of
+// the board, and there is no tick to stretch, so tickless idle never starts.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "timer.h"
+#include "timer4.h"
+#include "host.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint64_t timer4Start = 0;               // monotonic time at initTimer4()
+uint64_t timer4Virtual = 0;             // clock, while it is virtual
+bool timer4IsVirtual = false;
+uint64_t timer4Counted = 0;             // milliseconds passed to advanceTimers()
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint64_t hostGetMonotonic()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void initTimer4()
+{
+    timer4Start = hostGetMonotonic();
+    timer4Virtual = 0;
+    timer4IsVirtual = false;
+    timer4Counted = 0;
+}
+
+// Microseconds since initTimer4()
+uint64_t hostGetMicroseconds()
+{
+    if (timer4IsVirtual)
+        return timer4Virtual;
+    return hostGetMonotonic() - timer4Start;
+}
+
+// Time of the last millisecond counted
+uint64_t hostGetTickTime()
+{
+    return timer4Counted * 1000;
+}
+
+// Stops following the monotonic clock, from the time it reads now
+void hostSetClockVirtual()
+{
+    timer4Virtual = hostGetMicroseconds();
+    timer4IsVirtual = true;
+}
+
+bool hostIsClockVirtual()
+{
+    return timer4IsVirtual;
+}
+
+// Moves a virtual clock forward to time, it never goes back
+void hostAdvanceClock(uint64_t time)
+{
+    if (timer4IsVirtual && time > timer4Virtual)
+        timer4Virtual = time;
+}
+
+// Counts the milliseconds that have passed since the last call
+void hostTimer4Poll()
+{
+    uint64_t ms = hostGetMicroseconds() / 1000;
+    if (ms > timer4Counted)
+    {
+        advanceTimers(ms - timer4Counted);
+        timer4Counted = ms;
+    }
+}
+
+// Clocks left in the current millisecond, counting down from 40000 as on the board
+uint32_t getTimer4Value()
+{
+    return 40000 - (hostGetMicroseconds() % 1000) * 40;
+}
+
+void tickIsr()
+{
+    hostTimer4Poll();
+}
+
+// Microseconds since initTimer(), wraps after 71 minutes
+uint32_t getTimerMicroseconds()
+{
+    return hostGetMicroseconds();
+}
+
+bool startTickless(uint32_t milliseconds)
+{
+    return false;
+}
+
+void stopTickless()
+{
+}
+
+#endif
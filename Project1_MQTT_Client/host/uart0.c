@@ -0,0 +1,156 @@
+// UART0 Library
+// Host stand-in, the console is stdin and stdout
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+// Input is read by hostUart0Poll() into the same kind of ring uart0Isr
+// fills on the board, so kbhitUart0() and getLineUart0() behave the same.
+// Output goes to stdout, which is flushed whenever the stack goes idle.
+// Once stdin ends the console is simply quiet, so the host also runs
+// detached with input from /dev/null.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include "uart0.h"
+#include "sched.h"
+#include "host.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+char uart0RxBuffer[UART0_RX_BUFFER_SIZE];
+uint16_t uart0RxWriteIndex = 0;
+uint16_t uart0RxReadIndex = 0;
+uint16_t uart0RxDropCount = 0;
+bool uart0RxEnded = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initUart0(void)
+{
+    uart0RxWriteIndex = uart0RxReadIndex = 0;
+    uart0RxEnded = false;
+}
+
+void setUart0BaudRate(uint32_t baudRate, uint32_t fcyc)
+{
+}
+
+void writeUart0(const char* data, uint16_t size)
+{
+    fwrite(data, 1, size, stdout);
+}
+
+void putcUart0(char c)
+{
+    putchar(c);
+}
+
+void putsUart0(char* str)
+{
+    fputs(str, stdout);
+}
+
+void flushUart0(void)
+{
+    fflush(stdout);
+}
+
+// Reads whatever stdin has ready into the rx ring, posting the console event
+void hostUart0Poll()
+{
+    struct timeval timeout = {0, 0};
+    fd_set fds;
+    char buffer[UART0_RX_BUFFER_SIZE];
+    uint16_t next, write = uart0RxWriteIndex;
+    int i, count;
+    if (uart0RxEnded)
+        return;
+    FD_ZERO(&fds);
+    FD_SET(STDIN_FILENO, &fds);
+    if (select(STDIN_FILENO + 1, &fds, 0, 0, &timeout) <= 0)
+        return;
+    count = read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (count <= 0)
+    {
+        uart0RxEnded = true;
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        next = (write + 1) & (UART0_RX_BUFFER_SIZE - 1);
+        if (next == uart0RxReadIndex)
+            uart0RxDropCount++;
+        else
+        {
+            uart0RxBuffer[write] = buffer[i];
+            write = next;
+        }
+    }
+    if (write != uart0RxWriteIndex)
+        schedPost(schedConsole);
+    uart0RxWriteIndex = write;
+}
+
+// File descriptor to wait on for input, -1 once stdin has ended
+int hostUart0GetFd()
+{
+    return uart0RxEnded ? -1 : STDIN_FILENO;
+}
+
+// Blocking function that returns with serial data once the buffer is not empty
+char getcUart0(void)
+{
+    char c;
+    while (uart0RxReadIndex == uart0RxWriteIndex && !uart0RxEnded)
+    {
+        hostWait();
+        hostUart0Poll();
+    }
+    if (uart0RxReadIndex == uart0RxWriteIndex)
+        return '\n';
+    c = uart0RxBuffer[uart0RxReadIndex];
+    uart0RxReadIndex = (uart0RxReadIndex + 1) & (UART0_RX_BUFFER_SIZE - 1);
+    return c;
+}
+
+bool kbhitUart0(void)
+{
+    return uart0RxReadIndex != uart0RxWriteIndex;
+}
+
+// stdout takes everything, nothing is dropped
+uint16_t getUart0TxSpace(void)
+{
+    return UART0_TX_BUFFER_SIZE;
+}
+
+uint16_t getUart0TxDropCount(void)
+{
+    return 0;
+}
+
+uint16_t getUart0RxDropCount(void)
+{
+    return uart0RxDropCount;
+}
+
+#endif
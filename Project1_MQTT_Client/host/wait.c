@@ -0,0 +1,37 @@
+// Wait functions
+// Host stand-in
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: Linux workstation
+// Target uC:       -
+// System Clock:    -
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "wait.h"
+#include "host.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Sleeps, or moves a virtual clock on by the same amount
+void waitMicrosecond(uint32_t us)
+{
+    if (hostIsClockVirtual())
+        hostAdvanceClock(hostGetMicroseconds() + us);
+    else
+        usleep(us);
+}
+
+#endif
@@ -0,0 +1,140 @@
+// Idle Library
+// Sleep state selection and residency accounting for the scheduler
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// The scheduler calls idleEnter() with interrupts masked once nothing is
+// pending.  The core always sleeps with WFI, so the ENC28J60 INT pin (Port C),
+// UART0 receive, the uDMA transmit completion and Timer 4A all wake it.  When
+// the next software timer is at least two milliseconds away the tick is also
+// stretched to that deadline so the board is not woken 1000 times a second
+// just to count.  Deep-sleep is not used: it stops the PLL that UART0, SSI0
+// and Timer 4A are clocked from, so console input would be garbled and the
+// time base would drift while asleep.
+// Time spent in each state is kept in microseconds, as is the time from the
+// core waking to the scheduler dispatching the event that woke it, which is
+// the latency the sleep state costs.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "idle.h"
+#include "timer.h"
+#include "cpu.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+bool idleTicklessEnabled = true;
+uint32_t idleEntries[idleStateCount];
+uint64_t idleResidency[idleStateCount];
+uint32_t idleWakeMax[idleStateCount];
+uint64_t idleWakeTotal[idleStateCount];
+uint32_t idleWakeCount[idleStateCount];
+uint32_t idleStartTicks = 0;
+idleState idleLastState = idleSleep;
+bool idleWaking = false;
+uint32_t idleWokeAt = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initIdle()
+{
+    uint8_t i;
+    for (i = 0; i < idleStateCount; i++)
+    {
+        idleEntries[i] = 0;
+        idleResidency[i] = 0;
+        idleWakeMax[i] = 0;
+        idleWakeTotal[i] = 0;
+        idleWakeCount[i] = 0;
+    }
+    idleWaking = false;
+    idleStartTicks = getTimerTicks();
+}
+
+// Sleeps until an interrupt, call with interrupts masked and no event pending
+void idleEnter()
+{
+    idleState state = idleSleep;
+    uint32_t start;
+    start = getTimerMicroseconds();
+    if (idleTicklessEnabled && startTickless(getTimerIdleTime()))
+        state = idleTickless;
+    waitForInterrupt();
+    if (state == idleTickless)
+        stopTickless();
+    idleWokeAt = getTimerMicroseconds();
+    idleResidency[state] += idleWokeAt - start;
+    idleEntries[state]++;
+    idleLastState = state;
+    idleWaking = true;
+}
+
+// Called by the scheduler as a handler starts, the first one after a wake is timed
+void idleNoteDispatch(uint32_t start)
+{
+    uint32_t time;
+    if (idleWaking)
+    {
+        idleWaking = false;
+        time = start - idleWokeAt;
+        if (time > idleWakeMax[idleLastState])
+            idleWakeMax[idleLastState] = time;
+        idleWakeTotal[idleLastState] += time;
+        idleWakeCount[idleLastState]++;
+    }
+}
+
+// Tickless sleep saves the tick wakes, plain sleep wakes slightly faster
+void idleSetTickless(bool enable)
+{
+    idleTicklessEnabled = enable;
+}
+
+bool idleGetTickless()
+{
+    return idleTicklessEnabled;
+}
+
+uint32_t idleGetEntries(idleState state)
+{
+    return idleEntries[state];
+}
+
+// Milliseconds spent asleep in state
+uint32_t idleGetResidency(idleState state)
+{
+    return idleResidency[state] / 1000;
+}
+
+// Milliseconds since initIdle(), to put the residency in proportion
+uint32_t idleGetUptime()
+{
+    return getTimerTicks() - idleStartTicks;
+}
+
+// Longest wake to dispatch after sleeping in state, in microseconds
+uint32_t idleGetMaxWake(idleState state)
+{
+    return idleWakeMax[state];
+}
+
+uint32_t idleGetAverageWake(idleState state)
+{
+    if (idleWakeCount[state] == 0)
+        return 0;
+    return idleWakeTotal[state] / idleWakeCount[state];
+}
@@ -0,0 +1,44 @@
+// Idle Library
+// Sleep state selection and residency accounting for the scheduler
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef IDLE_H_
+#define IDLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum _idleState
+{
+    idleSleep,                  // WFI with the 1 ms tick running
+    idleTickless,               // WFI with the tick stretched to the next timer deadline
+    idleStateCount
+} idleState;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initIdle();
+void idleEnter();
+void idleNoteDispatch(uint32_t start);
+void idleSetTickless(bool enable);
+bool idleGetTickless();
+uint32_t idleGetEntries(idleState state);
+uint32_t idleGetResidency(idleState state);
+uint32_t idleGetUptime();
+uint32_t idleGetMaxWake(idleState state);
+uint32_t idleGetAverageWake(idleState state);
+
+#endif
@@ -0,0 +1,93 @@
+// Keepalive Library
+// Mqtt PINGREQ scheduling and broker liveness detection
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// The keepalive interval only has to be covered by some control packet, so
+// every Mqtt packet sent restarts the interval and PINGREQ goes out only when
+// the link has been quiet.  The ping is sent at 3/4 of the interval to leave
+// room for a lost ping; a PINGRESP that doesn't arrive within
+// KEEPALIVE_RESPONSE_TIMEOUT reports the broker lost long before the broker's
+// own 1.5x keepalive timeout would.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "keepalive.h"
+#include "timer.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+bool keepAliveRunning = false;
+bool keepAlivePingOutstanding = false;
+uint32_t keepAliveInterval = 0;
+uint32_t keepAliveLastSent = 0;
+uint32_t keepAlivePingTime = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Starts scheduling once the connection is accepted, seconds as sent in CONNECT
+void keepAliveStart(uint16_t seconds)
+{
+    keepAliveInterval = (uint32_t)seconds * 750;
+    keepAliveLastSent = getTimerTicks();
+    keepAlivePingOutstanding = false;
+    keepAliveRunning = seconds != 0;
+}
+
+void keepAliveStop()
+{
+    keepAliveRunning = false;
+    keepAlivePingOutstanding = false;
+}
+
+// Any control packet sent counts as keepalive traffic
+void keepAliveNoteSent()
+{
+    keepAliveLastSent = getTimerTicks();
+}
+
+// PINGRESP (or any other packet from the broker) shows the broker is alive
+void keepAliveNoteReceived()
+{
+    keepAlivePingOutstanding = false;
+}
+
+void keepAlivePingSent()
+{
+    keepAlivePingOutstanding = true;
+    keepAlivePingTime = getTimerTicks();
+}
+
+// Called from the main loop while the connection is live
+keepAliveAction keepAlivePoll()
+{
+    uint32_t now = getTimerTicks();
+    if (!keepAliveRunning)
+        return keepAliveIdle;
+    if (keepAlivePingOutstanding)
+    {
+        if (now - keepAlivePingTime >= KEEPALIVE_RESPONSE_TIMEOUT)
+        {
+            keepAliveStop();
+            return keepAliveExpired;
+        }
+        return keepAliveIdle;
+    }
+    if (now - keepAliveLastSent >= keepAliveInterval)
+        return keepAliveSendPing;
+    return keepAliveIdle;
+}
@@ -0,0 +1,43 @@
+// Keepalive Library
+// Mqtt PINGREQ scheduling and broker liveness detection
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef KEEPALIVE_H_
+#define KEEPALIVE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Milliseconds to wait for PINGRESP before declaring the broker lost
+#define KEEPALIVE_RESPONSE_TIMEOUT 5000
+
+typedef enum
+{
+    keepAliveIdle = 0,
+    keepAliveSendPing = 1,
+    keepAliveExpired = 2
+} keepAliveAction;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void keepAliveStart(uint16_t seconds);
+void keepAliveStop();
+void keepAliveNoteSent();
+void keepAliveNoteReceived();
+void keepAlivePingSent();
+keepAliveAction keepAlivePoll();
+
+#endif
@@ -0,0 +1,252 @@
+// Mirror Library
+// Second broker session that receives a copy of every publish
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// The mirror is a second, independent connection from the TCP connection
+// table, held open next to the primary broker connection.  It speaks plain
+// Mqtt 3.1.1 with a clean session, building its packets with the same eth0
+// builders as the primary but from its own parameters, so it shares no
+// alias, session or keepalive state with the primary connection.  It only
+// publishes: every message published to the primary broker is copied here
+// at QoS 0.  It connects as the primary client ID with "-m" added, since a
+// broker drops the older of two connections that share a client ID and
+// both brokers may be the same one.  A connection that fails or goes quiet for 1.5 keepalive
+// intervals is dropped and tried again after MIRROR_RETRY_TIME.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mirror.h"
+#include "eth0.h"
+#include "tcp.h"
+#include "session.h"
+#include "timer.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+mirrorState mirrorCurrentState = mirrorOff;
+uint8_t mirrorBrokerIp[4] = {0,0,0,0};
+socket* mirrorSocket = 0;
+uint32_t mirrorStateTime = 0;
+uint32_t mirrorLastSent = 0;
+uint32_t mirrorLastReceived = 0;
+uint32_t mirrorPublishCount = 0;
+uint8_t mirrorPayload[MIRROR_MAX_PAYLOAD];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initMirror()
+{
+    mirrorCurrentState = mirrorOff;
+    mirrorSocket = 0;
+}
+
+// 0.0.0.0 turns the mirror off
+void mirrorSetBroker(uint8_t ip[4])
+{
+    uint8_t i;
+    for (i = 0; i < 4; i++)
+        mirrorBrokerIp[i] = ip[i];
+}
+
+void mirrorGetBroker(uint8_t ip[4])
+{
+    uint8_t i;
+    for (i = 0; i < 4; i++)
+        ip[i] = mirrorBrokerIp[i];
+}
+
+void mirrorSetState(mirrorState state)
+{
+    mirrorCurrentState = state;
+    mirrorStateTime = getTimerTicks();
+}
+
+void mirrorStart()
+{
+    if ((mirrorBrokerIp[0] | mirrorBrokerIp[1] | mirrorBrokerIp[2] | mirrorBrokerIp[3]) == 0)
+        return;
+    if (mirrorCurrentState == mirrorOff)
+    {
+        mirrorSetState(mirrorWaiting);
+        mirrorStateTime -= MIRROR_RETRY_TIME;       // first attempt right away
+    }
+}
+
+void mirrorSend(etherHeader* ether, uint16_t flags, uint8_t* data, uint16_t size)
+{
+    etherSendTcp(ether, mirrorSocket, flags, data, size);
+    if (size > 0)
+        mirrorLastSent = getTimerTicks();
+}
+
+// Abandons the connection, a new one is tried after MIRROR_RETRY_TIME
+void mirrorDrop(etherHeader* ether)
+{
+    if (mirrorSocket != 0)
+    {
+        if (mirrorCurrentState != mirrorWaiting)
+            etherSendTcp(ether, mirrorSocket, TCP_RESET, 0, 0);
+        tcpClose(mirrorSocket);
+        mirrorSocket = 0;
+    }
+    mirrorSetState(mirrorWaiting);
+}
+
+void mirrorStop(etherHeader* ether)
+{
+    uint8_t disconnect[2] = {0xE0, 0x00};
+    if (mirrorCurrentState == mirrorLive)
+        mirrorSend(ether, TCP_PUSH_ACK, disconnect, 2);
+    mirrorDrop(ether);
+    mirrorCurrentState = mirrorOff;
+}
+
+void mirrorSendConnect(etherHeader* ether)
+{
+    char clientId[MIRROR_CLIENT_ID_LENGTH];
+    char* primaryId = sessionGetClientId();
+    uint16_t i;
+    for (i = 0; primaryId[i] != '\0' && i < MIRROR_CLIENT_ID_LENGTH - 3; i++)
+        clientId[i] = primaryId[i];
+    clientId[i++] = '-';
+    clientId[i++] = 'm';
+    clientId[i] = '\0';
+    mirrorSend(ether, TCP_PUSH_ACK, mirrorPayload,
+               etherMqttBuildConnect(mirrorPayload, 4, false, MIRROR_KEEPALIVE, clientId));
+}
+
+// Copies a publish to the mirror broker at QoS 0
+// Returns false if the mirror is not connected, the message is too long or it doesn't fit the window
+bool mirrorPublish(etherHeader* ether, char* topic, char* data)
+{
+    uint16_t topicLength = 0, dataLength = 0;
+    if (mirrorCurrentState != mirrorLive)
+        return false;
+    while (topic[topicLength] != '\0')
+        topicLength++;
+    while (data[dataLength] != '\0')
+        dataLength++;
+    if (topicLength + dataLength + 2 > MIRROR_MAX_PAYLOAD - 4)
+        return false;
+    // a copy that would overrun the broker's receive window is dropped, it is QoS 0
+    if (!tcpCanSend(mirrorSocket, topicLength + dataLength + 5))
+        return false;
+    mirrorSend(ether, TCP_PUSH_ACK, mirrorPayload, etherMqttBuildPublish(mirrorPayload, 4, topic, data, 0, false));
+    mirrorPublishCount++;
+    return true;
+}
+
+// Opens the connection when due, times out handshakes and keeps the broker alive
+void mirrorService(etherHeader* ether)
+{
+    uint32_t now = getTimerTicks();
+    uint8_t ping[2] = {0xC0, 0x00};
+    switch (mirrorCurrentState)
+    {
+    case mirrorWaiting:
+        if ((int32_t)(now - mirrorStateTime) >= MIRROR_RETRY_TIME && etherIsIpValid())
+        {
+            mirrorSocket = tcpOpen(mirrorBrokerIp, MIRROR_BROKER_PORT, 49152 + random32() % 16384);
+            if (mirrorSocket == 0)
+            {
+                mirrorSetState(mirrorWaiting);
+                break;
+            }
+            // an unresolved next hop holds the SYN in the ARP queue until it answers
+            etherSendTcp(ether, mirrorSocket, TCP_SYNC, 0, 0);
+            mirrorSetState(mirrorSynSent);
+        }
+        break;
+    case mirrorSynSent:
+    case mirrorConnecting:
+        if ((int32_t)(now - mirrorStateTime) >= MIRROR_RETRY_TIME)
+            mirrorDrop(ether);
+        break;
+    case mirrorLive:
+        if ((int32_t)(now - mirrorLastReceived) >= MIRROR_KEEPALIVE * 1500)
+            mirrorDrop(ether);
+        else if ((int32_t)(now - mirrorLastSent) >= MIRROR_KEEPALIVE * 750)
+            mirrorSend(ether, TCP_PUSH_ACK, ping, 2);
+        break;
+    default:
+        break;
+    }
+}
+
+// Returns true if a received segment belongs to the mirror connection
+bool mirrorIsSegment(etherHeader* ether)
+{
+    return mirrorSocket != 0 && tcpFind(ether) == mirrorSocket;
+}
+
+void mirrorProcess(etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
+    uint16_t flags = htons(tcp->offsetFields) & 0x0FFF;
+    uint16_t dataLength = etherGetTcpDataLength(ether);
+    if ((flags & TCP_RESET) != 0)
+    {
+        tcpClose(mirrorSocket);
+        mirrorSocket = 0;
+        mirrorSetState(mirrorWaiting);
+        return;
+    }
+    if ((flags & TCP_FIN) != 0)
+    {
+        tcpAcceptSegment(mirrorSocket, ether, dataLength + 1);
+        mirrorDrop(ether);
+        return;
+    }
+    if (mirrorCurrentState == mirrorSynSent && flags == TCP_SYNACK)
+    {
+        // the ACK completing the handshake carries CONNECT
+        tcpAcceptSegment(mirrorSocket, ether, 1);
+        mirrorSendConnect(ether);
+        mirrorSetState(mirrorConnecting);
+        return;
+    }
+    if ((flags & TCP_ACK) == 0 || mirrorCurrentState < mirrorConnecting)
+        return;
+    tcpAcceptSegment(mirrorSocket, ether, dataLength);
+    if (dataLength == 0)
+        return;
+    mirrorLastReceived = getTimerTicks();
+    if (mirrorCurrentState == mirrorConnecting)
+    {
+        if (tcp->data[0] == 0x20 && dataLength >= 4 && tcp->data[3] == 0x00)
+            mirrorSetState(mirrorLive);
+        else
+        {
+            mirrorDrop(ether);
+            return;
+        }
+    }
+    etherSendTcp(ether, mirrorSocket, TCP_ACK, 0, 0);
+}
+
+mirrorState mirrorGetState()
+{
+    return mirrorCurrentState;
+}
+
+uint32_t mirrorGetPublishCount()
+{
+    return mirrorPublishCount;
+}
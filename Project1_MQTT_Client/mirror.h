@@ -0,0 +1,56 @@
+// Mirror Library
+// Second broker session that receives a copy of every publish
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef MIRROR_H_
+#define MIRROR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "eth0.h"
+
+#define MIRROR_BROKER_PORT  1883
+// Handshake timeout, and the wait before trying again (ms)
+#define MIRROR_RETRY_TIME   5000
+#define MIRROR_KEEPALIVE    MQTT_KEEPALIVE
+#define MIRROR_MAX_PAYLOAD  256
+// Primary client ID with "-m" added, and its terminator
+#define MIRROR_CLIENT_ID_LENGTH 20
+
+typedef enum _mirrorState
+{
+    mirrorOff = 0,
+    mirrorWaiting = 1,
+    mirrorSynSent = 2,
+    mirrorConnecting = 3,
+    mirrorLive = 4
+} mirrorState;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initMirror();
+void mirrorSetBroker(uint8_t ip[4]);
+void mirrorGetBroker(uint8_t ip[4]);
+void mirrorStart();
+void mirrorStop(etherHeader* ether);
+bool mirrorPublish(etherHeader* ether, char* topic, char* data);
+void mirrorService(etherHeader* ether);
+bool mirrorIsSegment(etherHeader* ether);
+void mirrorProcess(etherHeader* ether);
+mirrorState mirrorGetState();
+uint32_t mirrorGetPublishCount();
+
+#endif
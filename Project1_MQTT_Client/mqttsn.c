@@ -0,0 +1,560 @@
+// MQTT-SN Library
+// MQTT-SN 1.2 client transport over UDP to a gateway on the LAN
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// The gateway is addressed directly by IP and port, there is no SEARCHGW or
+// ADVERTISE discovery.  Topics travel as 2 byte ids instead of names:
+// two character names are sent as short topic names, names given an id with
+// mqttSnDefineTopic() are predefined, and every other name is REGISTERed
+// with the gateway the first time it is published while connected.  Without
+// a connection only short and predefined topics can be published, at QoS -1.
+// As the spec asks, only one request that needs an answer (CONNECT,
+// REGISTER, SUBSCRIBE, UNSUBSCRIBE, PINGREQ) is outstanding at a time.  It
+// is repeated every MQTTSN_RETRY_TIME, and when MQTTSN_MAX_RETRIES repeats
+// go unanswered the gateway is considered lost.  Sessions are always clean,
+// so subscriptions are sent again after every CONNACK.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mqttsn.h"
+#include "eth0.h"
+#include "udp.h"
+#include "session.h"
+#include "timer.h"
+
+// Ethernet, IP and UDP headers in front of every message
+#define MQTTSN_FRAME_OVERHEAD 42
+
+typedef struct _mqttSnTopic
+{
+    char name[MQTTSN_TOPIC_LENGTH];     // empty when the slot is free
+    uint16_t id;                        // 0 until registered
+    uint8_t idType;
+    bool subscribe;                     // wanted by the application
+    bool subscribed;                    // acknowledged by the gateway
+} mqttSnTopic;
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+mqttSnTopic mqttSnTopics[MQTTSN_MAX_TOPICS];
+mqttSnState mqttSnCurrentState = mqttSnDisconnected;
+uint8_t mqttSnGatewayIp[4] = {0,0,0,0};
+uint16_t mqttSnGatewayPort = MQTTSN_GATEWAY_PORT;
+uint16_t mqttSnLocalPort = 0;
+uint16_t mqttSnMsgId = 0;
+topicHandler mqttSnUnclaimed = 0;
+
+// Outstanding request, kept to be repeated
+uint8_t mqttSnRequest[MQTTSN_MAX_MESSAGE];
+uint8_t mqttSnRequestLength = 0;
+uint8_t mqttSnAwaiting = 0;             // message type answering the request, 0 if none
+uint16_t mqttSnAwaitingMsgId = 0;
+int8_t mqttSnRequestTopic = -1;
+uint8_t mqttSnRetries = 0;
+uint32_t mqttSnRequestTime = 0;
+uint32_t mqttSnLastSent = 0;
+
+// Publish waiting for its topic to be registered
+int8_t mqttSnHeldTopic = -1;
+uint8_t mqttSnHeldData[MQTTSN_MAX_MESSAGE];
+uint8_t mqttSnHeldSize = 0;
+
+uint32_t mqttSnSentCount = 0;
+uint32_t mqttSnSentBytes = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void mqttSnReceive(etherHeader* ether, uint8_t srcIp[4], uint16_t srcPort, uint8_t* data, uint16_t size);
+
+void initMqttSn(topicHandler unclaimed)
+{
+    uint8_t i;
+    for (i = 0; i < MQTTSN_MAX_TOPICS; i++)
+        mqttSnTopics[i].name[0] = '\0';
+    mqttSnUnclaimed = unclaimed;
+    mqttSnCurrentState = mqttSnDisconnected;
+    mqttSnAwaiting = 0;
+    mqttSnHeldTopic = -1;
+    mqttSnLocalPort = udpBind(0, mqttSnReceive);
+}
+
+void mqttSnSetGateway(uint8_t ip[4], uint16_t port)
+{
+    uint8_t i;
+    for (i = 0; i < 4; i++)
+        mqttSnGatewayIp[i] = ip[i];
+    mqttSnGatewayPort = port;
+}
+
+uint8_t mqttSnStringLength(char* str)
+{
+    uint8_t length = 0;
+    while (str[length] != '\0')
+        length++;
+    return length;
+}
+
+bool mqttSnNameMatches(char* name, char* topic, uint8_t length)
+{
+    uint8_t i;
+    for (i = 0; i < length; i++)
+        if (name[i] != topic[i])
+            return false;
+    return name[length] == '\0';
+}
+
+// Returns the slot holding topic, or -1
+int8_t mqttSnFind(char* topic, uint8_t length)
+{
+    uint8_t i;
+    for (i = 0; i < MQTTSN_MAX_TOPICS; i++)
+        if (mqttSnTopics[i].name[0] != '\0' && mqttSnNameMatches(mqttSnTopics[i].name, topic, length))
+            return i;
+    return -1;
+}
+
+// Returns the slot for topic, adding it if needed, or -1 if the table is full
+int8_t mqttSnAdd(char* topic, uint8_t length)
+{
+    int8_t index = mqttSnFind(topic, length);
+    uint8_t i;
+    if (index >= 0)
+        return index;
+    if (length == 0 || length >= MQTTSN_TOPIC_LENGTH)
+        return -1;
+    for (i = 0; i < MQTTSN_MAX_TOPICS && index < 0; i++)
+        if (mqttSnTopics[i].name[0] == '\0')
+            index = i;
+    if (index < 0)
+        return -1;
+    for (i = 0; i < length; i++)
+        mqttSnTopics[index].name[i] = topic[i];
+    mqttSnTopics[index].name[length] = '\0';
+    mqttSnTopics[index].id = 0;
+    mqttSnTopics[index].idType = MQTTSN_TOPIC_NORMAL;
+    mqttSnTopics[index].subscribe = false;
+    mqttSnTopics[index].subscribed = false;
+    return index;
+}
+
+uint16_t mqttSnNextMsgId()
+{
+    mqttSnMsgId++;
+    if (mqttSnMsgId == 0)
+        mqttSnMsgId = 1;
+    return mqttSnMsgId;
+}
+
+bool mqttSnSend(etherHeader* ether, uint8_t* message, uint8_t length)
+{
+    mqttSnSentCount++;
+    mqttSnSentBytes += MQTTSN_FRAME_OVERHEAD + length;
+    mqttSnLastSent = getTimerTicks();
+    return udpSendTo(ether, mqttSnLocalPort, mqttSnGatewayIp, mqttSnGatewayPort, message, length);
+}
+
+// Sends the request built in mqttSnRequest and waits for awaited
+void mqttSnStartRequest(etherHeader* ether, uint8_t length, uint8_t awaited, uint16_t msgId, int8_t topic)
+{
+    mqttSnRequest[0] = length;
+    mqttSnRequestLength = length;
+    mqttSnAwaiting = awaited;
+    mqttSnAwaitingMsgId = msgId;
+    mqttSnRequestTopic = topic;
+    mqttSnRetries = 0;
+    mqttSnRequestTime = getTimerTicks();
+    mqttSnSend(ether, mqttSnRequest, length);
+}
+
+// Writes the topic field of a topic slot, as a name or a 2 byte id
+uint8_t mqttSnPutTopic(uint8_t* message, mqttSnTopic* topic)
+{
+    uint8_t i = 0;
+    if (topic->idType == MQTTSN_TOPIC_PREDEFINED)
+    {
+        message[0] = topic->id >> 8;
+        message[1] = topic->id & 0xFF;
+        return 2;
+    }
+    while (topic->name[i] != '\0')
+    {
+        message[i] = topic->name[i];
+        i++;
+    }
+    return i;
+}
+
+// Gives a topic a fixed id agreed with the gateway beforehand
+bool mqttSnDefineTopic(char* topic, uint16_t id)
+{
+    int8_t index = mqttSnAdd(topic, mqttSnStringLength(topic));
+    if (index < 0 || id == 0)
+        return false;
+    mqttSnTopics[index].id = id;
+    mqttSnTopics[index].idType = MQTTSN_TOPIC_PREDEFINED;
+    return true;
+}
+
+void mqttSnConnect(etherHeader* ether)
+{
+    char* clientId = sessionGetClientId();
+    uint8_t length = 6;
+    mqttSnRequest[1] = MQTTSN_CONNECT;
+    mqttSnRequest[2] = MQTTSN_FLAG_CLEAN;
+    mqttSnRequest[3] = 0x01;                        // protocol id
+    mqttSnRequest[4] = MQTTSN_KEEPALIVE >> 8;
+    mqttSnRequest[5] = MQTTSN_KEEPALIVE & 0xFF;
+    while (*clientId != '\0' && length < MQTTSN_MAX_MESSAGE)
+        mqttSnRequest[length++] = *clientId++;
+    mqttSnHeldTopic = -1;
+    mqttSnCurrentState = mqttSnConnecting;
+    mqttSnStartRequest(ether, length, MQTTSN_CONNACK, 0, -1);
+}
+
+void mqttSnLost()
+{
+    mqttSnCurrentState = mqttSnDisconnected;
+    mqttSnAwaiting = 0;
+    mqttSnHeldTopic = -1;
+}
+
+void mqttSnDisconnect(etherHeader* ether)
+{
+    uint8_t message[2] = {2, MQTTSN_DISCONNECT};
+    if (mqttSnCurrentState != mqttSnDisconnected)
+        mqttSnSend(ether, message, 2);
+    mqttSnLost();
+}
+
+// Publishes at QoS 0 while connected and QoS -1 otherwise
+// A topic that still has to be registered holds the message until REGACK
+// Returns false if the message cannot be sent
+bool mqttSnPublish(etherHeader* ether, char* topic, uint8_t* data, uint16_t size)
+{
+    uint8_t* message = etherGetUdpTxData(ether);
+    uint8_t length = mqttSnStringLength(topic);
+    uint8_t flags;
+    uint16_t id, i;
+    int8_t index = -1;
+    bool connected = (mqttSnCurrentState == mqttSnConnected);
+    if (size > MQTTSN_MAX_MESSAGE - 7)
+        return false;
+    if (length == 2)
+    {
+        flags = MQTTSN_TOPIC_SHORT;
+        id = (topic[0] << 8) | (uint8_t)topic[1];
+    }
+    else
+    {
+        index = mqttSnFind(topic, length);
+        if (index < 0 && connected)
+            index = mqttSnAdd(topic, length);
+        if (index < 0 || (!connected && mqttSnTopics[index].idType != MQTTSN_TOPIC_PREDEFINED))
+            return false;
+        if (mqttSnTopics[index].id == 0)
+        {
+            if (mqttSnHeldTopic >= 0)
+                return false;
+            for (i = 0; i < size; i++)
+                mqttSnHeldData[i] = data[i];
+            mqttSnHeldSize = size;
+            mqttSnHeldTopic = index;
+            return true;
+        }
+        flags = mqttSnTopics[index].idType;
+        id = mqttSnTopics[index].id;
+    }
+    flags |= connected ? MQTTSN_FLAG_QOS0 : MQTTSN_FLAG_QOS_M1;
+    message[0] = 7 + size;
+    message[1] = MQTTSN_PUBLISH;
+    message[2] = flags;
+    message[3] = id >> 8;
+    message[4] = id & 0xFF;
+    message[5] = 0;                                 // no message id at QoS 0 and -1
+    message[6] = 0;
+    for (i = 0; i < size; i++)
+        message[7 + i] = data[i];
+    return mqttSnSend(ether, message, 7 + size);
+}
+
+// Subscriptions are sent by mqttSnService once connected, and again after every CONNACK
+bool mqttSnSubscribe(char* topic)
+{
+    int8_t index = mqttSnAdd(topic, mqttSnStringLength(topic));
+    if (index < 0)
+        return false;
+    mqttSnTopics[index].subscribe = true;
+    return true;
+}
+
+bool mqttSnUnsubscribe(char* topic)
+{
+    int8_t index = mqttSnFind(topic, mqttSnStringLength(topic));
+    if (index < 0 || !mqttSnTopics[index].subscribe)
+        return false;
+    mqttSnTopics[index].subscribe = false;
+    return true;
+}
+
+// Sends the REGISTER, SUBSCRIBE or UNSUBSCRIBE the topic table needs next
+// Returns false if there is nothing to do
+bool mqttSnSendNextRequest(etherHeader* ether)
+{
+    mqttSnTopic* topic;
+    uint16_t msgId;
+    uint8_t i, type, awaited;
+    if (mqttSnHeldTopic >= 0 && mqttSnTopics[mqttSnHeldTopic].id == 0)
+    {
+        topic = &mqttSnTopics[mqttSnHeldTopic];
+        msgId = mqttSnNextMsgId();
+        mqttSnRequest[1] = MQTTSN_REGISTER;
+        mqttSnRequest[2] = 0;
+        mqttSnRequest[3] = 0;
+        mqttSnRequest[4] = msgId >> 8;
+        mqttSnRequest[5] = msgId & 0xFF;
+        mqttSnStartRequest(ether, 6 + mqttSnPutTopic(&mqttSnRequest[6], topic), MQTTSN_REGACK, msgId, mqttSnHeldTopic);
+        return true;
+    }
+    for (i = 0; i < MQTTSN_MAX_TOPICS; i++)
+    {
+        topic = &mqttSnTopics[i];
+        if (topic->name[0] == '\0' || topic->subscribe == topic->subscribed)
+            continue;
+        type = topic->subscribe ? MQTTSN_SUBSCRIBE : MQTTSN_UNSUBSCRIBE;
+        awaited = topic->subscribe ? MQTTSN_SUBACK : MQTTSN_UNSUBACK;
+        msgId = mqttSnNextMsgId();
+        mqttSnRequest[1] = type;
+        mqttSnRequest[2] = MQTTSN_FLAG_QOS0 | (mqttSnStringLength(topic->name) == 2 ? MQTTSN_TOPIC_SHORT : topic->idType);
+        mqttSnRequest[3] = msgId >> 8;
+        mqttSnRequest[4] = msgId & 0xFF;
+        mqttSnStartRequest(ether, 5 + mqttSnPutTopic(&mqttSnRequest[5], topic), awaited, msgId, i);
+        return true;
+    }
+    return false;
+}
+
+// Repeats unanswered requests, works through the topic table and keeps the gateway alive
+void mqttSnService(etherHeader* ether)
+{
+    uint32_t now = getTimerTicks();
+    if (mqttSnAwaiting != 0)
+    {
+        if ((int32_t)(now - mqttSnRequestTime) >= MQTTSN_RETRY_TIME)
+        {
+            if (mqttSnRetries >= MQTTSN_MAX_RETRIES)
+                mqttSnLost();
+            else
+            {
+                mqttSnRetries++;
+                mqttSnRequestTime = now;
+                mqttSnSend(ether, mqttSnRequest, mqttSnRequestLength);
+            }
+        }
+        return;
+    }
+    if (mqttSnCurrentState != mqttSnConnected || mqttSnSendNextRequest(ether))
+        return;
+    // ping well inside the keep alive duration the gateway was given
+    if ((int32_t)(now - mqttSnLastSent) >= MQTTSN_KEEPALIVE * 750)
+    {
+        mqttSnRequest[1] = MQTTSN_PINGREQ;
+        mqttSnStartRequest(ether, 2, MQTTSN_PINGRESP, 0, -1);
+    }
+}
+
+// Sends a held publish once its topic has an id
+void mqttSnReleaseHeld(etherHeader* ether)
+{
+    int8_t index = mqttSnHeldTopic;
+    char* topic;
+    if (index < 0 || mqttSnTopics[index].id == 0)
+        return;
+    mqttSnHeldTopic = -1;
+    topic = mqttSnTopics[index].name;
+    mqttSnPublish(ether, topic, mqttSnHeldData, mqttSnHeldSize);
+}
+
+// A clean session forgets registrations and subscriptions, keep only what the application wants
+void mqttSnStartSession()
+{
+    uint8_t i;
+    for (i = 0; i < MQTTSN_MAX_TOPICS; i++)
+    {
+        if (mqttSnTopics[i].idType == MQTTSN_TOPIC_PREDEFINED)
+            continue;
+        mqttSnTopics[i].id = 0;
+        mqttSnTopics[i].subscribed = false;
+        if (!mqttSnTopics[i].subscribe)
+            mqttSnTopics[i].name[0] = '\0';
+    }
+}
+
+// Handles a datagram from the gateway
+void mqttSnReceive(etherHeader* ether, uint8_t srcIp[4], uint16_t srcPort, uint8_t* data, uint16_t size)
+{
+    uint8_t* message;
+    uint16_t length, topicId, msgId;
+    uint8_t i, type, topicLength;
+    int8_t index;
+    char shortName[2];
+    char* topic;
+    for (i = 0; i < 4; i++)
+        if (srcIp[i] != mqttSnGatewayIp[i])
+            return;
+    if (srcPort != mqttSnGatewayPort || size < 2)
+        return;
+    // one byte length, or 0x01 followed by a two byte length
+    if (data[0] == 0x01)
+    {
+        if (size < 4)
+            return;
+        length = (data[1] << 8) | data[2];
+        message = &data[3];
+        if (length < 4 || length > size)
+            return;
+        length -= 3;
+    }
+    else
+    {
+        length = data[0];
+        message = &data[1];
+        if (length < 2 || length > size)
+            return;
+        length -= 1;
+    }
+    type = message[0];
+
+    if (type == MQTTSN_CONNACK && mqttSnAwaiting == MQTTSN_CONNACK && length >= 2)
+    {
+        mqttSnAwaiting = 0;
+        if (message[1] == 0)
+        {
+            mqttSnCurrentState = mqttSnConnected;
+            mqttSnStartSession();
+        }
+        else
+            mqttSnLost();
+    }
+    else if (type == MQTTSN_REGACK && mqttSnAwaiting == MQTTSN_REGACK && length >= 6)
+    {
+        msgId = (message[3] << 8) | message[4];
+        if (msgId != mqttSnAwaitingMsgId)
+            return;
+        mqttSnAwaiting = 0;
+        if (message[5] == 0)
+        {
+            mqttSnTopics[mqttSnRequestTopic].id = (message[1] << 8) | message[2];
+            mqttSnReleaseHeld(ether);
+        }
+        else
+            mqttSnHeldTopic = -1;
+    }
+    else if (type == MQTTSN_SUBACK && mqttSnAwaiting == MQTTSN_SUBACK && length >= 7)
+    {
+        msgId = (message[4] << 8) | message[5];
+        if (msgId != mqttSnAwaitingMsgId)
+            return;
+        mqttSnAwaiting = 0;
+        // wildcard filters get id 0, the gateway registers each topic before publishing it
+        if (message[6] == 0)
+        {
+            mqttSnTopics[mqttSnRequestTopic].subscribed = true;
+            topicId = (message[2] << 8) | message[3];
+            if (topicId != 0 && mqttSnTopics[mqttSnRequestTopic].idType == MQTTSN_TOPIC_NORMAL)
+                mqttSnTopics[mqttSnRequestTopic].id = topicId;
+        }
+        else
+            mqttSnTopics[mqttSnRequestTopic].subscribe = false;
+    }
+    else if (type == MQTTSN_UNSUBACK && mqttSnAwaiting == MQTTSN_UNSUBACK && length >= 3)
+    {
+        msgId = (message[1] << 8) | message[2];
+        if (msgId != mqttSnAwaitingMsgId)
+            return;
+        mqttSnAwaiting = 0;
+        mqttSnTopics[mqttSnRequestTopic].subscribed = false;
+    }
+    else if (type == MQTTSN_PINGRESP && mqttSnAwaiting == MQTTSN_PINGRESP)
+        mqttSnAwaiting = 0;
+    else if (type == MQTTSN_REGISTER && length >= 6 && mqttSnCurrentState == mqttSnConnected)
+    {
+        // the gateway names a topic it is about to publish to us
+        uint8_t reply[7];
+        index = mqttSnAdd((char*)&message[5], length - 5);
+        reply[0] = 7;
+        reply[1] = MQTTSN_REGACK;
+        reply[2] = message[1];
+        reply[3] = message[2];
+        reply[4] = message[3];
+        reply[5] = message[4];
+        reply[6] = (index < 0) ? 0x01 : 0x00;       // rejected: congestion
+        if (index >= 0)
+            mqttSnTopics[index].id = (message[1] << 8) | message[2];
+        mqttSnSend(ether, reply, 7);
+    }
+    else if (type == MQTTSN_PUBLISH && length >= 6)
+    {
+        topicId = (message[2] << 8) | message[3];
+        if ((message[1] & 0x03) == MQTTSN_TOPIC_SHORT)
+        {
+            shortName[0] = topicId >> 8;
+            shortName[1] = topicId & 0xFF;
+            topic = shortName;
+            topicLength = 2;
+        }
+        else
+        {
+            topic = 0;
+            for (i = 0; i < MQTTSN_MAX_TOPICS && topic == 0; i++)
+                if (mqttSnTopics[i].name[0] != '\0' && mqttSnTopics[i].id == topicId
+                        && mqttSnTopics[i].idType == (message[1] & 0x03))
+                    topic = mqttSnTopics[i].name;
+            if (topic == 0)
+                return;
+            topicLength = mqttSnStringLength(topic);
+        }
+        if (topicTrieDispatch(topic, topicLength, &message[6], length - 6) == 0 && mqttSnUnclaimed != 0)
+            mqttSnUnclaimed(topic, topicLength, &message[6], length - 6);
+    }
+    else if (type == MQTTSN_DISCONNECT)
+        mqttSnLost();
+}
+
+mqttSnState mqttSnGetState()
+{
+    return mqttSnCurrentState;
+}
+
+uint8_t mqttSnGetRegisteredCount()
+{
+    uint8_t i, count = 0;
+    for (i = 0; i < MQTTSN_MAX_TOPICS; i++)
+        if (mqttSnTopics[i].name[0] != '\0' && mqttSnTopics[i].id != 0)
+            count++;
+    return count;
+}
+
+uint32_t mqttSnGetSentCount()
+{
+    return mqttSnSentCount;
+}
+
+uint32_t mqttSnGetSentBytes()
+{
+    return mqttSnSentBytes;
+}
@@ -0,0 +1,82 @@
+// MQTT-SN Library
+// MQTT-SN 1.2 client transport over UDP to a gateway on the LAN
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef MQTTSN_H_
+#define MQTTSN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "eth0.h"
+#include "topic.h"
+
+#define MQTTSN_GATEWAY_PORT  1884
+#define MQTTSN_MAX_TOPICS    8
+#define MQTTSN_TOPIC_LENGTH  40
+// Largest message, kept under 256 so the one byte length form is always used
+#define MQTTSN_MAX_MESSAGE   128
+// Request timeout and attempts before the gateway is considered lost (ms)
+#define MQTTSN_RETRY_TIME    3000
+#define MQTTSN_MAX_RETRIES   3
+// Keep alive duration sent in CONNECT (s)
+#define MQTTSN_KEEPALIVE     60
+
+// Message types
+#define MQTTSN_CONNECT       0x04
+#define MQTTSN_CONNACK       0x05
+#define MQTTSN_REGISTER      0x0A
+#define MQTTSN_REGACK        0x0B
+#define MQTTSN_PUBLISH       0x0C
+#define MQTTSN_SUBSCRIBE     0x12
+#define MQTTSN_SUBACK        0x13
+#define MQTTSN_UNSUBSCRIBE   0x14
+#define MQTTSN_UNSUBACK      0x15
+#define MQTTSN_PINGREQ       0x16
+#define MQTTSN_PINGRESP      0x17
+#define MQTTSN_DISCONNECT    0x18
+
+// Flags
+#define MQTTSN_FLAG_QOS0        0x00
+#define MQTTSN_FLAG_QOS_M1      0x60
+#define MQTTSN_FLAG_CLEAN       0x04
+#define MQTTSN_TOPIC_NORMAL     0x00
+#define MQTTSN_TOPIC_PREDEFINED 0x01
+#define MQTTSN_TOPIC_SHORT      0x02
+
+typedef enum _mqttSnState
+{
+    mqttSnDisconnected = 0,
+    mqttSnConnecting = 1,
+    mqttSnConnected = 2
+} mqttSnState;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initMqttSn(topicHandler unclaimed);
+void mqttSnSetGateway(uint8_t ip[4], uint16_t port);
+bool mqttSnDefineTopic(char* topic, uint16_t id);
+void mqttSnConnect(etherHeader* ether);
+void mqttSnDisconnect(etherHeader* ether);
+bool mqttSnPublish(etherHeader* ether, char* topic, uint8_t* data, uint16_t size);
+bool mqttSnSubscribe(char* topic);
+bool mqttSnUnsubscribe(char* topic);
+void mqttSnService(etherHeader* ether);
+mqttSnState mqttSnGetState();
+uint8_t mqttSnGetRegisteredCount();
+uint32_t mqttSnGetSentCount();
+uint32_t mqttSnGetSentBytes();
+
+#endif
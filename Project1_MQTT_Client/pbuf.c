@@ -0,0 +1,132 @@
+// Packet Buffer Library
+// Fixed pools of frame buffers with reference counts
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// All frame memory is sized at compile time: PBUF_SMALL_COUNT buffers of
+// PBUF_SMALL_SIZE bytes and PBUF_LARGE_COUNT of PBUF_LARGE_SIZE.  Each class
+// keeps a free list, so allocating and freeing are a pop and a push.  A
+// request gets the smallest class it fits in and never falls back to a
+// bigger one, so one class running dry cannot starve the other.  Every
+// holder of a buffer owns a reference: pbufRef() adds one for a queue that
+// keeps a frame its sender has finished with, and the buffer returns to its
+// free list when pbufFree() drops the last one.
+// The pools are only used from scheduler handlers, never from an isr.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pbuf.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint32_t pbufSmallData[PBUF_SMALL_COUNT][(PBUF_SMALL_SIZE + 3) / 4];
+uint32_t pbufLargeData[PBUF_LARGE_COUNT][(PBUF_LARGE_SIZE + 3) / 4];
+pbuf pbufSmallPool[PBUF_SMALL_COUNT];
+pbuf pbufLargePool[PBUF_LARGE_COUNT];
+pbuf* pbufFreeList[pbufClassCount];
+uint8_t pbufFreeCount[pbufClassCount];
+uint8_t pbufLowWater[pbufClassCount];
+uint32_t pbufExhausted[pbufClassCount];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void pbufInitClass(pbufClass poolClass, pbuf* pool, uint32_t* data, uint8_t count, uint16_t size)
+{
+    uint8_t i;
+    pbufFreeList[poolClass] = 0;
+    for (i = count; i > 0; i--)
+    {
+        pool[i-1].payload = (uint8_t*)(data + (uint32_t)(i-1) * ((size + 3) / 4));
+        pool[i-1].size = size;
+        pool[i-1].poolClass = poolClass;
+        pool[i-1].refCount = 0;
+        pool[i-1].next = pbufFreeList[poolClass];
+        pbufFreeList[poolClass] = &pool[i-1];
+    }
+    pbufFreeCount[poolClass] = count;
+    pbufLowWater[poolClass] = count;
+    pbufExhausted[poolClass] = 0;
+}
+
+void initPbuf()
+{
+    pbufInitClass(pbufSmall, pbufSmallPool, &pbufSmallData[0][0], PBUF_SMALL_COUNT, PBUF_SMALL_SIZE);
+    pbufInitClass(pbufLarge, pbufLargePool, &pbufLargeData[0][0], PBUF_LARGE_COUNT, PBUF_LARGE_SIZE);
+}
+
+// Returns a buffer of at least size bytes holding one reference, or 0 if its class is used up
+pbuf* pbufAlloc(uint16_t size)
+{
+    pbufClass poolClass;
+    pbuf* p;
+    if (size <= PBUF_SMALL_SIZE)
+        poolClass = pbufSmall;
+    else if (size <= PBUF_LARGE_SIZE)
+        poolClass = pbufLarge;
+    else
+        return 0;
+    p = pbufFreeList[poolClass];
+    if (p == 0)
+    {
+        pbufExhausted[poolClass]++;
+        return 0;
+    }
+    pbufFreeList[poolClass] = p->next;
+    p->next = 0;
+    p->refCount = 1;
+    pbufFreeCount[poolClass]--;
+    if (pbufFreeCount[poolClass] < pbufLowWater[poolClass])
+        pbufLowWater[poolClass] = pbufFreeCount[poolClass];
+    return p;
+}
+
+// Adds a holder, each one releases the buffer with pbufFree()
+void pbufRef(pbuf* p)
+{
+    p->refCount++;
+}
+
+// Drops a reference, the last one returns the buffer to its pool
+void pbufFree(pbuf* p)
+{
+    if (p == 0 || p->refCount == 0)
+        return;
+    p->refCount--;
+    if (p->refCount == 0)
+    {
+        p->next = pbufFreeList[p->poolClass];
+        pbufFreeList[p->poolClass] = p;
+        pbufFreeCount[p->poolClass]++;
+    }
+}
+
+uint8_t pbufGetFreeCount(pbufClass poolClass)
+{
+    return pbufFreeCount[poolClass];
+}
+
+// Fewest buffers of the class ever left free
+uint8_t pbufGetLowWater(pbufClass poolClass)
+{
+    return pbufLowWater[poolClass];
+}
+
+// Allocations refused because the class was used up
+uint32_t pbufGetExhaustedCount(pbufClass poolClass)
+{
+    return pbufExhausted[poolClass];
+}
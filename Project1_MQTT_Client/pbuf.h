@@ -0,0 +1,65 @@
+// Packet Buffer Library
+// Fixed pools of frame buffers with reference counts
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef PBUF_H_
+#define PBUF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Small buffers hold a peeked header, ARP and bare TCP segments
+#ifndef PBUF_SMALL_SIZE
+#define PBUF_SMALL_SIZE   128
+#endif
+#ifndef PBUF_SMALL_COUNT
+#define PBUF_SMALL_COUNT  8
+#endif
+// Large buffers hold a whole frame: Ether frame header (18) + Max MTU (1500) + CRC (4)
+#ifndef PBUF_LARGE_SIZE
+#define PBUF_LARGE_SIZE   1522
+#endif
+#ifndef PBUF_LARGE_COUNT
+#define PBUF_LARGE_COUNT  3
+#endif
+
+typedef enum _pbufClass
+{
+    pbufSmall,
+    pbufLarge,
+    pbufClassCount
+} pbufClass;
+
+typedef struct _pbuf
+{
+    struct _pbuf* next;         // free list link
+    uint8_t* payload;           // word aligned, so frame headers can be cast onto it
+    uint16_t size;              // capacity of payload
+    uint8_t poolClass;
+    uint8_t refCount;
+} pbuf;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initPbuf();
+pbuf* pbufAlloc(uint16_t size);
+void pbufRef(pbuf* p);
+void pbufFree(pbuf* p);
+uint8_t pbufGetFreeCount(pbufClass poolClass);
+uint8_t pbufGetLowWater(pbufClass poolClass);
+uint32_t pbufGetExhaustedCount(pbufClass poolClass);
+
+#endif
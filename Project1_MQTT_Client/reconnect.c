@@ -0,0 +1,137 @@
+// Reconnect Library
+// Supervises the broker connection and retries with jittered exponential backoff
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// After a CONNECT command the supervisor owns the connection until the next
+// DISCONNECT command.  Each failed attempt doubles the backoff ceiling up to
+// RECONNECT_MAX_DELAY, and the actual delay is drawn between half the
+// ceiling and the ceiling, so devices that lose a broker at the same moment
+// spread their reconnects out instead of arriving together.
+// Latencies are measured from the moment the connection was lost (or the
+// CONNECT command) to CONNACK and to the first publish received.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "reconnect.h"
+#include "timer.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+bool reconnectEnabled = false;
+bool reconnectWaiting = false;
+bool reconnectMeasuring = false;
+uint16_t reconnectAttempts = 0;
+uint32_t reconnectNextTime = 0;
+uint32_t reconnectAttemptTime = 0;
+uint32_t reconnectLossTime = 0;
+uint32_t reconnectConnectLatency = 0;
+uint32_t reconnectMessageLatency = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Called on the CONNECT command
+void reconnectEnable()
+{
+    reconnectEnabled = true;
+    reconnectWaiting = false;
+    reconnectAttempts = 0;
+    reconnectLossTime = getTimerTicks();
+    reconnectMeasuring = true;
+}
+
+// Called on the DISCONNECT command
+void reconnectDisable()
+{
+    reconnectEnabled = false;
+    reconnectWaiting = false;
+}
+
+bool reconnectIsEnabled()
+{
+    return reconnectEnabled;
+}
+
+void reconnectAttemptStarted()
+{
+    reconnectAttemptTime = getTimerTicks();
+}
+
+// True if the handshake in progress has taken too long
+bool reconnectAttemptTimedOut()
+{
+    return getTimerTicks() - reconnectAttemptTime >= RECONNECT_ATTEMPT_TIMEOUT;
+}
+
+// Schedules the next attempt after a lost connection or a failed attempt
+void reconnectConnectionLost()
+{
+    uint32_t ceiling = RECONNECT_MAX_DELAY;
+    if (reconnectAttempts < 16 && ((uint32_t)RECONNECT_BASE_DELAY << reconnectAttempts) < RECONNECT_MAX_DELAY)
+        ceiling = (uint32_t)RECONNECT_BASE_DELAY << reconnectAttempts;
+    if (!reconnectMeasuring)
+    {
+        reconnectLossTime = getTimerTicks();
+        reconnectMeasuring = true;
+    }
+    reconnectAttempts++;
+    reconnectNextTime = getTimerTicks() + ceiling / 2 + random32() % (ceiling / 2 + 1);
+    reconnectWaiting = reconnectEnabled;
+}
+
+// True once when the backoff delay has expired
+bool reconnectPoll()
+{
+    if (!reconnectWaiting || (int32_t)(getTimerTicks() - reconnectNextTime) < 0)
+        return false;
+    reconnectWaiting = false;
+    return true;
+}
+
+// Called on CONNACK
+void reconnectConnected()
+{
+    reconnectAttempts = 0;
+    reconnectWaiting = false;
+    if (reconnectMeasuring)
+        reconnectConnectLatency = getTimerTicks() - reconnectLossTime;
+}
+
+// Called for each publish received, the first one closes the measurement
+void reconnectNoteMessage()
+{
+    if (reconnectMeasuring)
+    {
+        reconnectMessageLatency = getTimerTicks() - reconnectLossTime;
+        reconnectMeasuring = false;
+    }
+}
+
+uint16_t reconnectGetAttempts()
+{
+    return reconnectAttempts;
+}
+
+uint32_t reconnectGetConnectLatency()
+{
+    return reconnectConnectLatency;
+}
+
+uint32_t reconnectGetMessageLatency()
+{
+    return reconnectMessageLatency;
+}
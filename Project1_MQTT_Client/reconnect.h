@@ -0,0 +1,44 @@
+// Reconnect Library
+// Supervises the broker connection and retries with jittered exponential backoff
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef RECONNECT_H_
+#define RECONNECT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Backoff limits and how long one ARP/SYN/CONNECT attempt may take (ms)
+#define RECONNECT_BASE_DELAY      1000
+#define RECONNECT_MAX_DELAY       64000
+#define RECONNECT_ATTEMPT_TIMEOUT 3000
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void reconnectEnable();
+void reconnectDisable();
+bool reconnectIsEnabled();
+void reconnectAttemptStarted();
+bool reconnectAttemptTimedOut();
+void reconnectConnectionLost();
+bool reconnectPoll();
+void reconnectConnected();
+void reconnectNoteMessage();
+uint16_t reconnectGetAttempts();
+uint32_t reconnectGetConnectLatency();
+uint32_t reconnectGetMessageLatency();
+
+#endif
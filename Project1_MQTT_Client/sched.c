@@ -0,0 +1,148 @@
+// Scheduler Library
+// Run-to-completion event dispatch for the main loop
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// An event is a pending flag; posting it from an isr, a timer callback or
+// a handler is a single byte store, and posting an event that is already
+// pending does nothing.  schedRun() always dispatches the highest priority
+// pending event, runs its handler to completion, then looks again, so a
+// handler that finds more work than it wants to do at once posts itself.
+// With nothing pending the idle handler runs and the idle manager puts the
+// core to sleep until the next interrupt.  The wait from first post to
+// dispatch and the handler run time are kept per event, in microseconds,
+// for EVENTS.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sched.h"
+#include "timer.h"
+#include "idle.h"
+#include "cpu.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+volatile uint8_t schedPending[schedEventCount];
+volatile uint32_t schedPostedAt[schedEventCount];
+schedHandler schedHandlers[schedEventCount];
+schedHandler schedIdleHandler = 0;
+uint32_t schedDispatchCount[schedEventCount];
+uint32_t schedMaxWait[schedEventCount];
+uint32_t schedMaxRun[schedEventCount];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initSched()
+{
+    uint8_t i;
+    for (i = 0; i < schedEventCount; i++)
+    {
+        schedPending[i] = 0;
+        schedHandlers[i] = 0;
+        schedDispatchCount[i] = 0;
+        schedMaxWait[i] = 0;
+        schedMaxRun[i] = 0;
+    }
+    schedIdleHandler = 0;
+}
+
+void schedSetHandler(schedEvent event, schedHandler handler)
+{
+    schedHandlers[event] = handler;
+}
+
+// Runs each time the queue empties, before the core sleeps
+void schedSetIdleHandler(schedHandler handler)
+{
+    schedIdleHandler = handler;
+}
+
+// Safe to call from interrupt context
+void schedPost(schedEvent event)
+{
+    if (!schedPending[event])
+    {
+        schedPostedAt[event] = getTimerMicroseconds();
+        schedPending[event] = 1;
+    }
+}
+
+bool schedIsPending()
+{
+    uint8_t i;
+    for (i = 0; i < schedEventCount; i++)
+        if (schedPending[i])
+            return true;
+    return false;
+}
+
+// Sleeps until an interrupt, unless one posted an event since the queue was checked
+// WFI still wakes on an interrupt masked by PRIMASK, which then runs once unmasked
+void schedSleep()
+{
+    disableInterrupts();
+    if (!schedIsPending())
+        idleEnter();
+    enableInterrupts();
+}
+
+// Dispatches events forever
+void schedRun()
+{
+    uint8_t i;
+    uint32_t start, time;
+    while (true)
+    {
+        for (i = 0; i < schedEventCount && !schedPending[i]; i++);
+        if (i == schedEventCount)
+        {
+            if (schedIdleHandler != 0)
+                schedIdleHandler();
+            schedSleep();
+            continue;
+        }
+        schedPending[i] = 0;
+        start = getTimerMicroseconds();
+        time = start - schedPostedAt[i];
+        if (time > schedMaxWait[i])
+            schedMaxWait[i] = time;
+        schedDispatchCount[i]++;
+        idleNoteDispatch(start);
+        if (schedHandlers[i] != 0)
+            schedHandlers[i]();
+        time = getTimerMicroseconds() - start;
+        if (time > schedMaxRun[i])
+            schedMaxRun[i] = time;
+    }
+}
+
+uint32_t schedGetDispatchCount(schedEvent event)
+{
+    return schedDispatchCount[event];
+}
+
+// Longest time the event waited between being posted and its handler starting
+uint32_t schedGetMaxWait(schedEvent event)
+{
+    return schedMaxWait[event];
+}
+
+// Longest time its handler ran
+uint32_t schedGetMaxRun(schedEvent event)
+{
+    return schedMaxRun[event];
+}
@@ -0,0 +1,49 @@
+// Scheduler Library
+// Run-to-completion event dispatch for the main loop
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Events in priority order, the lowest pending one is dispatched first
+typedef enum _schedEvent
+{
+    schedNetwork,               // ENC28J60 INT: frames received or a transmission finished
+    schedTxDone,                // the last frame has left the wire
+    schedMqtt,                  // MQTT state machine has work
+    schedTimer,                 // periodic services are due
+    schedConsole,               // UART0 received characters
+    schedEventCount
+} schedEvent;
+
+typedef void (*schedHandler)();
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initSched();
+void schedSetHandler(schedEvent event, schedHandler handler);
+void schedSetIdleHandler(schedHandler handler);
+void schedPost(schedEvent event);
+bool schedIsPending();
+void schedRun();
+uint32_t schedGetDispatchCount(schedEvent event);
+uint32_t schedGetMaxWait(schedEvent event);
+uint32_t schedGetMaxRun(schedEvent event);
+
+#endif
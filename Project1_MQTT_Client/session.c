@@ -0,0 +1,137 @@
+// Session Library
+// Mqtt client identity and the subscriptions a session should hold
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// A persistent session (clean session = 0) only helps if the broker sees the
+// same client ID every time, so the ID is derived from the MAC address rather
+// than shared by every device.  The subscription list is kept so that a
+// CONNACK without session present can be followed by a re-SUBSCRIBE.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "session.h"
+#include "console.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+char sessionClientId[16];
+bool sessionPersistent = true;
+bool sessionPresent = false;
+char sessionTopics[SESSION_MAX_TOPICS][SESSION_TOPIC_LENGTH];
+uint8_t sessionQos[SESSION_MAX_TOPICS];
+uint8_t sessionTopicCount = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Builds the client ID "rbv" followed by the MAC address in hex
+void initSession(uint8_t mac[6])
+{
+    char hex[] = "0123456789abcdef";
+    uint8_t i;
+    sessionClientId[0] = 'r';
+    sessionClientId[1] = 'b';
+    sessionClientId[2] = 'v';
+    for (i = 0; i < 6; i++)
+    {
+        sessionClientId[3 + i*2] = hex[mac[i] >> 4];
+        sessionClientId[4 + i*2] = hex[mac[i] & 0xF];
+    }
+    sessionClientId[15] = '\0';
+    sessionTopicCount = 0;
+    sessionPresent = false;
+}
+
+char* sessionGetClientId()
+{
+    return sessionClientId;
+}
+
+// Persistent sessions send clean session = 0 so the broker keeps subscriptions
+void sessionSetPersistent(bool persistent)
+{
+    sessionPersistent = persistent;
+}
+
+bool sessionIsPersistent()
+{
+    return sessionPersistent;
+}
+
+// Session present flag from the last CONNACK
+void sessionSetPresent(bool present)
+{
+    sessionPresent = present;
+}
+
+bool sessionIsPresent()
+{
+    return sessionPresent;
+}
+
+int8_t sessionFind(char* topic)
+{
+    uint8_t i;
+    for (i = 0; i < sessionTopicCount; i++)
+        if (stringCompare(sessionTopics[i], topic))
+            return i;
+    return -1;
+}
+
+// Remembers a subscription, updating the QoS if it is already known
+bool sessionAddSubscription(char* topic, uint8_t qos)
+{
+    int8_t index = sessionFind(topic);
+    uint8_t i;
+    if (index < 0)
+    {
+        if (sessionTopicCount == SESSION_MAX_TOPICS || strLen(topic) >= SESSION_TOPIC_LENGTH)
+            return false;
+        index = sessionTopicCount++;
+        for (i = 0; topic[i] != '\0'; i++)
+            sessionTopics[index][i] = topic[i];
+        sessionTopics[index][i] = '\0';
+    }
+    sessionQos[index] = qos;
+    return true;
+}
+
+bool sessionRemoveSubscription(char* topic)
+{
+    int8_t index = sessionFind(topic);
+    uint8_t i;
+    if (index < 0)
+        return false;
+    sessionTopicCount--;
+    for (i = 0; sessionTopics[sessionTopicCount][i] != '\0'; i++)
+        sessionTopics[index][i] = sessionTopics[sessionTopicCount][i];
+    sessionTopics[index][i] = '\0';
+    sessionQos[index] = sessionQos[sessionTopicCount];
+    return true;
+}
+
+// Fills topics and qos with the remembered subscriptions, returns the count
+uint8_t sessionGetSubscriptions(char* topics[], uint8_t qos[], uint8_t maxTopics)
+{
+    uint8_t i;
+    for (i = 0; i < sessionTopicCount && i < maxTopics; i++)
+    {
+        topics[i] = sessionTopics[i];
+        qos[i] = sessionQos[i];
+    }
+    return i;
+}
@@ -0,0 +1,42 @@
+// Session Library
+// Mqtt client identity and the subscriptions a session should hold
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Enough for the 40 device topics resubscribed after a reconnect, with room to spare
+#define SESSION_MAX_TOPICS   48
+#define SESSION_TOPIC_LENGTH 40
+// Mqtt 5.0 Session Expiry Interval requested for persistent sessions (seconds)
+#define SESSION_EXPIRY       3600
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initSession(uint8_t mac[6]);
+char* sessionGetClientId();
+void sessionSetPersistent(bool persistent);
+bool sessionIsPersistent();
+void sessionSetPresent(bool present);
+bool sessionIsPresent();
+bool sessionAddSubscription(char* topic, uint8_t qos);
+bool sessionRemoveSubscription(char* topic);
+uint8_t sessionGetSubscriptions(char* topics[], uint8_t qos[], uint8_t maxTopics);
+
+#endif
@@ -0,0 +1,332 @@
+// Spool Library
+// Store-and-forward queue for MQTT publishes made while the broker is offline
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// On-chip EEPROM blocks 16-31 (word addresses 0x0100-0x01FF)
+
+// The spool is a log-structured ring of records in EEPROM:
+//   word 0:  header  [31:24] magic, [23:16] payload length, [15:0] sequence
+//   word 1:  check   checksum over header (without magic) and payload words
+//   word 2+: payload topic and data strings, each null terminated
+// Records are appended at the head, so every word is written once per lap
+// of the ring (wear levelling).  The header is written last and commits the
+// record; a record the broker has acknowledged is retired by rewriting its
+// magic.  Both kinds of write are made by spoolService(), retires first, so
+// nothing on the send path waits on the EEPROM and a retired record is
+// marked before a new record can be written over it.
+// On boot, the ring is scanned and the head, tail and sequence are recovered
+// from the headers alone, so a reset at any point loses only the records
+// still staged in RAM (or replays the record being retired).
+// All storage goes through readEeprom() and writeEeprom(), so crash
+// recovery is exercised on a host by host/test/spooltest.c over host/eeprom.c.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "spool.h"
+#include "eeprom.h"
+#include "console.h"
+
+#define SPOOL_MAGIC_LIVE        0xA5
+#define SPOOL_MAGIC_SENT        0x5A
+#define SPOOL_HEADER_WORDS      2
+#define SPOOL_MAX_WORDS         (SPOOL_HEADER_WORDS + (SPOOL_MAX_MESSAGE + 3) / 4)
+#define SPOOL_MAX_RECORDS       64
+#define SPOOL_STAGE_RECORDS     4
+#define SPOOL_WORDS_PER_SERVICE 4
+
+typedef struct _spoolStage
+{
+    uint16_t start;
+    uint8_t  size;
+    uint8_t  written;
+    uint32_t words[SPOOL_MAX_WORDS];
+} spoolStage;
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint16_t spoolHead = 0;
+uint16_t spoolNextSeq = 0;
+
+// Committed records still to be sent, oldest first
+uint8_t  spoolRecordStart[SPOOL_MAX_RECORDS];
+uint8_t  spoolRecordSize[SPOOL_MAX_RECORDS];
+uint8_t  spoolRecordFirst = 0;
+uint8_t  spoolRecordCount = 0;
+
+// Records sent but not yet marked as sent in EEPROM, oldest first
+uint8_t  spoolRetireStart[SPOOL_MAX_RECORDS];
+uint8_t  spoolRetireFirst = 0;
+uint8_t  spoolRetireCount = 0;
+
+// Records accepted but not yet fully written to EEPROM
+spoolStage spoolStaged[SPOOL_STAGE_RECORDS];
+uint8_t  spoolStageFirst = 0;
+uint8_t  spoolStageCount = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint16_t spoolAddress(uint16_t offset)
+{
+    return SPOOL_EEPROM_START + (offset % SPOOL_EEPROM_WORDS);
+}
+
+uint32_t spoolMix(uint32_t sum, uint32_t word)
+{
+    return ((sum << 5) | (sum >> 27)) ^ word;
+}
+
+uint8_t spoolRecordWords(uint8_t length)
+{
+    return SPOOL_HEADER_WORDS + (length + 3) / 4;
+}
+
+// Returns number of ring words used by committed and staged records
+uint16_t spoolUsedWords()
+{
+    uint16_t used = 0;
+    uint8_t i;
+    for (i = 0; i < spoolRecordCount; i++)
+        used += spoolRecordSize[(spoolRecordFirst + i) % SPOOL_MAX_RECORDS];
+    for (i = 0; i < spoolStageCount; i++)
+        used += spoolStaged[(spoolStageFirst + i) % SPOOL_STAGE_RECORDS].size;
+    return used;
+}
+
+// Validates the record at offset, returning its header or 0 if invalid
+uint32_t spoolReadHeader(uint16_t offset)
+{
+    uint32_t header = readEeprom(spoolAddress(offset));
+    uint8_t magic = header >> 24;
+    uint8_t length = (header >> 16) & 0xFF;
+    uint8_t i, words;
+    uint32_t sum;
+    if ((magic != SPOOL_MAGIC_LIVE && magic != SPOOL_MAGIC_SENT) || length == 0 || length > SPOOL_MAX_MESSAGE)
+        return 0;
+    words = spoolRecordWords(length);
+    sum = spoolMix(0, header & 0x00FFFFFF);
+    for (i = SPOOL_HEADER_WORDS; i < words; i++)
+        sum = spoolMix(sum, readEeprom(spoolAddress(offset + i)));
+    if (sum != readEeprom(spoolAddress(offset + 1)))
+        return 0;
+    return header;
+}
+
+// Rebuilds the ring state from the headers stored in EEPROM
+void initSpool()
+{
+    uint16_t offset, newestSeq = 0, age;
+    uint16_t ageOf[SPOOL_MAX_RECORDS];
+    uint8_t i, size;
+    uint32_t header;
+    bool found = false;
+
+    spoolHead = 0;
+    spoolNextSeq = 0;
+    spoolRecordFirst = 0;
+    spoolRecordCount = 0;
+    spoolStageFirst = 0;
+    spoolStageCount = 0;
+    spoolRetireFirst = 0;
+    spoolRetireCount = 0;
+
+    // find newest record (sent or not) to recover the head and sequence
+    for (offset = 0; offset < SPOOL_EEPROM_WORDS; offset++)
+    {
+        header = spoolReadHeader(offset);
+        if (header != 0 && (!found || (int16_t)((header & 0xFFFF) - newestSeq) > 0))
+        {
+            found = true;
+            newestSeq = header & 0xFFFF;
+            spoolHead = (offset + spoolRecordWords((header >> 16) & 0xFF)) % SPOOL_EEPROM_WORDS;
+        }
+    }
+    if (!found)
+        return;
+    spoolNextSeq = newestSeq + 1;
+
+    // collect unsent records ordered oldest first
+    for (offset = 0; offset < SPOOL_EEPROM_WORDS; offset++)
+    {
+        header = spoolReadHeader(offset);
+        if (header == 0 || (header >> 24) != SPOOL_MAGIC_LIVE || spoolRecordCount == SPOOL_MAX_RECORDS)
+            continue;
+        age = newestSeq - (header & 0xFFFF);
+        if (age > 0xFF)
+            continue;
+        size = spoolRecordWords((header >> 16) & 0xFF);
+        i = spoolRecordCount++;
+        while (i > 0 && ageOf[i-1] < age)
+        {
+            ageOf[i] = ageOf[i-1];
+            spoolRecordStart[i] = spoolRecordStart[i-1];
+            spoolRecordSize[i] = spoolRecordSize[i-1];
+            i--;
+        }
+        ageOf[i] = age;
+        spoolRecordStart[i] = offset;
+        spoolRecordSize[i] = size;
+    }
+}
+
+// Accepts a message into RAM staging; it is written to EEPROM by spoolService()
+// Returns false if the message is too large or the spool is full
+bool spoolPush(char* topic, char* data)
+{
+    uint16_t topicLength = strLen(topic) + 1;
+    uint16_t length = topicLength + strLen(data) + 1;
+    uint8_t i, size;
+    uint8_t byte;
+    uint32_t sum;
+    spoolStage* stage;
+
+    if (length > SPOOL_MAX_MESSAGE || spoolStageCount == SPOOL_STAGE_RECORDS
+            || spoolRecordCount + spoolStageCount >= SPOOL_MAX_RECORDS)
+        return false;
+    size = spoolRecordWords(length);
+    if (spoolUsedWords() + size > SPOOL_EEPROM_WORDS)
+        return false;
+
+    stage = &spoolStaged[(spoolStageFirst + spoolStageCount) % SPOOL_STAGE_RECORDS];
+    stage->start = spoolHead;
+    stage->size = size;
+    stage->written = 0;
+
+    // pack topic and data into little endian words
+    for (i = SPOOL_HEADER_WORDS; i < size; i++)
+        stage->words[i] = 0;
+    for (i = 0; i < length; i++)
+    {
+        if (i < topicLength)
+            byte = topic[i];
+        else
+            byte = data[i - topicLength];
+        stage->words[SPOOL_HEADER_WORDS + i / 4] |= (uint32_t)byte << ((i % 4) * 8);
+    }
+
+    stage->words[0] = ((uint32_t)SPOOL_MAGIC_LIVE << 24) | ((uint32_t)length << 16) | spoolNextSeq;
+    sum = spoolMix(0, stage->words[0] & 0x00FFFFFF);
+    for (i = SPOOL_HEADER_WORDS; i < size; i++)
+        sum = spoolMix(sum, stage->words[i]);
+    stage->words[1] = sum;
+
+    spoolNextSeq++;
+    spoolHead = (spoolHead + size) % SPOOL_EEPROM_WORDS;
+    spoolStageCount++;
+    return true;
+}
+
+// Writes a few words to EEPROM per call so the network loop is not stalled
+// Retires go first, then staged records: payload, checksum, and the header commits
+void spoolService()
+{
+    uint8_t budget = SPOOL_WORDS_PER_SERVICE;
+    uint8_t index, last;
+    uint16_t address;
+    spoolStage* stage;
+
+    while (budget > 0 && spoolRetireCount > 0)
+    {
+        address = spoolAddress(spoolRetireStart[spoolRetireFirst]);
+        writeEeprom(address, (readEeprom(address) & 0x00FFFFFF) | ((uint32_t)SPOOL_MAGIC_SENT << 24));
+        spoolRetireFirst = (spoolRetireFirst + 1) % SPOOL_MAX_RECORDS;
+        spoolRetireCount--;
+        budget--;
+    }
+    while (budget > 0 && spoolStageCount > 0)
+    {
+        stage = &spoolStaged[spoolStageFirst];
+        if (stage->written < stage->size - SPOOL_HEADER_WORDS)
+            index = SPOOL_HEADER_WORDS + stage->written;
+        else
+            index = stage->size - 1 - stage->written;
+        writeEeprom(spoolAddress(stage->start + index), stage->words[index]);
+        stage->written++;
+        budget--;
+        if (stage->written == stage->size)
+        {
+            last = (spoolRecordFirst + spoolRecordCount) % SPOOL_MAX_RECORDS;
+            spoolRecordStart[last] = stage->start;
+            spoolRecordSize[last] = stage->size;
+            spoolRecordCount++;
+            spoolStageFirst = (spoolStageFirst + 1) % SPOOL_STAGE_RECORDS;
+            spoolStageCount--;
+        }
+    }
+}
+
+bool spoolIsEmpty()
+{
+    return spoolRecordCount == 0 && spoolStageCount == 0;
+}
+
+uint8_t spoolGetCount()
+{
+    return spoolRecordCount + spoolStageCount;
+}
+
+uint16_t spoolGetFreeWords()
+{
+    return SPOOL_EEPROM_WORDS - spoolUsedWords();
+}
+
+// Copies the oldest committed message into topic and data (each maxSize bytes)
+// Returns false if no committed message is available
+bool spoolGetOldest(char* topic, char* data, uint8_t maxSize)
+{
+    uint16_t start;
+    uint8_t length, i, t = 0, d = 0;
+    uint32_t word = 0;
+    char c;
+    bool inTopic = true;
+
+    if (spoolRecordCount == 0)
+        return false;
+    start = spoolRecordStart[spoolRecordFirst];
+    length = (readEeprom(spoolAddress(start)) >> 16) & 0xFF;
+    for (i = 0; i < length; i++)
+    {
+        if (i % 4 == 0)
+            word = readEeprom(spoolAddress(start + SPOOL_HEADER_WORDS + i / 4));
+        c = (word >> ((i % 4) * 8)) & 0xFF;
+        if (inTopic)
+        {
+            if (t < maxSize - 1)
+                topic[t++] = c;
+            if (c == '\0')
+                inTopic = false;
+        }
+        else if (d < maxSize - 1)
+            data[d++] = c;
+    }
+    topic[t] = '\0';
+    data[d] = '\0';
+    return true;
+}
+
+// Retires the oldest committed message once it has been sent
+// Its header is rewritten by spoolService(), a reset before then sends it again
+void spoolRemoveOldest()
+{
+    if (spoolRecordCount == 0)
+        return;
+    spoolRetireStart[(spoolRetireFirst + spoolRetireCount) % SPOOL_MAX_RECORDS] = spoolRecordStart[spoolRecordFirst];
+    spoolRetireCount++;
+    spoolRecordFirst = (spoolRecordFirst + 1) % SPOOL_MAX_RECORDS;
+    spoolRecordCount--;
+}
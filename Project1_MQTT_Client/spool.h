@@ -0,0 +1,45 @@
+// Spool Library
+// Store-and-forward queue for MQTT publishes made while the broker is offline
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// On-chip EEPROM blocks 16-31 (word addresses 0x0100-0x01FF)
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SPOOL_H_
+#define SPOOL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// EEPROM region reserved for the spool (word addresses)
+#define SPOOL_EEPROM_START      0x0100
+#define SPOOL_EEPROM_WORDS      256
+
+// Largest topic + data (including both terminators) that can be spooled
+#define SPOOL_MAX_MESSAGE       82
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initSpool();
+bool spoolPush(char* topic, char* data);
+void spoolService();
+bool spoolIsEmpty();
+uint8_t spoolGetCount();
+uint16_t spoolGetFreeWords();
+bool spoolGetOldest(char* topic, char* data, uint8_t maxSize);
+void spoolRemoveOldest();
+
+#endif
@@ -0,0 +1,170 @@
+// TCP Library
+// Connection table holding the control block of each open TCP connection
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Each socket in the table is the control block of one connection: its
+// 4-tuple, the next sequence number to send, the oldest one the peer has
+// not acknowledged, the next one expected from the peer and the end of the
+// peer's receive window.  etherSendTcp() builds segments from a socket and
+// moves the next sequence number past what it sends, so it only ever moves
+// forward, and received acknowledgements only move the unacknowledged mark.
+// Received segments are matched back to their socket by 4-tuple with
+// tcpFind().  Nothing sent is kept for retransmission, so data that would
+// overrun the window is held back by the caller instead, see tcpCanSend(),
+// and a caller that must not lose data waits for tcpIsAcknowledged().  The
+// table is small, so the lookup is a linear scan.  The sequence numbers
+// sent and received are kept in network order, as they appear in the
+// header, the unacknowledged mark and window end in host order.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tcp.h"
+#include "eth0.h"
+#include "trace.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+socket tcpSockets[TCP_MAX_CONNECTIONS];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initTcp()
+{
+    uint8_t i;
+    for (i = 0; i < TCP_MAX_CONNECTIONS; i++)
+        tcpSockets[i].state = tcpClosed;
+}
+
+// Claims a socket for a connection from sourcePort to destIp:destPort
+// Returns 0 if the table is full
+socket* tcpOpen(uint8_t destIp[4], uint16_t destPort, uint16_t sourcePort)
+{
+    uint8_t i;
+    socket* s = 0;
+    for (i = 0; i < TCP_MAX_CONNECTIONS && s == 0; i++)
+        if (tcpSockets[i].state == tcpClosed)
+            s = &tcpSockets[i];
+    if (s == 0)
+        return 0;
+    etherGetMacAddress(s->sourceAddress);
+    etherGetIpAddress(s->sourceIp);
+    for (i = 0; i < 6; i++)
+        s->destAddress[i] = 0;                  // filled in from the ARP cache when sent
+    for (i = 0; i < 4; i++)
+        s->destIp[i] = destIp[i];
+    s->sourcePort = htons(sourcePort);
+    s->destPort = htons(destPort);
+    s->sequenceNumber = 0;
+    s->acknowledgementNumber = 0;
+    s->unacknowledged = 0;
+    s->windowEnd = 0;
+    s->state = tcpSynSent;
+    TRACE(traceTcpOpen, sourcePort, 0, 0);
+    return s;
+}
+
+// Returns the socket to the table
+void tcpClose(socket* s)
+{
+    if (s != 0 && s->state != tcpClosed)
+    {
+        TRACE(traceTcpClose, htons(s->sourcePort), s->state, 0);
+        s->state = tcpClosed;
+    }
+}
+
+// Returns the socket a received segment belongs to, or 0
+socket* tcpFind(etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
+    socket* s;
+    uint8_t i;
+    for (i = 0; i < TCP_MAX_CONNECTIONS; i++)
+    {
+        s = &tcpSockets[i];
+        if (s->state != tcpClosed && tcp->destPort == s->sourcePort && tcp->sourcePort == s->destPort
+                && ip->sourceIp[0] == s->destIp[0] && ip->sourceIp[1] == s->destIp[1]
+                && ip->sourceIp[2] == s->destIp[2] && ip->sourceIp[3] == s->destIp[3])
+            return s;
+    }
+    return 0;
+}
+
+// Takes the peer's acknowledgement and window from a received segment
+// An acknowledgement older than the last one, or of data not yet sent, is ignored,
+// and so is one on a reset, which aborts the connection rather than confirming data
+void tcpAcceptAck(socket* s, etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
+    uint16_t flags = htons(tcp->offsetFields);
+    uint32_t ack = htonl(tcp->acknowledgementNumber);
+    if ((flags & TCP_ACK) == 0 || (flags & TCP_RESET) != 0)
+        return;
+    if ((int32_t)(ack - s->unacknowledged) < 0 || (int32_t)(ack - htonl(s->sequenceNumber)) > 0)
+        return;
+    s->unacknowledged = ack;
+    s->windowEnd = ack + htons(tcp->windowSize);
+}
+
+// Takes the peer's acknowledgement and window from a received segment and
+// acknowledges consumed bytes of it (1 for a SYN or FIN)
+void tcpAcceptSegment(socket* s, etherHeader* ether, uint16_t consumed)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    tcpHeader *tcp = (tcpHeader*)((uint8_t*)ip + ipHeaderLength);
+    uint16_t flags = htons(tcp->offsetFields) & 0x0FFF;
+    tcpAcceptAck(s, ether);
+    s->acknowledgementNumber = htonl(htonl(tcp->sequenceNumber) + consumed);
+    TRACE(traceTcpAccept, flags, htonl(tcp->sequenceNumber), consumed);
+    if (flags == TCP_SYNACK)
+        s->state = tcpEstablished;
+}
+
+// Returns true if length more bytes fit in the peer's receive window
+bool tcpCanSend(socket* s, uint16_t length)
+{
+    if (s == 0 || s->state != tcpEstablished)
+        return false;
+    return (int32_t)(s->windowEnd - (htonl(s->sequenceNumber) + length)) >= 0;
+}
+
+// Returns the sequence number just past everything sent so far
+uint32_t tcpGetSendNext(socket* s)
+{
+    return htonl(s->sequenceNumber);
+}
+
+// Returns true if the peer has acknowledged everything before sequence
+bool tcpIsAcknowledged(socket* s, uint32_t sequence)
+{
+    return s != 0 && (int32_t)(s->unacknowledged - sequence) >= 0;
+}
+
+uint8_t tcpGetOpenCount()
+{
+    uint8_t i, count = 0;
+    for (i = 0; i < TCP_MAX_CONNECTIONS; i++)
+        if (tcpSockets[i].state != tcpClosed)
+            count++;
+    return count;
+}
@@ -0,0 +1,40 @@
+// TCP Library
+// Connection table holding the control block of each open TCP connection
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef TCP_H_
+#define TCP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "eth0.h"
+
+#define TCP_MAX_CONNECTIONS 4
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initTcp();
+socket* tcpOpen(uint8_t destIp[4], uint16_t destPort, uint16_t sourcePort);
+void tcpClose(socket* s);
+socket* tcpFind(etherHeader* ether);
+void tcpAcceptAck(socket* s, etherHeader* ether);
+void tcpAcceptSegment(socket* s, etherHeader* ether, uint16_t consumed);
+bool tcpCanSend(socket* s, uint16_t length);
+uint32_t tcpGetSendNext(socket* s);
+bool tcpIsAcknowledged(socket* s, uint32_t sequence);
+uint8_t tcpGetOpenCount();
+
+#endif
@@ -0,0 +1,185 @@
+// Timer Service Library
+// Software timers and a millisecond time base
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// 1 ms tick from timer4.c, which calls advanceTimers()
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "timer4.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+_callback fn[NUM_TIMERS];
+uint32_t period[NUM_TIMERS];
+uint32_t ticks[NUM_TIMERS];
+bool reload[NUM_TIMERS];
+volatile uint32_t timerTicks = 0;
+uint32_t randomState = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Clears the software timers and starts the 1 ms tick
+void initTimer()
+{
+    uint8_t i;
+
+    for (i = 0; i < NUM_TIMERS; i++)
+    {
+        period[i] = 0;
+        ticks[i] = 0;
+        fn[i] = 0;
+        reload[i] = false;
+    }
+    initTimer4();
+}
+
+bool startTimer(_callback callback, uint32_t milliseconds, bool periodic)
+{
+    uint8_t i = 0;
+    bool found = false;
+    while (i < NUM_TIMERS && !found)
+    {
+        found = fn[i] == 0;
+        if (found)
+        {
+            period[i] = milliseconds;
+            ticks[i] = milliseconds;
+            reload[i] = periodic;
+            fn[i] = callback;
+        }
+        i++;
+    }
+    return found;
+}
+
+bool startOneshotTimer(_callback callback, uint32_t milliseconds)
+{
+    return startTimer(callback, milliseconds, false);
+}
+
+bool startPeriodicTimer(_callback callback, uint32_t milliseconds)
+{
+    return startTimer(callback, milliseconds, true);
+}
+
+bool stopTimer(_callback callback)
+{
+    uint8_t i = 0;
+    bool found = false;
+    while (i < NUM_TIMERS && !found)
+    {
+        found = fn[i] == callback;
+        if (found)
+        {
+            ticks[i] = 0;
+            fn[i] = 0;
+        }
+        i++;
+    }
+    return found;
+}
+
+bool restartTimer(_callback callback)
+{
+    uint8_t i = 0;
+    bool found = false;
+    while (i < NUM_TIMERS && !found)
+    {
+        found = fn[i] == callback;
+        if (found)
+            ticks[i] = period[i];
+        i++;
+    }
+    return found;
+}
+
+// Milliseconds since initTimer(), wraps after 49 days
+uint32_t getTimerTicks()
+{
+    return timerTicks;
+}
+
+// Counts elapsed milliseconds and runs the callbacks that fall due
+void advanceTimers(uint32_t milliseconds)
+{
+    uint8_t i;
+    _callback callback;
+    timerTicks += milliseconds;
+    for (i = 0; i < NUM_TIMERS; i++)
+    {
+        if (ticks[i] != 0)
+        {
+            if (ticks[i] > milliseconds)
+                ticks[i] -= milliseconds;
+            else
+            {
+                callback = fn[i];
+                if (reload[i])
+                    ticks[i] = period[i];
+                else
+                {
+                    ticks[i] = 0;
+                    fn[i] = 0;
+                }
+                (*callback)();
+            }
+        }
+    }
+}
+
+// Milliseconds until the next software timer falls due, TICKLESS_MAX_MS if none is running
+uint32_t getTimerIdleTime()
+{
+    uint8_t i;
+    uint32_t idle = TICKLESS_MAX_MS;
+    for (i = 0; i < NUM_TIMERS; i++)
+        if (ticks[i] != 0 && ticks[i] < idle)
+            idle = ticks[i];
+    return idle;
+}
+
+// Seeds random32(), the seed alone is the same on every boot so stir in
+// noise with stirRandom() before numbers are drawn
+void seedRandom(uint32_t seed)
+{
+    randomState = seed ^ 0x9E3779B9;
+    if (randomState == 0)
+        randomState = 1;
+}
+
+// Mixes value into the random32() state, for sensor noise, timer captures
+// of asynchronous events and the per-board MAC address
+void stirRandom(uint32_t value)
+{
+    randomState = ((randomState << 5) | (randomState >> 27)) ^ value;
+    random32();
+}
+
+// Cheap pseudo random number (xorshift32)
+uint32_t random32()
+{
+    if (randomState == 0)
+        seedRandom(timerTicks);
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
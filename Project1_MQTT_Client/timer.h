@@ -0,0 +1,55 @@
+// Timer Service Library
+// Software timers and a millisecond time base on Timer 4A
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Timer 4A periodic interrupt at 1 kHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NUM_TIMERS 10
+
+// Longest stretched tick, well inside the 107 s a 32-bit count lasts at 40 MHz
+#define TICKLESS_MAX_MS 60000
+
+// Callbacks run in interrupt context, so keep them short (set a flag)
+typedef void (*_callback)();
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initTimer();
+bool startOneshotTimer(_callback callback, uint32_t milliseconds);
+bool startPeriodicTimer(_callback callback, uint32_t milliseconds);
+bool stopTimer(_callback callback);
+bool restartTimer(_callback callback);
+uint32_t getTimerTicks();
+void advanceTimers(uint32_t milliseconds);
+uint32_t getTimerIdleTime();
+void seedRandom(uint32_t seed);
+void stirRandom(uint32_t value);
+uint32_t random32();
+
+// Time base hardware, in timer4.c
+uint32_t getTimerMicroseconds();
+void tickIsr();
+bool startTickless(uint32_t milliseconds);
+void stopTickless();
+
+#endif
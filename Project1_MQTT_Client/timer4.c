@@ -0,0 +1,130 @@
+// Timer 4A Library
+// 1 ms tick and sub-millisecond count for the Timer Service Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Timer 4A periodic interrupt at 1 kHz
+
+// While the core idles the tick can be stretched to the next software timer
+// deadline (tickless), so an idle board wakes for timers that are due rather
+// than 1000 times a second.  startTickless() reloads Timer 4A so it times out
+// at the deadline, and stopTickless() works out how many milliseconds really
+// passed, counts them and puts the 1 ms period back with its phase intact.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "timer.h"
+#include "timer4.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+extern volatile uint32_t timerTicks;
+uint32_t ticklessLoad = 0;
+uint32_t ticklessFirst = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Initialize Timer 4A for a 1 ms tick
+void initTimer4()
+{
+    // Enable clocks
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R4;
+    _delay_cycles(3);
+
+    // Configure Timer 4 for 1 ms tick
+    TIMER4_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
+    TIMER4_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
+    TIMER4_TAMR_R = TIMER_TAMR_TAMR_PERIOD;          // configure for periodic mode (count down)
+    TIMER4_TAILR_R = 40000;                          // set load value (1 kHz rate)
+    TIMER4_CTL_R |= TIMER_CTL_TAEN;                  // turn-on timer
+    TIMER4_IMR_R |= TIMER_IMR_TATOIM;                // turn-on interrupt
+    NVIC_EN2_R |= 1 << (INT_TIMER4A-80);             // turn-on interrupt 86 (TIMER4A)
+}
+
+// Clocks left in the current millisecond, counting down from 40000
+uint32_t getTimer4Value()
+{
+    return TIMER4_TAV_R;
+}
+
+void tickIsr()
+{
+    advanceTimers(1);
+    TIMER4_ICR_R = TIMER_ICR_TATOCINT;
+}
+
+// Microseconds since initTimer(), wraps after 71 minutes
+uint32_t getTimerMicroseconds()
+{
+    uint32_t ms, count;
+    do
+    {
+        ms = timerTicks;
+        count = TIMER4_TAV_R;
+    }
+    while (ms != timerTicks);
+    // with interrupts masked the tick may be due but not yet counted
+    if ((TIMER4_RIS_R & TIMER_RIS_TATORIS) && count > 20000)
+        ms++;
+    return ms * 1000 + (40000 - count) / 40;
+}
+
+// Stretches the tick so Timer 4A next times out milliseconds ticks from now
+// Call with interrupts masked, then stopTickless() on waking if it returned true
+bool startTickless(uint32_t milliseconds)
+{
+    // a tick that is already due has to be counted by tickIsr first
+    if (milliseconds < 2 || (TIMER4_RIS_R & TIMER_RIS_TATORIS))
+        return false;
+    if (milliseconds > TICKLESS_MAX_MS)
+        milliseconds = TICKLESS_MAX_MS;
+    // cycles left in the current millisecond, then whole milliseconds
+    ticklessFirst = TIMER4_TAV_R;
+    ticklessLoad = ticklessFirst + (milliseconds - 1) * 40000;
+    TIMER4_TAILR_R = ticklessLoad;                   // reloads the count at once
+    return true;
+}
+
+// Counts the milliseconds slept and restores the 1 ms tick
+void stopTickless()
+{
+    uint32_t elapsed, ms, remaining;
+    elapsed = ticklessLoad - TIMER4_TAV_R;
+    if (TIMER4_RIS_R & TIMER_RIS_TATORIS)
+    {
+        // reached the deadline (and reloaded), counted here rather than in tickIsr
+        elapsed += ticklessLoad;
+        TIMER4_ICR_R = TIMER_ICR_TATOCINT;
+        NVIC_UNPEND2_R = 1 << (INT_TIMER4A-80);
+    }
+    if (elapsed >= ticklessFirst)
+    {
+        ms = 1 + (elapsed - ticklessFirst) / 40000;
+        remaining = 40000 - (elapsed - ticklessFirst) % 40000;
+    }
+    else
+    {
+        ms = 0;
+        remaining = ticklessFirst - elapsed;
+    }
+    TIMER4_TAILR_R = 40000;
+    TIMER4_TAV_R = remaining;
+    if (ms != 0)
+        advanceTimers(ms);
+}
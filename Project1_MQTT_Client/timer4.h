@@ -0,0 +1,32 @@
+// Timer 4A Library
+// 1 ms tick and sub-millisecond count for the Timer Service Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Timer 4A periodic interrupt at 1 kHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef TIMER4_H_
+#define TIMER4_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initTimer4();
+uint32_t getTimer4Value();
+
+#endif
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+# DHCP server
+# A small RFC 2131 server for testing the DHCP client on a local network
+#
+# Hands out addresses from a pool on one interface, usually the TAP device
+# the host build is attached to, so DISCOVER/OFFER/REQUEST/ACK, INIT-REBOOT,
+# renewal and NAK can be exercised without a router:
+#
+#   ip tuntap add dev tap0 mode tap && ip addr add 192.168.1.1/24 dev tap0
+#   ip link set tap0 up
+#   sudo python3 tools/dhcpserver.py tap0 --lease 60
+#   HOST_TAP=tap0 ./mqtt-host
+#
+# Port 67 needs root.  --nak makes every REQUEST fail, to test recovery
+# from a stored lease the network no longer honours.
+
+import argparse
+import ipaddress
+import socket
+import struct
+import time
+
+SERVER_PORT = 67
+CLIENT_PORT = 68
+MAGIC_COOKIE = 0x63825363
+SO_BINDTODEVICE = getattr(socket, 'SO_BINDTODEVICE', 25)
+
+DHCPDISCOVER = 1
+DHCPOFFER = 2
+DHCPREQUEST = 3
+DHCPDECLINE = 4
+DHCPACK = 5
+DHCPNAK = 6
+DHCPRELEASE = 7
+TYPE_NAMES = {1: 'DISCOVER', 2: 'OFFER', 3: 'REQUEST', 4: 'DECLINE', 5: 'ACK', 6: 'NAK', 7: 'RELEASE',
+              8: 'INFORM'}
+
+HEADER = struct.Struct('!BBBBIHH4s4s4s4s16s64s128sI')
+
+
+def parse(packet):
+    # returns the fixed fields and a dict of options, None if not BOOTREQUEST
+    if len(packet) < HEADER.size:
+        return None
+    fields = HEADER.unpack_from(packet)
+    if fields[0] != 1 or fields[14] != MAGIC_COOKIE:
+        return None
+    options = {}
+    i = HEADER.size
+    while i < len(packet) and packet[i] != 255:
+        if packet[i] == 0:
+            i += 1
+            continue
+        if i + 1 >= len(packet):
+            break
+        code, length = packet[i], packet[i + 1]
+        options[code] = packet[i + 2:i + 2 + length]
+        i += 2 + length
+    return fields, options
+
+
+def build(request, reply_type, yiaddr, args):
+    op, htype, hlen, hops, xid, secs, flags, ciaddr, _, _, giaddr, chaddr, _, _, _ = request
+    server = socket.inet_aton(args.server)
+    packet = HEADER.pack(2, htype, hlen, 0, xid, 0, flags, ciaddr, socket.inet_aton(yiaddr),
+                         server, giaddr, chaddr, b'', b'', MAGIC_COOKIE)
+    options = [(53, bytes([reply_type])), (54, server)]
+    if reply_type != DHCPNAK:
+        lease = args.lease
+        options += [(51, struct.pack('!I', lease)),
+                    (58, struct.pack('!I', lease // 2)),
+                    (59, struct.pack('!I', lease - lease // 8)),
+                    (1, socket.inet_aton(args.mask)),
+                    (3, socket.inet_aton(args.router or args.server)),
+                    (6, socket.inet_aton(args.dns or args.server))]
+    for code, value in options:
+        packet += bytes([code, len(value)]) + value
+    packet += b'\xff'
+    return packet + bytes(max(0, 300 - len(packet)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='DHCP server for testing the DHCP client')
+    parser.add_argument('interface', help='interface to serve, e.g. tap0')
+    parser.add_argument('--server', default='192.168.1.1', help='address of this server')
+    parser.add_argument('--pool', default='192.168.1.100', help='first address handed out')
+    parser.add_argument('--count', type=int, default=50, help='number of addresses in the pool')
+    parser.add_argument('--mask', default='255.255.255.0')
+    parser.add_argument('--router', help='default gateway, this server if omitted')
+    parser.add_argument('--dns', help='DNS server, this server if omitted')
+    parser.add_argument('--lease', type=int, default=3600, help='lease time in seconds')
+    parser.add_argument('--nak', action='store_true', help='refuse every REQUEST')
+    args = parser.parse_args()
+
+    first = ipaddress.IPv4Address(args.pool)
+    pool = [str(first + i) for i in range(args.count)]
+    leases = {}                                     # client MAC -> address
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    sock.setsockopt(socket.SOL_SOCKET, SO_BINDTODEVICE, args.interface.encode())
+    sock.bind(('', SERVER_PORT))
+    print('dhcpserver: serving %s-%s on %s' % (pool[0], pool[-1], args.interface), flush=True)
+
+    while True:
+        packet, _ = sock.recvfrom(1500)
+        parsed = parse(packet)
+        if parsed is None:
+            continue
+        fields, options = parsed
+        mac = fields[11][:6]
+        name = ':'.join('%02x' % b for b in mac)
+        message_type = options.get(53, b'\x00')[0]
+        requested = options.get(50)
+        requested = socket.inet_ntoa(requested) if requested and len(requested) == 4 else None
+        ciaddr = socket.inet_ntoa(fields[7])
+        if ciaddr == '0.0.0.0':
+            ciaddr = None
+        print('%s %s from %s%s' % (time.strftime('%H:%M:%S'), TYPE_NAMES.get(message_type, message_type), name,
+                                   ' for ' + (requested or ciaddr) if requested or ciaddr else ''), flush=True)
+
+        if message_type == DHCPDISCOVER:
+            address = leases.get(mac)
+            if address is None:
+                free = [a for a in pool if a not in leases.values()]
+                if not free:
+                    continue
+                address = requested if requested in free else free[0]
+            leases[mac] = address
+            reply = build(fields, DHCPOFFER, address, args)
+        elif message_type == DHCPREQUEST:
+            address = requested or ciaddr
+            owner = [m for m, a in leases.items() if a == address]
+            if args.nak or address not in pool or (owner and owner[0] != mac):
+                reply = build(fields, DHCPNAK, '0.0.0.0', args)
+            else:
+                leases[mac] = address
+                reply = build(fields, DHCPACK, address, args)
+        elif message_type in (DHCPRELEASE, DHCPDECLINE):
+            leases.pop(mac, None)
+            continue
+        else:
+            continue
+
+        # a client without an address (or asking for broadcast) can only hear a broadcast
+        broadcast = ciaddr is None or (fields[6] & 0x8000) != 0
+        destination = '255.255.255.255' if broadcast else ciaddr
+        sock.sendto(reply, (destination, CLIENT_PORT))
+        print('%s %s %s to %s' % (time.strftime('%H:%M:%S'), TYPE_NAMES[reply[HEADER.size + 2]],
+                                  socket.inet_ntoa(reply[16:20]), name), flush=True)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+# DNS responder
+# Answers A queries from a fixed table for testing the stub resolver
+#
+# Serves the names given on the command line, on the address the host
+# build is told to use (SET DNS, or the DNS option of tools/dhcpserver.py),
+# so positive and negative caching, CNAME chains, SERVFAIL and timeouts
+# can all be exercised without a real server:
+#
+#   sudo python3 tools/dnsserver.py broker.lan=192.168.1.1 mqtt.lan@broker.lan
+#   HOST_TAP=tap0 ./mqtt-host         then SET MQTT mqtt.lan and CONNECT
+#
+# name=a.b.c.d answers with an A record and name@other with a CNAME to
+# other.  Any other name gets NXDOMAIN with an SOA carrying the negative
+# TTL.  Port 53 needs root.
+
+import argparse
+import socket
+import struct
+import time
+
+DNS_PORT = 53
+TYPE_A = 1
+TYPE_CNAME = 5
+TYPE_SOA = 6
+CLASS_IN = 1
+RCODE_SERVFAIL = 2
+RCODE_NXDOMAIN = 3
+
+
+def encode_name(name):
+    out = b''
+    for label in name.rstrip('.').split('.'):
+        out += bytes([len(label)]) + label.encode()
+    return out + b'\x00'
+
+
+def decode_name(packet, offset):
+    # returns the question name and the offset past it, compression is not used in queries
+    labels = []
+    while packet[offset] != 0:
+        length = packet[offset]
+        labels.append(packet[offset + 1:offset + 1 + length].decode(errors='replace'))
+        offset += 1 + length
+    return '.'.join(labels).lower(), offset + 1
+
+
+def record(name, rtype, ttl, data):
+    return encode_name(name) + struct.pack('!HHIH', rtype, CLASS_IN, ttl, len(data)) + data
+
+
+def answer(query, table, args):
+    # returns the response to query, None to stay silent
+    if len(query) < 12:
+        return None
+    qid, flags, qdcount = struct.unpack_from('!HHH', query)
+    if flags & 0x8000 or qdcount != 1:
+        return None
+    name, end = decode_name(query, 12)
+    qtype, qclass = struct.unpack_from('!HH', query, end)
+    question = query[12:end + 4]
+
+    answers = []
+    authority = []
+    rcode = 0
+    current = name
+    found = False
+    if args.servfail:
+        rcode = RCODE_SERVFAIL
+    else:
+        # follow CNAMEs for a few steps, as a recursive server would
+        for _ in range(8):
+            value = table.get(current)
+            if value is None:
+                break
+            kind, target = value
+            if kind == 'cname':
+                answers.append(record(current, TYPE_CNAME, args.ttl, encode_name(target)))
+                current = target
+            else:
+                if qtype == TYPE_A:
+                    answers.append(record(current, TYPE_A, args.ttl, socket.inet_aton(target)))
+                    found = True
+                break
+        if current not in table:
+            rcode = RCODE_NXDOMAIN
+        if not found:
+            soa = encode_name('ns.' + args.zone) + encode_name('admin.' + args.zone) + \
+                struct.pack('!IIIII', 1, 3600, 600, 86400, args.negative_ttl)
+            authority.append(record(args.zone, TYPE_SOA, args.negative_ttl, soa))
+
+    header = struct.pack('!HHHHHH', qid, 0x8180 | (flags & 0x0100) | rcode, 1, len(answers), len(authority), 0)
+    return header + question + b''.join(answers) + b''.join(authority), name, rcode, len(answers)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='DNS responder for testing the stub resolver')
+    parser.add_argument('names', nargs='*', help='name=a.b.c.d for an A record, name@other for a CNAME')
+    parser.add_argument('--address', default='192.168.1.1', help='address to answer on')
+    parser.add_argument('--ttl', type=int, default=300, help='TTL of positive answers')
+    parser.add_argument('--negative-ttl', type=int, default=60, help='SOA minimum sent with NXDOMAIN')
+    parser.add_argument('--zone', default='lan', help='zone named in the SOA')
+    parser.add_argument('--drop', type=int, default=0, help='ignore the first N queries to force retries')
+    parser.add_argument('--servfail', action='store_true', help='answer every query with SERVFAIL')
+    args = parser.parse_args()
+
+    table = {}
+    for entry in args.names:
+        if '=' in entry:
+            name, value = entry.split('=', 1)
+            table[name.lower().rstrip('.')] = ('a', value)
+        elif '@' in entry:
+            name, value = entry.split('@', 1)
+            table[name.lower().rstrip('.')] = ('cname', value.lower().rstrip('.'))
+        else:
+            parser.error('%s is not name=address or name@other' % entry)
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind((args.address, DNS_PORT))
+    print('dnsserver: %u names on %s' % (len(table), args.address), flush=True)
+
+    dropped = 0
+    while True:
+        query, client = sock.recvfrom(512)
+        try:
+            result = answer(query, table, args)
+        except (IndexError, struct.error):
+            result = None
+        if result is None:
+            continue
+        response, name, rcode, count = result
+        if dropped < args.drop:
+            dropped += 1
+            print('%s %s from %s:%u dropped' % (time.strftime('%H:%M:%S'), name, client[0], client[1]), flush=True)
+            continue
+        sock.sendto(response, client)
+        status = {0: '%u answers' % count, RCODE_SERVFAIL: 'SERVFAIL', RCODE_NXDOMAIN: 'NXDOMAIN'}[rcode]
+        print('%s %s from %s:%u, %s' % (time.strftime('%H:%M:%S'), name, client[0], client[1], status), flush=True)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,332 @@
+#!/usr/bin/env python3
+# MQTT broker
+# A small MQTT 3.1.1 and 5.0 broker for testing the client over TCP
+#
+# Speaks the subset the client uses (CONNECT, SUBSCRIBE, UNSUBSCRIBE,
+# PUBLISH at QoS 0 and 1, PINGREQ, DISCONNECT, topic aliases from the
+# client) and delivers every publish to the matching subscribers,
+# including the publisher.  Sessions are kept by client ID, so persistent
+# sessions and session present can be exercised.  The connection runs over
+# the workstation's own TCP, which rejects a segment that reuses sequence
+# space, so a client that corrupts its byte stream shows up here as a
+# malformed packet:
+#
+#   python3 tools/mqttbroker.py --address 192.168.1.1
+#   HOST_TAP=tap0 ./mqtt-host         then SET MQTT 192.168.1.1 and CONNECT
+#
+# --delay holds every reply back to stand in for a distant broker,
+# --log-file appends a timestamped line per packet for measurements and
+# --reset-after drops the connection as a publish arrives, before the
+# workstation acknowledges it, so the client's spool can be checked to
+# keep the message.
+
+import argparse
+import select
+import socket
+import struct
+import time
+
+BROKER_PORT = 1883
+
+CONNECT = 1
+CONNACK = 2
+PUBLISH = 3
+PUBACK = 4
+SUBSCRIBE = 8
+SUBACK = 9
+UNSUBSCRIBE = 10
+UNSUBACK = 11
+PINGREQ = 12
+PINGRESP = 13
+DISCONNECT = 14
+TYPE_NAMES = {1: 'CONNECT', 3: 'PUBLISH', 8: 'SUBSCRIBE', 10: 'UNSUBSCRIBE', 12: 'PINGREQ', 14: 'DISCONNECT'}
+
+PROP_TOPIC_ALIAS = 0x23
+
+
+def encode_length(length):
+    out = b''
+    while True:
+        byte = length & 0x7F
+        length >>= 7
+        out += bytes([byte | (0x80 if length else 0)])
+        if not length:
+            return out
+
+
+def decode_length(data, offset):
+    # returns the length and the offset past it, None if data is incomplete
+    length = 0
+    for i in range(4):
+        if offset + i >= len(data):
+            return None
+        length |= (data[offset + i] & 0x7F) << (7 * i)
+        if data[offset + i] & 0x80 == 0:
+            return length, offset + i + 1
+    raise ValueError('remaining length over 4 bytes')
+
+
+def utf8(data, offset):
+    length = struct.unpack_from('!H', data, offset)[0]
+    return data[offset + 2:offset + 2 + length].decode(errors='replace'), offset + 2 + length
+
+
+def properties(data, offset):
+    # returns a dict of the 5.0 properties the broker cares about and the offset past them
+    length, offset = decode_length(data, offset)
+    end = offset + length
+    found = {}
+    while offset < end:
+        prop = data[offset]
+        offset += 1
+        if prop in (0x01, 0x17, 0x19, 0x24, 0x25, 0x28, 0x29, 0x2A):
+            size = 1
+        elif prop in (0x13, 0x21, 0x22, 0x23):
+            size = 2
+        elif prop in (0x02, 0x11, 0x18, 0x27):
+            size = 4
+        elif prop == 0x0B:
+            size = decode_length(data, offset)[1] - offset
+        elif prop == 0x26:
+            size = utf8(data, utf8(data, offset)[1])[1] - offset
+        else:
+            size = 2 + struct.unpack_from('!H', data, offset)[0]
+        found[prop] = data[offset:offset + size]
+        offset += size
+    return found, end
+
+
+def matches(topic_filter, topic):
+    filter_levels = topic_filter.split('/')
+    levels = topic.split('/')
+    if topic.startswith('$') and filter_levels[0] in ('+', '#'):
+        return False
+    for i, level in enumerate(filter_levels):
+        if level == '#':
+            return True
+        if i >= len(levels) or (level != '+' and level != levels[i]):
+            return False
+    return len(levels) == len(filter_levels)
+
+
+class Session:
+    def __init__(self):
+        self.filters = {}                           # filter -> QoS
+
+
+class Connection:
+    def __init__(self, sock, address):
+        self.sock = sock
+        self.address = address
+        self.buffer = b''
+        self.client_id = None
+        self.version = 4
+        self.session = None
+        self.inbound_aliases = {}                   # alias -> topic, set by the client
+        self.pending = []                           # (due time, bytes) held back by --delay
+
+
+class Broker:
+    def __init__(self, args):
+        self.args = args
+        self.sessions = {}                          # client ID -> Session
+        self.connections = {}                       # socket -> Connection
+        self.publishes = 0
+        self.log_file = open(args.log_file, 'a') if args.log_file else None
+
+    def log(self, connection, text):
+        now = time.time()
+        who = connection.client_id or '%s:%u' % connection.address
+        line = '%s.%03u %s %s' % (time.strftime('%H:%M:%S', time.localtime(now)), int(now * 1000) % 1000, who, text)
+        print(line, flush=True)
+        if self.log_file:
+            self.log_file.write('%.6f %s %s\n' % (now, who, text))
+            self.log_file.flush()
+
+    def send(self, connection, packet_type, flags, body):
+        packet = bytes([(packet_type << 4) | flags]) + encode_length(len(body)) + body
+        connection.pending.append((time.time() + self.args.delay / 1000.0, packet))
+
+    def flush(self):
+        # sends every reply that is due, returns the seconds until the next one
+        now = time.time()
+        wait = None
+        for connection in list(self.connections.values()):
+            while connection.pending and connection.pending[0][0] <= now:
+                try:
+                    connection.sock.sendall(connection.pending.pop(0)[1])
+                except OSError:
+                    self.close(connection)
+                    break
+            if connection.pending:
+                due = connection.pending[0][0] - now
+                wait = due if wait is None else min(wait, due)
+        return wait
+
+    def close(self, connection):
+        if connection.sock in self.connections:
+            del self.connections[connection.sock]
+            connection.sock.close()
+            self.log(connection, 'closed')
+
+    def deliver(self, topic, data):
+        # QoS 0 to every subscriber, whatever QoS it asked for
+        for connection in self.connections.values():
+            if connection.session is None:
+                continue
+            if not any(matches(f, topic) for f in connection.session.filters):
+                continue
+            body = struct.pack('!H', len(topic)) + topic.encode()
+            if connection.version == 5:
+                body += b'\x00'
+            self.send(connection, PUBLISH, 0, body + data)
+
+    def handle(self, connection, packet_type, flags, body):
+        name = TYPE_NAMES.get(packet_type, 'type %u' % packet_type)
+        if packet_type == CONNECT:
+            protocol, offset = utf8(body, 0)
+            connection.version, connect_flags, keep_alive = struct.unpack_from('!BBH', body, offset)
+            offset += 4
+            if connection.version == 5:
+                offset = properties(body, offset)[1]
+            connection.client_id, offset = utf8(body, offset)
+            clean = connect_flags & 0x02 != 0
+            present = not clean and connection.client_id in self.sessions
+            if clean or not present:
+                self.sessions[connection.client_id] = Session()
+            connection.session = self.sessions[connection.client_id]
+            # a second connection with the same client ID takes the session over
+            for other in list(self.connections.values()):
+                if other is not connection and other.client_id == connection.client_id:
+                    self.log(other, 'taken over')
+                    self.close(other)
+            self.log(connection, 'CONNECT %s, keep alive %u s, %s%s' % (protocol + str(connection.version), keep_alive,
+                                                                    'clean' if clean else 'persistent',
+                                                                    ', session present' if present else ''))
+            self.send(connection, CONNACK, 0, bytes([1 if present else 0, 0]) + (b'\x00' if connection.version == 5 else b''))
+            return
+        if connection.session is None:
+            raise ValueError('%s before CONNECT' % name)
+        if packet_type == PUBLISH:
+            qos = (flags >> 1) & 0x03
+            topic, offset = utf8(body, 0)
+            packet_id = None
+            if qos > 0:
+                packet_id = struct.unpack_from('!H', body, offset)[0]
+                offset += 2
+            if connection.version == 5:
+                props, offset = properties(body, offset)
+                if PROP_TOPIC_ALIAS in props:
+                    alias = struct.unpack('!H', props[PROP_TOPIC_ALIAS])[0]
+                    if topic:
+                        connection.inbound_aliases[alias] = topic
+                    elif alias in connection.inbound_aliases:
+                        topic = connection.inbound_aliases[alias]
+                    else:
+                        raise ValueError('unknown topic alias %u' % alias)
+            data = body[offset:]
+            self.publishes += 1
+            if self.publishes == self.args.reset_after:
+                # before the workstation's delayed ACK goes out
+                self.log(connection, 'PUBLISH %s, resetting the connection' % topic)
+                connection.sock.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack('ii', 1, 0))
+                self.close(connection)
+                return
+            self.log(connection, 'PUBLISH %s qos %u (%u bytes) %s' % (topic, qos, len(data),
+                                                                    data[:32].decode(errors='replace')))
+            if qos == 1:
+                self.send(connection, PUBACK, 0, struct.pack('!H', packet_id) + (b'\x00' if connection.version == 5 else b''))
+            self.deliver(topic, data)
+        elif packet_type in (SUBSCRIBE, UNSUBSCRIBE):
+            packet_id = struct.unpack_from('!H', body, 0)[0]
+            offset = 2
+            if connection.version == 5:
+                offset = properties(body, offset)[1]
+            codes = b''
+            topics = []
+            while offset < len(body):
+                topic, offset = utf8(body, offset)
+                topics.append(topic)
+                if packet_type == SUBSCRIBE:
+                    qos = body[offset] & 0x03
+                    offset += 1
+                    connection.session.filters[topic] = qos
+                    codes += bytes([min(qos, 1)])
+                else:
+                    connection.session.filters.pop(topic, None)
+                    codes += b'\x00'
+            self.log(connection, '%s %u topics: %s' % (name, len(topics), ' '.join(topics)))
+            reply = struct.pack('!H', packet_id) + (b'\x00' if connection.version == 5 else b'')
+            if packet_type == SUBSCRIBE:
+                self.send(connection, SUBACK, 0, reply + codes)
+            else:
+                self.send(connection, UNSUBACK, 0, reply + (codes if connection.version == 5 else b''))
+        elif packet_type == PINGREQ:
+            self.log(connection, 'PINGREQ')
+            self.send(connection, PINGRESP, 0, b'')
+        elif packet_type == DISCONNECT:
+            self.log(connection, 'DISCONNECT')
+            self.close(connection)
+        else:
+            self.log(connection, '%s ignored' % name)
+
+    def receive(self, connection):
+        try:
+            data = connection.sock.recv(4096)
+        except OSError:
+            data = b''
+        if not data:
+            self.close(connection)
+            return
+        connection.buffer += data
+        while len(connection.buffer) >= 2:
+            try:
+                decoded = decode_length(connection.buffer, 1)
+                if decoded is None:
+                    return
+                length, offset = decoded
+                if len(connection.buffer) < offset + length:
+                    return
+                header = connection.buffer[0]
+                body = connection.buffer[offset:offset + length]
+                connection.buffer = connection.buffer[offset + length:]
+                self.handle(connection, header >> 4, header & 0x0F, body)
+            except (ValueError, IndexError, struct.error) as error:
+                self.log(connection, 'malformed packet, %s' % error)
+                self.close(connection)
+                return
+            if connection.sock not in self.connections:
+                return
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Small MQTT broker for testing the client')
+    parser.add_argument('--address', default='0.0.0.0', help='address to listen on')
+    parser.add_argument('--port', type=int, default=BROKER_PORT)
+    parser.add_argument('--delay', type=float, default=0.0, help='milliseconds to hold every reply back')
+    parser.add_argument('--log-file', help='append a timestamped line per packet to this file')
+    parser.add_argument('--reset-after', type=int, default=0, metavar='N',
+                        help='reset the connection as the Nth PUBLISH arrives, once')
+    args = parser.parse_args()
+
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind((args.address, args.port))
+    listener.listen(8)
+    broker = Broker(args)
+    print('mqttbroker: listening on %s:%u' % (args.address, args.port), flush=True)
+
+    while True:
+        wait = broker.flush()
+        readable, _, _ = select.select([listener] + list(broker.connections), [], [], wait)
+        for sock in readable:
+            if sock is listener:
+                client, address = listener.accept()
+                client.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                broker.connections[client] = Connection(client, address)
+            elif sock in broker.connections:
+                broker.receive(broker.connections[sock])
+
+
+if __name__ == '__main__':
+    main()
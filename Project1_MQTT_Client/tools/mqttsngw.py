@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+# MQTT-SN gateway
+# A loopback MQTT-SN 1.2 gateway for testing the MQTT-SN transport
+#
+# Speaks the subset the client uses (CONNECT, REGISTER, PUBLISH at QoS 0
+# and -1, SUBSCRIBE, UNSUBSCRIBE, PINGREQ, DISCONNECT) and delivers every
+# publish to the subscribers on the gateway itself, registering topic
+# names with them first as a real gateway does.  There is no broker
+# behind it.  The client looks for the gateway at the broker address:
+#
+#   python3 tools/mqttsngw.py --predefined 1=sensors/temp
+#   HOST_TAP=tap0 ./mqtt-host         then SET MQTT 192.168.1.1,
+#                                     SET TRANSPORT SN and CONNECT
+#
+# --loss drops a share of the messages that arrive, so the request retries
+# and the lost gateway handling can be exercised.
+
+import argparse
+import random
+import socket
+import struct
+import time
+
+GATEWAY_PORT = 1884
+
+CONNECT = 0x04
+CONNACK = 0x05
+REGISTER = 0x0A
+REGACK = 0x0B
+PUBLISH = 0x0C
+SUBSCRIBE = 0x12
+SUBACK = 0x13
+UNSUBSCRIBE = 0x14
+UNSUBACK = 0x15
+PINGREQ = 0x16
+PINGRESP = 0x17
+DISCONNECT = 0x18
+
+TOPIC_NORMAL = 0x00
+TOPIC_PREDEFINED = 0x01
+TOPIC_SHORT = 0x02
+QOS_M1 = 0x60
+
+RC_ACCEPTED = 0x00
+RC_INVALID_TOPIC = 0x02
+
+
+def matches(topic_filter, topic):
+    filter_levels = topic_filter.split('/')
+    levels = topic.split('/')
+    if topic.startswith('$') and filter_levels[0] in ('+', '#'):
+        return False
+    for i, level in enumerate(filter_levels):
+        if level == '#':
+            return True
+        if i >= len(levels) or (level != '+' and level != levels[i]):
+            return False
+    return len(levels) == len(filter_levels)
+
+
+class Client:
+    def __init__(self, client_id):
+        self.client_id = client_id
+        self.known = set()                          # normal topic ids registered with this client
+        self.filters = {}                           # filter -> True
+        self.msg_id = 0
+
+
+class Gateway:
+    def __init__(self, sock, args):
+        self.sock = sock
+        self.args = args
+        self.clients = {}                           # address -> Client
+        self.names = {}                             # normal topic name -> id
+        self.predefined = {}                        # predefined id -> name
+        for entry in args.predefined:
+            topic_id, name = entry.split('=', 1)
+            self.predefined[int(topic_id)] = name
+
+    def log(self, address, text):
+        client = self.clients.get(address)
+        who = client.client_id if client else '%s:%u' % address
+        print('%s %s %s' % (time.strftime('%H:%M:%S'), who, text), flush=True)
+
+    def send(self, address, message_type, body):
+        self.sock.sendto(bytes([len(body) + 2, message_type]) + body, address)
+
+    def topic_id(self, name):
+        if name not in self.names:
+            self.names[name] = len(self.names) + 1 + max(self.predefined, default=0)
+        return self.names[name]
+
+    def resolve(self, flags, topic_id):
+        # returns the name a publish or subscribe refers to, None if unknown
+        kind = flags & 0x03
+        if kind == TOPIC_SHORT:
+            return struct.pack('!H', topic_id).decode(errors='replace')
+        if kind == TOPIC_PREDEFINED:
+            return self.predefined.get(topic_id)
+        for name, value in self.names.items():
+            if value == topic_id:
+                return name
+        return None
+
+    def deliver(self, name, data):
+        for address, client in self.clients.items():
+            if not any(matches(f, name) for f in client.filters):
+                continue
+            predefined = [i for i, n in self.predefined.items() if n == name]
+            if len(name.encode()) == 2:
+                flags, topic_id = TOPIC_SHORT, struct.unpack('!H', name.encode())[0]
+            elif predefined:
+                flags, topic_id = TOPIC_PREDEFINED, predefined[0]
+            else:
+                flags, topic_id = TOPIC_NORMAL, self.topic_id(name)
+                if topic_id not in client.known:
+                    client.msg_id = (client.msg_id + 1) & 0xFFFF
+                    self.send(address, REGISTER, struct.pack('!HH', topic_id, client.msg_id) + name.encode())
+                    client.known.add(topic_id)
+            self.send(address, PUBLISH, struct.pack('!BHH', flags, topic_id, 0) + data)
+            self.log(address, 'got %s (%u bytes)' % (name, len(data)))
+
+    def handle(self, packet, address):
+        if len(packet) >= 4 and packet[0] == 0x01:
+            length, message = struct.unpack_from('!H', packet, 1)[0], packet[3:]
+            length -= 3
+        elif len(packet) >= 2:
+            length, message = packet[0] - 1, packet[1:]
+        else:
+            return
+        message = message[:length]
+        if not message:
+            return
+        message_type = message[0]
+        client = self.clients.get(address)
+
+        if message_type == CONNECT and len(message) >= 5:
+            self.clients[address] = Client(message[5:].decode(errors='replace'))
+            self.log(address, 'CONNECT, keep alive %u s' % struct.unpack_from('!H', message, 3)[0])
+            self.send(address, CONNACK, bytes([RC_ACCEPTED]))
+        elif message_type == PUBLISH and len(message) >= 6:
+            flags, topic_id, msg_id = struct.unpack_from('!BHH', message, 1)
+            if client is None and (flags & QOS_M1) != QOS_M1:
+                return
+            name = self.resolve(flags, topic_id)
+            if name is None:
+                self.log(address, 'PUBLISH to unknown topic id %u' % topic_id)
+                return
+            self.log(address, 'PUBLISH %s%s (%u bytes)' % (name, ' at QoS -1' if (flags & QOS_M1) == QOS_M1 else '',
+                                                          len(message) - 6))
+            self.deliver(name, message[6:])
+        elif client is None:
+            self.log(address, 'message type 0x%02x before CONNECT' % message_type)
+        elif message_type == REGISTER and len(message) >= 5:
+            msg_id = struct.unpack_from('!H', message, 3)[0]
+            name = message[5:].decode(errors='replace')
+            topic_id = self.topic_id(name)
+            client.known.add(topic_id)
+            self.log(address, 'REGISTER %s as %u' % (name, topic_id))
+            self.send(address, REGACK, struct.pack('!HHB', topic_id, msg_id, RC_ACCEPTED))
+        elif message_type == REGACK:
+            pass
+        elif message_type in (SUBSCRIBE, UNSUBSCRIBE) and len(message) >= 4:
+            flags, msg_id = struct.unpack_from('!BH', message, 1)
+            if flags & 0x03 == TOPIC_NORMAL:
+                name = message[4:].decode(errors='replace')
+            elif len(message) >= 6:
+                name = self.resolve(flags, struct.unpack_from('!H', message, 4)[0])
+            else:
+                name = None
+            if message_type == UNSUBSCRIBE:
+                client.filters.pop(name, None)
+                self.log(address, 'UNSUBSCRIBE %s' % name)
+                self.send(address, UNSUBACK, struct.pack('!H', msg_id))
+            elif name is None:
+                self.send(address, SUBACK, struct.pack('!BHHB', flags, 0, msg_id, RC_INVALID_TOPIC))
+            else:
+                client.filters[name] = True
+                # wildcard filters have no id, the topics are registered as they are published
+                topic_id = 0
+                if flags & 0x03 == TOPIC_NORMAL and '+' not in name and '#' not in name:
+                    topic_id = self.topic_id(name)
+                    client.known.add(topic_id)
+                elif flags & 0x03 != TOPIC_NORMAL:
+                    topic_id = struct.unpack_from('!H', message, 4)[0]
+                self.log(address, 'SUBSCRIBE %s' % name)
+                self.send(address, SUBACK, struct.pack('!BHHB', flags & 0x03, topic_id, msg_id, RC_ACCEPTED))
+        elif message_type == PINGREQ:
+            self.send(address, PINGRESP, b'')
+        elif message_type == DISCONNECT:
+            self.log(address, 'DISCONNECT')
+            self.send(address, DISCONNECT, b'')
+            del self.clients[address]
+        else:
+            self.log(address, 'message type 0x%02x ignored' % message_type)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Loopback MQTT-SN gateway for testing the MQTT-SN transport')
+    parser.add_argument('--address', default='0.0.0.0', help='address to listen on')
+    parser.add_argument('--port', type=int, default=GATEWAY_PORT)
+    parser.add_argument('--predefined', action='append', default=[], metavar='ID=TOPIC',
+                        help='predefined topic id, may be repeated')
+    parser.add_argument('--loss', type=float, default=0.0, help='share of arriving messages to drop, 0 to 1')
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind((args.address, args.port))
+    gateway = Gateway(sock, args)
+    print('mqttsngw: listening on %s:%u' % (args.address, args.port), flush=True)
+
+    while True:
+        packet, address = sock.recvfrom(1500)
+        if random.random() < args.loss:
+            gateway.log(address, 'message dropped')
+            continue
+        try:
+            gateway.handle(packet, address)
+        except (IndexError, struct.error):
+            gateway.log(address, 'malformed message')
+
+
+if __name__ == '__main__':
+    main()
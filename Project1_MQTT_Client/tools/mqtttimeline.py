@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+# MQTT timeline
+# Lists the MQTT packets of a HOST_PCAP_OUT capture with their times
+#
+# The host build records every frame it sends and receives, stamped with the
+# time it was handled, so the capture is the client's own view of a
+# connection.  Each TCP connection to the broker port is reassembled in
+# both directions and its MQTT packets are printed in milliseconds from the
+# connection's SYN, followed by the times to CONNACK, to the SUBACK that
+# answers the last SUBSCRIBE (ready) and to the first inbound PUBLISH:
+#
+#   HOST_TAP=tap0 HOST_PCAP_OUT=run.pcap ./mqtt-host
+#   python3 tools/mqtttimeline.py run.pcap
+#   python3 tools/mqtttimeline.py --summary run.pcap
+#
+# Retransmitted bytes are skipped, so each packet is listed once.
+
+import argparse
+import struct
+
+BROKER_PORT = 1883
+
+TYPE_NAMES = {1: 'CONNECT', 2: 'CONNACK', 3: 'PUBLISH', 4: 'PUBACK', 8: 'SUBSCRIBE', 9: 'SUBACK',
+              10: 'UNSUBSCRIBE', 11: 'UNSUBACK', 12: 'PINGREQ', 13: 'PINGRESP', 14: 'DISCONNECT'}
+
+TCP_SYN = 0x02
+
+
+def read_pcap(name):
+    # yields (seconds, frame) for every record
+    with open(name, 'rb') as f:
+        header = f.read(24)
+        if len(header) < 24:
+            return
+        endian = '<' if struct.unpack('<I', header[:4])[0] == 0xA1B2C3D4 else '>'
+        while True:
+            record = f.read(16)
+            if len(record) < 16:
+                return
+            seconds, micros, length, _ = struct.unpack(endian + 'IIII', record)
+            yield seconds + micros / 1e6, f.read(length)
+
+
+def tcp_segment(frame):
+    # returns (source, destination, source port, destination port, seq, flags, data) or None
+    if len(frame) < 34 or frame[12:14] != b'\x08\x00' or frame[23] != 6:
+        return None
+    ip_length = (frame[14] & 0x0F) * 4
+    total = struct.unpack_from('!H', frame, 16)[0]
+    tcp = frame[14 + ip_length:14 + total]
+    if len(tcp) < 20:
+        return None
+    source_port, destination_port, seq, _, offset, flags = struct.unpack_from('!HHIIBB', tcp)
+    return frame[26:30], frame[30:34], source_port, destination_port, seq, flags, tcp[(offset >> 4) * 4:]
+
+
+class Direction:
+    def __init__(self):
+        self.next = None
+        self.buffer = b''
+
+    def add(self, seq, flags, data):
+        # keeps bytes that continue the stream, drops repeats
+        if flags & TCP_SYN:
+            self.next = (seq + 1) & 0xFFFFFFFF
+            return
+        if self.next is None or not data:
+            return
+        skip = (self.next - seq) & 0xFFFFFFFF
+        if skip >= 0x80000000 or skip >= len(data):
+            return
+        self.buffer += data[skip:]
+        self.next = (seq + len(data)) & 0xFFFFFFFF
+
+    def packets(self):
+        # yields (type, flags, body) for each whole packet buffered
+        while len(self.buffer) >= 2:
+            length, shift, i = 0, 0, 1
+            while True:
+                if i >= len(self.buffer):
+                    return
+                length |= (self.buffer[i] & 0x7F) << shift
+                shift += 7
+                i += 1
+                if self.buffer[i - 1] & 0x80 == 0 or i == 5:
+                    break
+            if len(self.buffer) < i + length:
+                return
+            header = self.buffer[0]
+            body = self.buffer[i:i + length]
+            self.buffer = self.buffer[i + length:]
+            yield header >> 4, header & 0x0F, body
+
+
+class Connection:
+    def __init__(self, start, port):
+        self.start = start
+        self.port = port
+        self.out = Direction()
+        self.into = Direction()
+        self.events = []                            # (ms, arrow, text)
+        self.connack = None
+        self.ready = None
+        self.first_publish = None
+        self.subscribes = 0
+
+
+def describe(packet_type, body):
+    name = TYPE_NAMES.get(packet_type, 'type %u' % packet_type)
+    if packet_type in (3,) and len(body) >= 2:
+        length = struct.unpack_from('!H', body)[0]
+        return '%s %s' % (name, body[2:2 + length].decode(errors='replace') or '(alias)')
+    if packet_type == 8:
+        return '%s, %u bytes' % (name, len(body))
+    return name
+
+
+def main():
+    parser = argparse.ArgumentParser(description='MQTT packets of a host capture, with times')
+    parser.add_argument('capture')
+    parser.add_argument('--port', type=int, default=BROKER_PORT, help='broker port')
+    parser.add_argument('--summary', action='store_true', help='only print the times per connection')
+    args = parser.parse_args()
+
+    connections = {}                                # client port -> Connection, newest
+    order = []
+    for seconds, frame in read_pcap(args.capture):
+        segment = tcp_segment(frame)
+        if segment is None:
+            continue
+        _, _, source_port, destination_port, seq, flags, data = segment
+        if destination_port == args.port:
+            port, outbound = source_port, True
+        elif source_port == args.port:
+            port, outbound = destination_port, False
+        else:
+            continue
+        if outbound and flags & TCP_SYN and (port not in connections or connections[port].out.next is not None):
+            connections[port] = Connection(seconds, port)
+            order.append(connections[port])
+        if port not in connections:
+            continue
+        connection = connections[port]
+        direction = connection.out if outbound else connection.into
+        direction.add(seq, flags, data)
+        ms = (seconds - connection.start) * 1000
+        for packet_type, _, body in direction.packets():
+            connection.events.append((ms, '->' if outbound else '<-', describe(packet_type, body)))
+            if outbound and packet_type == 8:
+                connection.subscribes += 1
+            elif not outbound and packet_type == 2 and connection.connack is None:
+                connection.connack = ms
+            elif not outbound and packet_type == 9:
+                connection.subscribes -= 1
+                if connection.subscribes == 0:
+                    connection.ready = ms
+            elif not outbound and packet_type == 3 and connection.first_publish is None:
+                connection.first_publish = ms
+
+    for connection in order:
+        print('connection from port %u' % connection.port)
+        if not args.summary:
+            for ms, arrow, text in connection.events:
+                print('  %9.3f ms %s %s' % (ms, arrow, text))
+        for label, value in (('CONNACK', connection.connack), ('ready', connection.ready),
+                             ('first publish', connection.first_publish)):
+            print('  SYN to %-13s %s' % (label, '%.3f ms' % value if value is not None else '-'))
+
+
+if __name__ == '__main__':
+    main()
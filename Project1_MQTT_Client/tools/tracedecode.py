@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+# Trace decoder
+# Turns the "#T" lines of a captured console log back into text
+#
+# The event table is read from trace.h, so the decoder always matches the
+# firmware it is run next to:
+#
+#   python3 tools/tracedecode.py putty.log
+#   python3 tools/tracedecode.py --header path/to/trace.h < putty.log
+#
+# Other console output in the log is skipped.
+
+import argparse
+import os
+import re
+import sys
+
+TIMER_LOAD = 40000              # Timer 4A reload, 40 MHz / 1 kHz
+TIMER_CLOCKS_PER_US = 40
+
+EVENT_PATTERN = re.compile(r'EVENT\((\w+),\s*"((?:[^"\\]|\\.)*)"\)')
+RECORD_PATTERN = re.compile(r'#T([0-9a-fA-F]{40})')
+
+
+def load_events(header):
+    # events are numbered in the order TRACE_EVENTS lists them
+    with open(header) as f:
+        text = f.read()
+    start = text.index('#define TRACE_EVENTS')
+    end = text.index('\n\n', start)
+    return EVENT_PATTERN.findall(text[start:end])
+
+
+def decode(line, events):
+    match = RECORD_PATTERN.search(line)
+    if not match:
+        return None
+    fields = match.group(1)
+    event = int(fields[0:4], 16)
+    sub_ticks = int(fields[4:8], 16)
+    ticks = int(fields[8:16], 16)
+    args = [int(fields[16 + i * 8:24 + i * 8], 16) for i in range(3)]
+    us = ticks * 1000 + (TIMER_LOAD - sub_ticks) // TIMER_CLOCKS_PER_US
+    if event < len(events):
+        name, text = events[event]
+        count = len(re.findall(r'%[^%]*?[uxdX]', text))
+        try:
+            message = text % tuple(args[:count])
+        except (TypeError, ValueError):
+            message = text + ' ' + ' '.join(str(a) for a in args)
+    else:
+        name, message = 'event%u' % event, ' '.join(str(a) for a in args)
+    return '%10u.%03u  %-16s %s' % (us // 1000, us % 1000, name, message)
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description='Decode firmware trace records')
+    parser.add_argument('log', nargs='?', help='captured console output, stdin if omitted')
+    parser.add_argument('--header', default=os.path.join(here, '..', 'trace.h'),
+                        help='trace.h holding the event table')
+    options = parser.parse_args()
+    events = load_events(options.header)
+    source = open(options.log, errors='replace') if options.log else sys.stdin
+    with source:
+        for line in source:
+            text = decode(line, events)
+            if text is not None:
+                print(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,244 @@
+// Topic Library
+// Subscription registry mapping MQTT topic filters to local handlers
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Filters are stored as a trie with one node per topic level.  Children are
+// not kept in per-node lists; instead every (parent, level) edge lives in one
+// open addressed hash table, so stepping down a level is a single probe and
+// a match costs O(levels) plus the '+' and '#' branches actually present.
+// Nodes and level names come from fixed pools sized at compile time, so RAM
+// use is static.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "topic.h"
+
+typedef struct _topicNode
+{
+    uint16_t parent;
+    uint8_t nameLength;
+    uint16_t nameOffset;
+    uint16_t levelHash;
+    topicHandler handler;
+} topicNode;
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+topicNode topicNodes[TOPIC_MAX_NODES];
+uint16_t topicNodeCount = 0;
+char topicNames[TOPIC_MAX_NAME_BYTES];
+uint16_t topicNameUsed = 0;
+uint16_t topicEdges[TOPIC_EDGE_SLOTS];          // node index, 0 is empty (root is never a child)
+uint16_t topicPlusHash;
+uint16_t topicHashHash;
+
+// Publish being dispatched
+char* topicDispatchTopic;
+uint16_t topicDispatchTopicLength;
+uint8_t* topicDispatchData;
+uint16_t topicDispatchDataLength;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// FNV-1a folded to 16 bits
+uint16_t topicHashLevel(char* level, uint16_t length)
+{
+    uint32_t hash = 2166136261u;
+    uint16_t i;
+    for (i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)level[i];
+        hash *= 16777619u;
+    }
+    return (hash >> 16) ^ (hash & 0xFFFF);
+}
+
+uint16_t topicEdgeSlot(uint16_t parent, uint16_t hash)
+{
+    return (hash ^ (parent * 0x9E37)) & (TOPIC_EDGE_SLOTS - 1);
+}
+
+// Returns the child of parent named level, or 0 if there is none
+uint16_t topicFindChild(uint16_t parent, char* level, uint16_t length, uint16_t hash)
+{
+    uint16_t slot = topicEdgeSlot(parent, hash);
+    uint16_t i, n;
+    topicNode* node;
+    while ((n = topicEdges[slot]) != 0)
+    {
+        node = &topicNodes[n];
+        if (node->parent == parent && node->levelHash == hash && node->nameLength == length)
+        {
+            i = 0;
+            while (i < length && topicNames[node->nameOffset + i] == level[i])
+                i++;
+            if (i == length)
+                return n;
+        }
+        slot = (slot + 1) & (TOPIC_EDGE_SLOTS - 1);
+    }
+    return 0;
+}
+
+// Creates a child of parent named level, returns 0 if a pool is exhausted
+uint16_t topicAddChild(uint16_t parent, char* level, uint16_t length, uint16_t hash)
+{
+    uint16_t slot = topicEdgeSlot(parent, hash);
+    uint16_t i, n;
+    // keep the edge table at most half full so probes stay short
+    if (topicNodeCount >= TOPIC_MAX_NODES || topicNodeCount >= TOPIC_EDGE_SLOTS / 2
+            || length > 255 || topicNameUsed + length > TOPIC_MAX_NAME_BYTES)
+        return 0;
+    n = topicNodeCount++;
+    topicNodes[n].parent = parent;
+    topicNodes[n].nameLength = length;
+    topicNodes[n].nameOffset = topicNameUsed;
+    topicNodes[n].levelHash = hash;
+    topicNodes[n].handler = 0;
+    for (i = 0; i < length; i++)
+        topicNames[topicNameUsed++] = level[i];
+    while (topicEdges[slot] != 0)
+        slot = (slot + 1) & (TOPIC_EDGE_SLOTS - 1);
+    topicEdges[slot] = n;
+    return n;
+}
+
+void initTopicTrie()
+{
+    uint16_t i;
+    for (i = 0; i < TOPIC_EDGE_SLOTS; i++)
+        topicEdges[i] = 0;
+    topicNameUsed = 0;
+    topicNodeCount = 1;
+    topicNodes[0].parent = 0;
+    topicNodes[0].nameLength = 0;
+    topicNodes[0].handler = 0;
+    topicPlusHash = topicHashLevel("+", 1);
+    topicHashHash = topicHashLevel("#", 1);
+}
+
+// Walks (and optionally builds) the path for filter, returns the final node or 0
+uint16_t topicWalkFilter(char* filter, bool create)
+{
+    uint16_t node = 0, child;
+    uint16_t start = 0, end, length, hash, i;
+    if (filter[0] == '\0')
+        return 0;
+    while (true)
+    {
+        end = start;
+        while (filter[end] != '\0' && filter[end] != '/')
+            end++;
+        length = end - start;
+        // wildcards must fill a whole level and '#' must be last
+        if (length > 1)
+            for (i = start; i < end; i++)
+                if (filter[i] == '+' || filter[i] == '#')
+                    return 0;
+        if (length == 1 && filter[start] == '#' && filter[end] != '\0')
+            return 0;
+        hash = topicHashLevel(&filter[start], length);
+        child = topicFindChild(node, &filter[start], length, hash);
+        if (child == 0)
+        {
+            if (!create)
+                return 0;
+            child = topicAddChild(node, &filter[start], length, hash);
+            if (child == 0)
+                return 0;
+        }
+        node = child;
+        if (filter[end] == '\0')
+            return node;
+        start = end + 1;
+    }
+}
+
+// Registers handler for filter, replacing any handler it already had
+// Returns false if the filter is malformed or the trie is full
+bool topicTrieAdd(char* filter, topicHandler handler)
+{
+    uint16_t node = topicWalkFilter(filter, true);
+    if (node == 0)
+        return false;
+    topicNodes[node].handler = handler;
+    return true;
+}
+
+// Removes the handler for filter; its nodes stay to be reused by a later add
+bool topicTrieRemove(char* filter)
+{
+    uint16_t node = topicWalkFilter(filter, false);
+    if (node == 0 || topicNodes[node].handler == 0)
+        return false;
+    topicNodes[node].handler = 0;
+    return true;
+}
+
+uint8_t topicCall(uint16_t node)
+{
+    if (node == 0 || topicNodes[node].handler == 0)
+        return 0;
+    topicNodes[node].handler(topicDispatchTopic, topicDispatchTopicLength, topicDispatchData, topicDispatchDataLength);
+    return 1;
+}
+
+// Matches the levels from start onward against the subtree below node
+// Wildcards don't match a first level beginning with '$' (MQTT 4.7.2)
+uint8_t topicMatch(uint16_t node, uint16_t start, bool atEnd, bool first)
+{
+    uint16_t end, child;
+    uint8_t count = 0;
+    bool wildcardOk = !(first && topicDispatchTopicLength > 0 && topicDispatchTopic[0] == '$');
+    char* level = &topicDispatchTopic[start];
+
+    // a '#' below this node also matches the parent level itself
+    if (wildcardOk)
+        count += topicCall(topicFindChild(node, "#", 1, topicHashHash));
+    if (atEnd)
+        return count + topicCall(node);
+
+    end = start;
+    while (end < topicDispatchTopicLength && topicDispatchTopic[end] != '/')
+        end++;
+    child = topicFindChild(node, level, end - start, topicHashLevel(level, end - start));
+    if (child != 0)
+        count += topicMatch(child, end + 1, end == topicDispatchTopicLength, false);
+    if (wildcardOk)
+    {
+        child = topicFindChild(node, "+", 1, topicPlusHash);
+        if (child != 0)
+            count += topicMatch(child, end + 1, end == topicDispatchTopicLength, false);
+    }
+    return count;
+}
+
+// Calls every handler whose filter matches topic, returns the number called
+uint8_t topicTrieDispatch(char* topic, uint16_t topicLength, uint8_t* data, uint16_t dataLength)
+{
+    topicDispatchTopic = topic;
+    topicDispatchTopicLength = topicLength;
+    topicDispatchData = data;
+    topicDispatchDataLength = dataLength;
+    return topicMatch(0, 0, false, true);
+}
+
+uint16_t topicTrieGetNodeCount()
+{
+    return topicNodeCount;
+}
@@ -0,0 +1,45 @@
+// Topic Library
+// Subscription registry mapping MQTT topic filters to local handlers
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef TOPIC_H_
+#define TOPIC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pool sizes, edge slots must be a power of two and at least twice the nodes
+#ifndef TOPIC_MAX_NODES
+#define TOPIC_MAX_NODES      192
+#endif
+#ifndef TOPIC_MAX_NAME_BYTES
+#define TOPIC_MAX_NAME_BYTES 1024
+#endif
+#ifndef TOPIC_EDGE_SLOTS
+#define TOPIC_EDGE_SLOTS     512
+#endif
+
+typedef void (*topicHandler)(char* topic, uint16_t topicLength, uint8_t* data, uint16_t dataLength);
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initTopicTrie();
+bool topicTrieAdd(char* filter, topicHandler handler);
+bool topicTrieRemove(char* filter);
+uint8_t topicTrieDispatch(char* topic, uint16_t topicLength, uint8_t* data, uint16_t dataLength);
+uint16_t topicTrieGetNodeCount();
+
+#endif
@@ -0,0 +1,117 @@
+// Trace Library
+// Binary event records in a RAM ring, drained as text in idle time
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// TRACE() stores an event id, a timestamp and three words in the ring and
+// formats nothing, so tracing barely moves the timing it is meant to show.
+// The ring always holds the latest TRACE_RECORDS events, older ones are
+// overwritten.  While streaming is on (SET TRACE ON), traceService() sends
+// records as "#T" lines of hex, only when the console has room for a whole
+// line.  tools/tracedecode.py turns a captured log back into text.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "trace.h"
+#include "uart0.h"
+
+// "#T" + 40 hex digits + CR LF
+#define TRACE_LINE_LENGTH 44
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+traceRecord traceRing[TRACE_RECORDS];
+uint32_t traceWriteIndex = 0;
+uint32_t traceReadIndex = 0;
+uint32_t traceLostCount = 0;
+bool traceStreaming = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initTrace()
+{
+    traceWriteIndex = 0;
+    traceReadIndex = 0;
+    traceLostCount = 0;
+    traceStreaming = false;
+}
+
+// Streaming starts with the oldest record still in the ring
+void traceSetStreaming(bool on)
+{
+    traceStreaming = on;
+}
+
+char* traceHex(char* str, uint32_t value, uint8_t digits)
+{
+    while (digits-- > 0)
+    {
+        *str++ = "0123456789abcdef"[(value >> (digits * 4)) & 0xF];
+    }
+    return str;
+}
+
+void traceSendRecord(traceRecord* record)
+{
+    char line[TRACE_LINE_LENGTH];
+    char* str = line;
+    *str++ = '#';
+    *str++ = 'T';
+    str = traceHex(str, record->event, 4);
+    str = traceHex(str, record->subTicks, 4);
+    str = traceHex(str, record->ticks, 8);
+    str = traceHex(str, record->arg[0], 8);
+    str = traceHex(str, record->arg[1], 8);
+    str = traceHex(str, record->arg[2], 8);
+    *str++ = '\r';
+    *str++ = '\n';
+    writeUart0(line, TRACE_LINE_LENGTH);
+}
+
+// Sends what fits in the console buffer, call from the main loop
+void traceService()
+{
+    traceRecord lost;
+    uint32_t behind;
+    if (!traceStreaming || getUart0TxSpace() < TRACE_LINE_LENGTH)
+        return;
+    behind = traceWriteIndex - traceReadIndex;
+    if (behind > TRACE_RECORDS)
+    {
+        // the writer lapped us, report the gap where it happened
+        lost.event = traceLost;
+        lost.subTicks = traceRing[traceWriteIndex & (TRACE_RECORDS - 1)].subTicks;
+        lost.ticks = traceRing[traceWriteIndex & (TRACE_RECORDS - 1)].ticks;
+        lost.arg[0] = behind - TRACE_RECORDS;
+        lost.arg[1] = lost.arg[2] = 0;
+        traceLostCount += lost.arg[0];
+        traceReadIndex = traceWriteIndex - TRACE_RECORDS;
+        traceSendRecord(&lost);
+    }
+    while (traceReadIndex != traceWriteIndex && getUart0TxSpace() >= TRACE_LINE_LENGTH)
+        traceSendRecord(&traceRing[traceReadIndex++ & (TRACE_RECORDS - 1)]);
+}
+
+uint32_t traceGetCount()
+{
+    return traceWriteIndex;
+}
+
+uint32_t traceGetLostCount()
+{
+    return traceLostCount;
+}
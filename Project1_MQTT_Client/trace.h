@@ -0,0 +1,90 @@
+// Trace Library
+// Binary event records in a RAM ring, drained as text in idle time
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer4.h"
+
+// Set to 0 to compile every TRACE() out
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 1
+#endif
+
+// Records kept, must be a power of two
+#define TRACE_RECORDS 64
+
+// Every event in id order with the text it decodes to, one per line
+// tools/tracedecode.py reads this list, so new events go at the end
+#define TRACE_EVENTS(EVENT) \
+    EVENT(traceLost,        "%u records lost") \
+    EVENT(traceBoot,        "boot step %u at %u us") \
+    EVENT(traceMainState,   "main state %u -> %u") \
+    EVENT(traceTcpOpen,     "tcp open local port %u") \
+    EVENT(traceTcpClose,    "tcp close local port %u in state %u") \
+    EVENT(traceTcpSend,     "tcp send flags 0x%03x seq %u ack %u") \
+    EVENT(traceTcpAccept,   "tcp accept flags 0x%03x seq %u consumed %u")
+
+#define TRACE_EVENT_ID(name, text) name,
+typedef enum _traceEvent
+{
+    TRACE_EVENTS(TRACE_EVENT_ID)
+    traceEventCount
+} traceEvent;
+
+// ticks is the millisecond time base, subTicks the Timer 4A count within
+// that millisecond (counting down from 40000 at 40 MHz)
+typedef struct _traceRecord
+{
+    uint16_t event;
+    uint16_t subTicks;
+    uint32_t ticks;
+    uint32_t arg[3];
+} traceRecord;
+
+extern traceRecord traceRing[TRACE_RECORDS];
+extern uint32_t traceWriteIndex;
+extern volatile uint32_t timerTicks;
+
+// Records an event from the main loop, there is no locking for interrupt context
+#if TRACE_ENABLE
+#define TRACE(id, a, b, c) \
+    do \
+    { \
+        traceRecord* traceNext = &traceRing[traceWriteIndex++ & (TRACE_RECORDS - 1)]; \
+        traceNext->event = (id); \
+        traceNext->subTicks = getTimer4Value(); \
+        traceNext->ticks = timerTicks; \
+        traceNext->arg[0] = (uint32_t)(a); \
+        traceNext->arg[1] = (uint32_t)(b); \
+        traceNext->arg[2] = (uint32_t)(c); \
+    } while (0)
+#else
+#define TRACE(id, a, b, c)
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initTrace();
+void traceSetStreaming(bool on);
+void traceService();
+uint32_t traceGetCount();
+uint32_t traceGetLostCount();
+
+#endif
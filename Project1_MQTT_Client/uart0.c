@@ -14,25 +14,50 @@
 //   U0TX (PA1) and U0RX (PA0) are connected to the 2nd controller
 //   The USB on the 2nd controller enumerates to an ICDI interface and a virtual COM port
 
+// Console I/O never waits on the line.  Received characters go through a
+// ring filled by uart0Isr; each index is written by only one side, so no
+// locking is needed.  Transmit is double buffered: main appends to one half
+// while uDMA channel 9 feeds the other half to the tx fifo, and the dma done
+// interrupt (signalled on the uart0 vector) starts the next half.  When the
+// half being filled is full and the other is still draining, further
+// characters are dropped and counted rather than stalling the caller.
+
 //-----------------------------------------------------------------------------
 // Device includes, defines, and assembler directives
 //-----------------------------------------------------------------------------
 
 #include <stdint.h>
 #include <stdbool.h>
-#include <stdlib.h>
 #include "tm4c123gh6pm.h"
 #include "uart0.h"
 #include "gpio.h"
+#include "sched.h"
 
 // Pins
 #define UART_TX PORTA,1
 #define UART_RX PORTA,0
 
+// uDMA channel 9, encoding 0 is UART0 TX
+#define UART0_TX_DMA_CHANNEL 9
+
 //-----------------------------------------------------------------------------
 // Global variables
 //-----------------------------------------------------------------------------
 
+// uDMA channel control table, primary and alternate structures for all 32 channels
+#pragma DATA_ALIGN(uart0DmaTable, 1024)
+volatile uint32_t uart0DmaTable[256];
+
+char uart0TxBuffer[2][UART0_TX_BUFFER_SIZE];
+uint8_t uart0TxFill = 0;                            // half being filled by main
+uint16_t uart0TxFillCount = 0;                      // characters waiting in that half
+volatile bool uart0TxBusy = false;                  // dma is draining the other half
+char uart0RxBuffer[UART0_RX_BUFFER_SIZE];
+volatile uint16_t uart0RxWriteIndex = 0;            // written by the isr
+volatile uint16_t uart0RxReadIndex = 0;             // written by main
+uint16_t uart0TxDropCount = 0;
+volatile uint16_t uart0RxDropCount = 0;
+
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
@@ -54,6 +79,27 @@ void initUart0(void)
     // Configure UART0 with default baud rate
     UART0_CTL_R = 0;                                    // turn-off UART0 to allow safe programming
     UART0_CC_R = UART_CC_CS_SYSCLK;                     // use system clock (usually 40 MHz)
+
+    // Configure uDMA channel 9 for basic memory to uart transfers
+    SYSCTL_RCGCDMA_R |= SYSCTL_RCGCDMA_R0;
+    while (!(SYSCTL_PRDMA_R & SYSCTL_PRDMA_R0));
+    UDMA_CFG_R = UDMA_CFG_MASTEN;
+    UDMA_CTLBASE_R = (uint32_t)uart0DmaTable;
+    UDMA_CHMAP1_R &= ~UDMA_CHMAP1_CH9SEL_M;
+    UDMA_PRIOCLR_R = 1 << UART0_TX_DMA_CHANNEL;
+    UDMA_ALTCLR_R = 1 << UART0_TX_DMA_CHANNEL;
+    UDMA_USEBURSTCLR_R = 1 << UART0_TX_DMA_CHANNEL;
+    UDMA_REQMASKCLR_R = 1 << UART0_TX_DMA_CHANNEL;
+    UART0_DMACTL_R = UART_DMACTL_TXDMAE;
+
+    // Receive interrupts fill the rx ring, the dma done interrupt arrives on the same vector
+    uart0TxFill = 0;
+    uart0TxFillCount = 0;
+    uart0TxBusy = false;
+    uart0RxWriteIndex = uart0RxReadIndex = 0;
+    UART0_IFLS_R = UART_IFLS_TX4_8 | UART_IFLS_RX4_8;
+    UART0_IM_R = UART_IM_RXIM | UART_IM_RTIM;
+    NVIC_EN0_R |= 1 << (INT_UART0-16);               // turn-on interrupt 21 (UART0)
 }
 
 // Set baud rate as function of instruction cycle frequency
@@ -69,294 +115,131 @@ void setUart0BaudRate(uint32_t baudRate, uint32_t fcyc)
                                                         // turn-on UART0
 }
 
-// Blocking function that writes a serial character when the UART buffer is not full
-void putcUart0(char c)
-{
-    while (UART0_FR_R & UART_FR_TXFF);               // wait if uart0 tx fifo full
-    UART0_DR_R = c;                                  // write character to fifo
-}
-
-// Blocking function that writes a string when the UART buffer is not full
-void putsUart0(char* str)
-{
-    uint8_t i = 0;
-    while (str[i] != '\0')
-        putcUart0(str[i++]);
-}
-
-// Blocking function that returns with serial data once the buffer is not empty
-char getcUart0(void)
-{
-    while (UART0_FR_R & UART_FR_RXFE);               // wait if uart0 rx fifo empty
-    return UART0_DR_R & 0xFF;                        // get character from fifo
-}
-
-// Returns the status of the receive buffer
-bool kbhitUart0(void)
-{
-    return !(UART0_FR_R & UART_FR_RXFE);
-}
-
-// Function that returns with string of serial data when it exceeds MAXCHAR/Enter is pressed
-void getsUart0(USER_DATA* data)
-{
- uint8_t count=0;                   //variable to keep track of string length
- char c;
-    while(count < MAX_CHARS)              //Iterite only when length is less than MAX
+// Hands the half being filled to the dma and switches main to the other half
+// Called with the uart0 interrupt disabled or from the isr
+void startTxDmaUart0(void)
+{
+    uint8_t half = uart0TxFill;
+    uint16_t count = uart0TxFillCount;
+    uart0DmaTable[UART0_TX_DMA_CHANNEL*4] = (uint32_t)&uart0TxBuffer[half][count-1];
+    uart0DmaTable[UART0_TX_DMA_CHANNEL*4+1] = (uint32_t)&UART0_DR_R;
+    uart0DmaTable[UART0_TX_DMA_CHANNEL*4+2] = UDMA_CHCTL_DSTINC_NONE | UDMA_CHCTL_DSTSIZE_8
+                                            | UDMA_CHCTL_SRCINC_8 | UDMA_CHCTL_SRCSIZE_8
+                                            | UDMA_CHCTL_ARBSIZE_4 | ((count-1) << UDMA_CHCTL_XFERSIZE_S)
+                                            | UDMA_CHCTL_XFERMODE_BASIC;
+    uart0TxBusy = true;
+    uart0TxFill = half ^ 1;
+    uart0TxFillCount = 0;
+    UDMA_ENASET_R = 1 << UART0_TX_DMA_CHANNEL;
+}
+
+// Handles uart0 rx and dma tx done interrupts
+void uart0Isr(void)
+{
+    uint16_t write, next;
+    char c;
+    // drain the rx fifo, this also clears the rx and rx timeout interrupts
+    write = uart0RxWriteIndex;
+    while (!(UART0_FR_R & UART_FR_RXFE))
+    {
+        c = UART0_DR_R & 0xFF;
+        next = (write + 1) & (UART0_RX_BUFFER_SIZE - 1);
+        if (next == uart0RxReadIndex)
+            uart0RxDropCount++;
+        else
         {
-            c=getcUart0();
-            if((c == 8)||(c==127))  //check if its backspace
-            {
-                if (count>0)
-                {
-                    count=count-1;  //If characters already entered in serial data,decrement count
-                    continue;
-                }
-                else
-                {
-                    continue;       //else get next character
-                }
-            }
-            else if((c==13)||(c==10))//If character is carriage return or line space
-            {
-                data->buffer[count]= '\0' ;
-                break;              //return the string
-            }
-            else if(c >= 32)
-            {
-                data->buffer[count++] = c;   //else move the character to the string
-                if (count == MAX_CHARS)   //If it has reached maximum allowed character
-                {
-                 data->buffer[count]= '\0' ;
-                 break;             //break and return the string
-                }
-            }
-            else
-            {
-                continue;           //else get next Character
-            }
+            uart0RxBuffer[write] = c;
+            write = next;
         }
-    return;                     //Return from function
+    }
+    if (write != uart0RxWriteIndex)
+        schedPost(schedConsole);
+    uart0RxWriteIndex = write;
+    UART0_ICR_R = UART_ICR_RXIC | UART_ICR_RTIC;
+    if (UDMA_CHIS_R & (1 << UART0_TX_DMA_CHANNEL))
+    {
+        UDMA_CHIS_R = 1 << UART0_TX_DMA_CHANNEL;
+        uart0TxBusy = false;
+        if (uart0TxFillCount > 0)
+            startTxDmaUart0();
+    }
 }
 
-//Function to parse the string and replace delimiters with Null and calculate position of useful literals
-void parseFields(USER_DATA* data)
+// Non-blocking function that queues size characters in one call
+// Whatever does not fit while both halves are in use is dropped
+void writeUart0(const char* data, uint16_t size)
 {
-    uint8_t i=0;
-    uint8_t j=0;
-    while(data->buffer[i] != '\0')       //Loop Until Strings last character
+    uint16_t i;
+    NVIC_DIS0_R = 1 << (INT_UART0-16);               // hold off the dma done interrupt
+    for (i = 0; i < size; i++)
     {
-        /*if((data->buffer[i] >= 97) && (data->buffer[i] <= 122))     //convert all lower case characters to upper case for easier parsing
+        if (uart0TxFillCount == UART0_TX_BUFFER_SIZE)
         {
-            data->buffer[i] = data->buffer[i] - 32;
-        }*/
-        if(i==0)                //for first character check if useful or delimiter
-        {
-            if((data->buffer[i]>47 && data->buffer[i]<58) || (data->buffer[i]>64 && data->buffer[i]<91) || (data->buffer[i]>96 && data->buffer[i]<122) /*|| (data->buffer[i]==44) || (data->buffer[i]==46)*/)
-            {
-                data->fieldPositon[j]=i;       //if useful chracter store the position into pos array
-                j++;            //increment index of pos array
-                i++;            //increment string index to parse next character
-            }
-            else
+            if (uart0TxBusy)
             {
-                data->buffer[i] = 0;     //if its a delimiter,replace it with null
-                i++;            //increment string index to parse next character
+                uart0TxDropCount += size - i;
+                break;
             }
+            startTxDmaUart0();
         }
-        else
-        {
-            if((data->buffer[i]>47 && data->buffer[i]<58) || (data->buffer[i]>64 && data->buffer[i]<91) || (data->buffer[i]>96 && data->buffer[i]<122) /*|| (data->buffer[i]==44) || (data->buffer[i]==46) || (data->buffer[i]==45)*/) //check if 0+i characters are not delimiers
-            {
-                if(data->buffer[i-1] == 0)       //check if the previous character was a delimiter which is now 0
-                {
-                    data->fieldPositon[j]=i;           //if yes store the index into position array
-                    j++;                //increment index of pos array
-                    i++;                //increment string index to parse next character
-                }
-                else
-                {
-                    i++;                //if not just increment the string index
-                }
-            }
-            else
-            {
-                data->buffer[i]=0;               //replace delimiter with null
-                i++;                    //increment the string index
-            }
-        }
-        if (j <= MAX_FIELDS-1)                  //check if its under maximum valid arguments
-        {
-            continue;                   //if yes continue for further iterations
-        }
-        else
-        {
-            putsUart0("Exceeded argument limit,discarding unnecessary arguments");
-            putsUart0("\r\n");
-            return;                     //else exit the loop
-        }
+        uart0TxBuffer[uart0TxFill][uart0TxFillCount++] = data[i];
     }
-    data->fieldCount = j+1;
-    return;
+    if (!uart0TxBusy && uart0TxFillCount > 0)
+        startTxDmaUart0();
+    NVIC_EN0_R = 1 << (INT_UART0-16);
 }
 
-
-//function to return an field from the String based on field number
-char* getFieldString(USER_DATA* data,uint8_t fieldNumber)
+// Non-blocking function that queues a serial character
+void putcUart0(char c)
 {
-    return &data->buffer[data->fieldPositon[fieldNumber-1]];
+    writeUart0(&c, 1);
 }
 
-
-//function to convert field String into Integer
-uint32_t getFieldInt(USER_DATA* data,uint8_t fieldNumber)
+// Non-blocking function that queues a string
+void putsUart0(char* str)
 {
-    return atoi(getFieldString(data,fieldNumber));      //return integer of argument number argPos from sting str
+    uint16_t size = 0;
+    while (str[size] != '\0')
+        size++;
+    writeUart0(str, size);
 }
 
-//function to convert field String into Integer
-float getFieldFloat(USER_DATA* data,uint8_t fieldNumber)
+// Blocking function that waits until everything queued has left the uart
+void flushUart0(void)
 {
-    return atof(getFieldString(data,fieldNumber));      //return float of argument number argPos from sting str
+    while (uart0TxBusy || uart0TxFillCount > 0);
+    while (UART0_FR_R & UART_FR_BUSY);
 }
 
-//Function to check if the argument is valid
-bool isCommand(USER_DATA* data,char verb[20],uint8_t minField)
+// Blocking function that returns with serial data once the buffer is not empty
+char getcUart0(void)
 {
-    if (stringCompare(verb,"REBOOT") == true)
-    {
-        if (((stringCompare(getFieldString(data,1), "REBOOT") == true) || (stringCompare(getFieldString(data,1), "reboot") == true)) && (data->fieldCount >= minField+1))
-        return true;
-    }
-    else if (stringCompare(verb,"STATUS") == true)
-    {
-        if (((stringCompare(getFieldString(data,1), "STATUS") == true) || (stringCompare(getFieldString(data,1), "status") == true))&& (data->fieldCount >= minField+1))
-        return true;
-    }
-    else if (stringCompare(verb,"CONNECT") == true)
-    {
-        if (((stringCompare(getFieldString(data,1), "CONNECT") == true) || (stringCompare(getFieldString(data,1), "connect") == true)) && (data->fieldCount >= minField+1))
-        return true;
-    }
-    else if (stringCompare(verb,"DISCONNECT") == true)
-    {
-        if (((stringCompare(getFieldString(data,1), "DISCONNECT") == true) || (stringCompare(getFieldString(data,1), "disconnect") == true)) && (data->fieldCount >= minField+1))
-        return true;
-    }
-    else if (stringCompare(verb,"SUBSCRIBE") == true)
-    {
-        if (((stringCompare(getFieldString(data,1), "SUBSCRIBE") == true) || (stringCompare(getFieldString(data,1), "subscribe") == true)) && (data->fieldCount >= minField+2))
-        return true;
-    }
-    else if (stringCompare(verb,"UNSUBSCRIBE") == true)
-    {
-        if (((stringCompare(getFieldString(data,1), "UNSUBSCRIBE") == true) || (stringCompare(getFieldString(data,1), "unsubscribe") == true)) && (data->fieldCount >= minField+2))
-        return true;
-    }
-    else if (stringCompare(verb,"PUBLISH") == true)
-    {
-        if (((stringCompare(getFieldString(data,1), "PUBLISH") == true) || (stringCompare(getFieldString(data,1), "publish") == true))&& (data->fieldCount >= minField+2))
-        return true;
-    }
-    else if (stringCompare(verb,"SET") == true)
-    {
-        if (((stringCompare(getFieldString(data,1), "SET") == true) || (stringCompare(getFieldString(data,1), "set") == true))&& ((stringCompare(getFieldString(data,2), "IP") == true) || (stringCompare(getFieldString(data,2), "MQTT") == true)) && (data->fieldCount >= minField+2))
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-    return false;
+    char c;
+    uint16_t read = uart0RxReadIndex;
+    while (read == uart0RxWriteIndex);               // wait if rx ring empty
+    c = uart0RxBuffer[read];
+    uart0RxReadIndex = (read + 1) & (UART0_RX_BUFFER_SIZE - 1);
+    return c;
 }
 
-
-//Personal String Compare function
-bool stringCompare(char str1[], char str2[])
+// Returns the status of the receive buffer
+bool kbhitUart0(void)
 {
-    int ctr=0;
-    while(str1[ctr]==str2[ctr])
-    {
-        if(str1[ctr]=='\0'||str2[ctr]=='\0')
-            break;
-        ctr++;
-    }
-    if(str1[ctr]=='\0' && str2[ctr]=='\0')
-        return true;
-    else
-        return false;
+    return uart0RxReadIndex != uart0RxWriteIndex;
 }
 
-
-void reverse(char* s, uint8_t l)
+// Characters that can be queued now without any being dropped
+uint16_t getUart0TxSpace(void)
 {
-    uint8_t i=0,j=l-1;
-    char temp;
-    for(i=0;i<j;i++)
-    {
-       temp=s[i];
-       s[i]=s[j];
-       s[j]=temp;
-       j--;
-    }
+    return UART0_TX_BUFFER_SIZE - uart0TxFillCount;
 }
 
-//reffered from geeksforgeeks
-char* itoa(int num,char* str, int base)
+uint16_t getUart0TxDropCount(void)
 {
-    int i = 0;
-    bool isNegative = false;
-
-    /* Handle 0 explicitly, otherwise empty string is printed for 0 */
-    if (num == 0)
-    {
-        str[i++] = '0';
-        while(num == 0 && i <= 7 && base == 16)
-        {
-            str[i++] = '0';
-        }
-        str[i] = '\0';
-        return str;
-    }
-
-    // In standard itoa(), negative numbers are handled only with
-    // base 10. Otherwise numbers are considered unsigned.
-    if (num < 0 && base == 10)
-    {
-        isNegative = true;
-        num = -num;
-    }
-
-    // Process individual digits
-    while (num != 0)
-    {
-        int rem = num % base;
-        str[i++] = (rem > 9)? (rem-10) + 'A' : rem + '0';
-        num = num/base;
-    }
-
-    // If number is negative, append '-'
-    if (isNegative)
-        str[i++] = '-';
-
-    while(num == 0 && i <= 7 && base == 16)
-    {
-        str[i++] = '0';
-    }
-    str[i] = '\0'; // Append string terminator
-
-    // Reverse the string
-    reverse(str, i);
-
-    return str;
+    return uart0TxDropCount;
 }
 
-uint16_t strLen(char* string)
+uint16_t getUart0RxDropCount(void)
 {
-    uint16_t i = 0;
-    while(string[i] != 0)
-    {
-        i++;
-    }
-    return i;
+    return uart0RxDropCount;
 }
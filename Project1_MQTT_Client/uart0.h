@@ -25,15 +25,10 @@
 // GLOBAL Declarations
 //-----------------------------------------------------------------------------
 
-#define MAX_CHARS 80
-#define MAX_FIELDS 30
-typedef struct _USER_DATA
-        {
-            char buffer[MAX_CHARS+1];
-            uint8_t fieldCount;
-            uint8_t fieldPositon[MAX_FIELDS];
-            char fieldType[MAX_FIELDS];
-        } USER_DATA;
+// Size of each transmit half (at most 1024, the longest uDMA transfer)
+#define UART0_TX_BUFFER_SIZE 1024
+// Receive ring size, must be a power of two
+#define UART0_RX_BUFFER_SIZE 128
 
 //-----------------------------------------------------------------------------
 // Subroutines
@@ -43,17 +38,12 @@ void initUart0(void);
 void setUart0BaudRate(uint32_t baudRate, uint32_t fcyc);
 void putcUart0(char c);
 void putsUart0(char* str);
+void writeUart0(const char* data, uint16_t size);
+void flushUart0(void);
 char getcUart0(void);
 bool kbhitUart0(void);
-void getsUart0(USER_DATA* data);
-void parseFields(USER_DATA* data);
-char* getFieldString(USER_DATA* data,uint8_t fieldNumber);
-uint32_t getFieldInt(USER_DATA* data,uint8_t fieldNumber);
-float getFieldFloat(USER_DATA* data,uint8_t fieldNumber);
-bool isCommand(USER_DATA* data,char verb[20],uint8_t minField);
-bool stringCompare(char str1[], char str2[]);
-char* itoa(int num,char* str, int base);
-void reverse(char* s, uint8_t l);
-uint16_t strLen(char* string);
+uint16_t getUart0TxSpace(void);
+uint16_t getUart0TxDropCount(void);
+uint16_t getUart0RxDropCount(void);
 
 #endif
@@ -0,0 +1,134 @@
+// UDP Library
+// Port table demultiplexing UDP datagrams to bound sockets
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// A socket is just a local port and the handler for datagrams sent to it.
+// Received datagrams are matched on destination port only; the handler gets
+// the sender's address and port so it can answer with udpSendTo(), which
+// builds a fresh frame and reaches the next hop through the ARP cache.
+// Datagrams to ports nobody has bound are counted and dropped.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "udp.h"
+#include "eth0.h"
+#include "timer.h"
+
+typedef struct _udpSocket
+{
+    uint16_t port;                  // 0 when the slot is free
+    udpHandler handler;
+} udpSocket;
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+udpSocket udpSockets[UDP_MAX_SOCKETS];
+uint16_t udpDropCount = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initUdp()
+{
+    uint8_t i;
+    for (i = 0; i < UDP_MAX_SOCKETS; i++)
+        udpSockets[i].port = 0;
+    udpDropCount = 0;
+}
+
+// Returns the socket bound to port, or 0 if there is none
+udpSocket* udpFind(uint16_t port)
+{
+    uint8_t i;
+    for (i = 0; i < UDP_MAX_SOCKETS; i++)
+        if (udpSockets[i].port == port && port != 0)
+            return &udpSockets[i];
+    return 0;
+}
+
+// Binds handler to port, or to a free ephemeral port when port is 0
+// Returns the bound port, or 0 if the port is taken or the table is full
+uint16_t udpBind(uint16_t port, udpHandler handler)
+{
+    uint8_t i;
+    udpSocket* socket = 0;
+    if (port != 0 && udpFind(port) != 0)
+        return 0;
+    for (i = 0; i < UDP_MAX_SOCKETS && socket == 0; i++)
+        if (udpSockets[i].port == 0)
+            socket = &udpSockets[i];
+    if (socket == 0)
+        return 0;
+    while (port == 0)
+    {
+        port = UDP_EPHEMERAL_FIRST + (random32() % UDP_EPHEMERAL_COUNT);
+        if (udpFind(port) != 0)
+            port = 0;
+    }
+    socket->port = port;
+    socket->handler = handler;
+    return port;
+}
+
+void udpUnbind(uint16_t port)
+{
+    udpSocket* socket = udpFind(port);
+    if (socket != 0)
+        socket->port = 0;
+}
+
+// Sends a datagram from localPort to ip:port, using ether as the frame buffer
+// Returns false if the datagram had to be dropped
+bool udpSendTo(etherHeader* ether, uint16_t localPort, uint8_t ip[4], uint16_t port, uint8_t* data, uint16_t size)
+{
+    return etherSendUdp(ether, localPort, ip, port, data, size);
+}
+
+// Passes a received UDP datagram to the socket bound to its destination port
+// Returns false if no socket is bound to it
+bool udpDispatch(etherHeader* ether)
+{
+    ipHeader *ip = (ipHeader*)ether->data;
+    uint8_t ipHeaderLength = (ip->revSize & 0xF) * 4;
+    udpHeader *udp = (udpHeader*)((uint8_t*)ip + ipHeaderLength);
+    udpSocket* socket = udpFind(ntohs(udp->destPort));
+    uint8_t srcIp[4];
+    uint8_t i;
+    if (socket == 0 || ntohs(udp->length) < sizeof(udpHeader))
+    {
+        udpDropCount++;
+        return false;
+    }
+    for (i = 0; i < 4; i++)
+        srcIp[i] = ip->sourceIp[i];
+    socket->handler(ether, srcIp, ntohs(udp->sourcePort), udp->data, ntohs(udp->length) - sizeof(udpHeader));
+    return true;
+}
+
+uint8_t udpGetBoundCount()
+{
+    uint8_t i, count = 0;
+    for (i = 0; i < UDP_MAX_SOCKETS; i++)
+        if (udpSockets[i].port != 0)
+            count++;
+    return count;
+}
+
+uint16_t udpGetDropCount()
+{
+    return udpDropCount;
+}
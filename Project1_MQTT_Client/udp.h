@@ -0,0 +1,44 @@
+// UDP Library
+// Port table demultiplexing UDP datagrams to bound sockets
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef UDP_H_
+#define UDP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "eth0.h"
+
+#define UDP_MAX_SOCKETS     8
+// Ports handed out when binding to port 0
+#define UDP_EPHEMERAL_FIRST 49152
+#define UDP_EPHEMERAL_COUNT 16384
+
+// Called with the received frame, which may be reused to send a reply
+// srcIp is a copy, so it stays valid while the frame is overwritten
+typedef void (*udpHandler)(etherHeader* ether, uint8_t srcIp[4], uint16_t srcPort, uint8_t* data, uint16_t size);
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initUdp();
+uint16_t udpBind(uint16_t port, udpHandler handler);
+void udpUnbind(uint16_t port);
+bool udpSendTo(etherHeader* ether, uint16_t localPort, uint8_t ip[4], uint16_t port, uint8_t* data, uint16_t size);
+bool udpDispatch(etherHeader* ether);
+uint8_t udpGetBoundCount();
+uint16_t udpGetDropCount();
+
+#endif